@@ -0,0 +1,254 @@
+#ifndef AUDIT_LOG_H
+#define AUDIT_LOG_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// On-device journal of keystroke requests. Each request is one 32-byte record
+// holding a digest of the input rather than the input itself. Records are
+// collected in RAM in 256-byte blocks (a header and seven records, CRC-32
+// checked) and a block is only written to LittleFS while no report is being
+// played, because flash writes pause the other core. Two files are used in
+// turn; when the current one is full the older one is truncated and reused.
+// All values are little-endian; tools/audit_decode.py reads the files.
+#define AUDIT_MAGIC             0x41444948UL // "HIDA"
+#define AUDIT_VERSION           1
+#define AUDIT_BLOCK_SIZE        256
+#define AUDIT_RECORDS_PER_BLOCK 7
+#define AUDIT_FILE_BLOCKS       32           // 8 KB per file, 224 records
+#define AUDIT_PENDING_BLOCKS    4            // Blocks held in RAM while HID is busy
+#define AUDIT_FLUSH_MS          (5 * 60 * 1000) // Oldest a part-filled block gets before it is written
+
+// Record kinds
+#define AUDIT_KIND_SEND         1  // POST /send
+#define AUDIT_KIND_UPLOAD       2  // POST /send/raw
+#define AUDIT_KIND_BATCH        3  // POST /batch
+#define AUDIT_KIND_MACRO        4  // POST /macro/{name}
+#define AUDIT_KIND_LIVE_BATCH   5  // Text frame on the live channel
+#define AUDIT_KIND_LIVE_SESSION 6  // Live channel opened
+
+// Record outcomes
+#define AUDIT_ACCEPTED   0
+#define AUDIT_QUEUE_FULL 1
+#define AUDIT_REJECTED   2  // Input did not compile
+
+// Audit record structure
+typedef struct {
+  uint32_t timeMs;    // millis() since the boot in the block header
+  uint8_t kind;
+  uint8_t outcome;
+  uint8_t ip[4];
+  uint16_t reserved;
+  uint32_t jobId;     // 0 when nothing was queued
+  uint32_t reports;   // Compiled reports queued
+  uint32_t bytes;     // Input length
+  uint64_t digest;    // FNV-1a 64 of the input (of the reports for macros)
+} AuditRecord;
+
+// Audit block header structure
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t count;      // Records used in this block
+  uint16_t boot;      // Incremented at every start
+  uint32_t sequence;  // Block number, continuous across both files
+  uint32_t dropped;   // Records lost to a full RAM buffer before this block
+  uint32_t crc;       // CRC-32 of the whole block with this field zero
+  uint8_t reserved[12];
+} AuditBlockHeader;
+
+// Audit block structure
+typedef struct {
+  AuditBlockHeader header;
+  AuditRecord records[AUDIT_RECORDS_PER_BLOCK];
+} AuditBlock;
+
+static_assert(sizeof(AuditRecord) == 32, "AuditRecord must match the file layout");
+static_assert(sizeof(AuditBlock) == AUDIT_BLOCK_SIZE, "AuditBlock must match the file layout");
+
+// Function declarations
+bool initializeAuditLog();
+void logAudit(uint8_t kind, uint8_t outcome, const IPAddress& ip, uint32_t jobId,
+              uint32_t reports, uint32_t bytes, uint64_t digest);
+void serviceAuditLog(bool hidIdle);
+size_t auditLogSize();
+size_t readAuditLog(size_t offset, uint8_t* out, size_t size);
+
+// Implementation
+const char* const AUDIT_FILES[2] = {"/audit0.bin", "/audit1.bin"};
+
+AuditBlock auditBlocks[AUDIT_PENDING_BLOCKS];
+uint8_t auditFirst = 0;        // Oldest block not yet written
+uint8_t auditPending = 0;      // Blocks holding records; the newest may still take more
+uint32_t auditOpenedMs = 0;    // First record of the newest block
+uint32_t auditDropped = 0;     // Since the last block was opened
+uint32_t auditRecordsDropped = 0;
+
+File auditFile;
+uint8_t auditFileIndex = 0;
+uint32_t auditNextSequence = 0;
+uint16_t auditBoot = 0;
+bool auditReady = false;
+
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+void sealAuditBlock(AuditBlock& block, uint32_t sequence) {
+  block.header.magic = AUDIT_MAGIC;
+  block.header.version = AUDIT_VERSION;
+  block.header.boot = auditBoot;
+  block.header.sequence = sequence;
+  block.header.crc = 0;
+  block.header.crc = crc32(&block, sizeof(block));
+}
+
+bool isValidAuditBlock(AuditBlock& block) {
+  uint32_t crc = block.header.crc;
+  block.header.crc = 0;
+  bool valid = block.header.magic == AUDIT_MAGIC && crc32(&block, sizeof(block)) == crc;
+  block.header.crc = crc;
+  return valid;
+}
+
+// Last block of a file, or false if the file is empty or the block is damaged
+bool readLastAuditBlock(uint8_t index, AuditBlock& block) {
+  File file = LittleFS.open(AUDIT_FILES[index], "r");
+  if (!file) return false;
+  size_t size = file.size();
+  bool found = size >= sizeof(block) && file.seek(size - size % sizeof(block) - sizeof(block)) &&
+               file.read((uint8_t*)&block, sizeof(block)) == sizeof(block) && isValidAuditBlock(block);
+  file.close();
+  return found;
+}
+
+// Called once LittleFS is mounted; continues the file holding the newest block
+bool initializeAuditLog() {
+  AuditBlock last[2];
+  bool found[2] = {readLastAuditBlock(0, last[0]), readLastAuditBlock(1, last[1])};
+  if (found[0] || found[1]) {
+    auditFileIndex = found[1] && (!found[0] || (int32_t)(last[1].header.sequence - last[0].header.sequence) > 0) ? 1 : 0;
+    auditNextSequence = last[auditFileIndex].header.sequence + 1;
+    auditBoot = last[auditFileIndex].header.boot;
+  }
+  auditBoot++;
+
+  auditFile = LittleFS.open(AUDIT_FILES[auditFileIndex], "a");
+  auditReady = (bool)auditFile;
+  if (!auditReady) {
+    Serial.println("Failed to open audit log");
+  }
+  return auditReady;
+}
+
+void logAudit(uint8_t kind, uint8_t outcome, const IPAddress& ip, uint32_t jobId,
+              uint32_t reports, uint32_t bytes, uint64_t digest) {
+  AuditBlock* block = auditPending ? &auditBlocks[(auditFirst + auditPending - 1) % AUDIT_PENDING_BLOCKS] : nullptr;
+  if (!block || block->header.count == AUDIT_RECORDS_PER_BLOCK) {
+    if (auditPending == AUDIT_PENDING_BLOCKS) {
+      auditDropped++;
+      auditRecordsDropped++;
+      return;
+    }
+    block = &auditBlocks[(auditFirst + auditPending++) % AUDIT_PENDING_BLOCKS];
+    memset(block, 0, sizeof(*block));
+    block->header.dropped = auditDropped;
+    auditDropped = 0;
+    auditOpenedMs = millis();
+  }
+
+  AuditRecord& record = block->records[block->header.count++];
+  record.timeMs = millis();
+  record.kind = kind;
+  record.outcome = outcome;
+  for (int i = 0; i < 4; i++) record.ip[i] = ip[i];
+  record.jobId = jobId;
+  record.reports = reports;
+  record.bytes = bytes;
+  record.digest = digest;
+}
+
+// Starts the other file once the current one is full
+bool rotateAuditFile() {
+  auditFile.close();
+  auditFileIndex = 1 - auditFileIndex;
+  auditFile = LittleFS.open(AUDIT_FILES[auditFileIndex], "w");
+  return (bool)auditFile;
+}
+
+// Called from loop(): writes at most one block, and only while HID is idle
+void serviceAuditLog(bool hidIdle) {
+  if (!auditReady || !hidIdle || auditPending == 0) {
+    return;
+  }
+  AuditBlock& block = auditBlocks[auditFirst];
+  if (auditPending == 1 && block.header.count < AUDIT_RECORDS_PER_BLOCK &&
+      millis() - auditOpenedMs < AUDIT_FLUSH_MS) {
+    return;
+  }
+
+  if (auditFile.size() >= AUDIT_FILE_BLOCKS * AUDIT_BLOCK_SIZE && !rotateAuditFile()) {
+    auditReady = false;
+    Serial.println("Failed to rotate audit log");
+    return;
+  }
+  sealAuditBlock(block, auditNextSequence);
+  if (auditFile.write((const uint8_t*)&block, sizeof(block)) != sizeof(block)) {
+    Serial.println("Failed to write audit log");
+    return; // Kept for the next pass
+  }
+  auditFile.flush();
+  auditNextSequence++;
+  auditFirst = (auditFirst + 1) % AUDIT_PENDING_BLOCKS;
+  auditPending--;
+}
+
+// Older file, current file, then the blocks still in RAM
+size_t auditLogSize() {
+  File older = LittleFS.open(AUDIT_FILES[1 - auditFileIndex], "r");
+  size_t size = older ? older.size() : 0;
+  older.close();
+  return size + (auditReady ? auditFile.size() : 0) + auditPending * AUDIT_BLOCK_SIZE;
+}
+
+// Copies up to size bytes of the log from offset; blocks still in RAM are
+// sealed with the sequence numbers they will be written under
+size_t readAuditLog(size_t offset, uint8_t* out, size_t size) {
+  size_t copied = 0;
+  for (uint8_t part = 0; part < 2 && copied < size; part++) {
+    File file = LittleFS.open(AUDIT_FILES[part == 0 ? 1 - auditFileIndex : auditFileIndex], "r");
+    size_t length = file ? file.size() : 0;
+    if (offset < length) {
+      file.seek(offset);
+      copied += file.read(out + copied, size - copied);
+      offset = 0;
+    } else {
+      offset -= length;
+    }
+    file.close();
+  }
+
+  for (uint8_t i = 0; i < auditPending && copied < size; i++) {
+    if (offset >= AUDIT_BLOCK_SIZE) {
+      offset -= AUDIT_BLOCK_SIZE;
+      continue;
+    }
+    AuditBlock block = auditBlocks[(auditFirst + i) % AUDIT_PENDING_BLOCKS];
+    sealAuditBlock(block, auditNextSequence + i);
+    size_t length = AUDIT_BLOCK_SIZE - offset < size - copied ? AUDIT_BLOCK_SIZE - offset : size - copied;
+    memcpy(out + copied, (const uint8_t*)&block + offset, length);
+    copied += length;
+    offset = 0;
+  }
+  return copied;
+}
+
+#endif
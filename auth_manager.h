@@ -0,0 +1,334 @@
+#ifndef AUTH_MANAGER_H
+#define AUTH_MANAGER_H
+
+#include <Arduino.h>
+#include <MD5Builder.h>
+#include <bearssl/bearssl.h>
+#include "config_manager.h"
+
+// Request authentication: HTTP Digest checked against an HA1 computed once at
+// boot, and short-lived session tokens for scripted clients. Nonces and tokens
+// are HMAC-SHA256 signed with a per-boot secret, so they stop working when the
+// device restarts. The only server-side state is the highest nc accepted for
+// each nonce in use, so a captured Digest request cannot be sent again.
+#define DIGEST_NONCE_TTL_MS  (5 * 60 * 1000)
+#define SESSION_TOKEN_TTL_MS (15 * 60 * 1000)
+#define SESSION_TOKEN_SIZE   42  // 8 hex issue time, '.', 32 hex MAC
+#define DIGEST_NONCE_SIZE    25  // 8 hex issue time, 16 hex MAC
+#define DIGEST_FIELD_SIZE    129
+
+// Nonce count table: open addressing keyed by issue time, scanning a fixed
+// window like the client table. When a window is full the oldest record is
+// dropped, and nonces issued up to then that have no record are answered as
+// stale, so the browser moves to a fresh one instead of replays getting in.
+#define NONCE_TABLE_BITS     5
+#define NONCE_TABLE_SIZE     (1 << NONCE_TABLE_BITS)
+#define NONCE_PROBE_WINDOW   4
+
+// Authentication results
+#define AUTH_MISSING 0  // No (usable) Authorization header
+#define AUTH_FAILED  1
+#define AUTH_STALE   2  // Correct credentials, expired or replayed nonce
+#define AUTH_OK      3
+
+// Nonce record structure
+typedef struct {
+  uint32_t issued;        // Issue time of the nonce in millis()
+  uint32_t highestCount;  // Highest nc accepted; 0 for an empty slot
+} NonceRecord;
+
+extern NonceRecord nonceRecords[NONCE_TABLE_SIZE];
+extern uint32_t nonceRecordsEvicted;
+extern bool authNewDigestLogin;
+
+// Function declarations
+void initializeAuth(const char* realm);
+uint8_t authenticateRequest(const char* authorization, const char* method, const char* path, const IPAddress& clientIP);
+void formatDigestChallenge(char* out, size_t size, bool stale);
+void issueSessionToken(char* token, size_t size, const IPAddress& clientIP);
+
+// Implementation
+const char* authRealm = "";
+char authHa1[33];
+br_hmac_key_context authKey;
+NonceRecord nonceRecords[NONCE_TABLE_SIZE];
+uint32_t nonceRecordsEvicted = 0;
+uint32_t nonceFloor = 0;  // Nonces issued at or before this need a record
+bool authNewDigestLogin = false;  // Last request accepted was the first on its nonce
+
+void md5Hex(MD5Builder& md5, char* out) {
+  md5.calculate();
+  md5.getChars(out);
+}
+
+// Lowercase hex of the first length bytes of HMAC-SHA256(secret, tag || data)
+void authMac(char tag, const char* data, size_t length, char* out, size_t bytes) {
+  uint8_t mac[br_sha256_SIZE];
+  br_hmac_context hmac;
+  br_hmac_init(&hmac, &authKey, 0);
+  br_hmac_update(&hmac, &tag, 1);
+  br_hmac_update(&hmac, data, length);
+  br_hmac_out(&hmac, mac);
+  for (size_t i = 0; i < bytes; i++) {
+    snprintf(out + i * 2, 3, "%02x", mac[i]);
+  }
+}
+
+// Issue time in millis() from the first 8 hex digits
+uint32_t authIssueTime(const char* text) {
+  char hex[9];
+  memcpy(hex, text, 8);
+  hex[8] = '\0';
+  return strtoul(hex, nullptr, 16);
+}
+
+// Issue time followed by the client address, as signed in a session token
+void sessionTokenData(char* out, size_t size, uint32_t issued, const IPAddress& clientIP) {
+  snprintf(out, size, "%08lx%u.%u.%u.%u", (unsigned long)issued, clientIP[0], clientIP[1], clientIP[2], clientIP[3]);
+}
+
+bool equalsConstantTime(const char* a, const char* b, size_t length) {
+  uint8_t difference = 0;
+  for (size_t i = 0; i < length; i++) {
+    difference |= a[i] ^ b[i];
+  }
+  return difference == 0;
+}
+
+// Called once the configuration is loaded
+void initializeAuth(const char* realm) {
+  authRealm = realm;
+
+  MD5Builder md5;
+  md5.begin();
+  md5.add(deviceConfig.username);
+  md5.add(":");
+  md5.add(realm);
+  md5.add(":");
+  md5.add(deviceConfig.userpass);
+  md5Hex(md5, authHa1);
+
+  uint32_t secret[8];
+  for (uint32_t& word : secret) {
+    word = rp2040.hwrand32();
+  }
+  br_hmac_key_init(&authKey, &br_sha256_vtable, secret, sizeof(secret));
+
+  memset(nonceRecords, 0, sizeof(nonceRecords));
+  // Every nonce signed with this secret is issued from now on
+  nonceFloor = millis() - 1;
+}
+
+// Value of name=value or name="value" in a Digest header
+bool digestField(const char* header, const char* name, char* out, size_t size) {
+  size_t nameLength = strlen(name);
+  for (const char* p = header; (p = strstr(p, name)) != nullptr; p += nameLength) {
+    if ((p != header && p[-1] != ' ' && p[-1] != ',') || p[nameLength] != '=') {
+      continue;
+    }
+    const char* value = p + nameLength + 1;
+    bool quoted = *value == '"';
+    if (quoted) value++;
+    size_t length = quoted ? strcspn(value, "\"") : strcspn(value, ", ");
+    if (length >= size) {
+      return false;
+    }
+    memcpy(out, value, length);
+    out[length] = '\0';
+    return true;
+  }
+  return false;
+}
+
+// Issue time plus a MAC over it, checked before the credentials
+uint8_t checkDigestNonce(const char* nonce) {
+  char mac[17];
+  if (strlen(nonce) != DIGEST_NONCE_SIZE - 1) {
+    return AUTH_FAILED;
+  }
+  authMac('n', nonce, 8, mac, 8);
+  if (!equalsConstantTime(nonce + 8, mac, 16)) {
+    return AUTH_FAILED;
+  }
+  return millis() - authIssueTime(nonce) < DIGEST_NONCE_TTL_MS ? AUTH_OK : AUTH_STALE;
+}
+
+// Fibonacci hashing, as for client addresses
+uint32_t nonceSlotIndex(uint32_t issued) {
+  return (uint32_t)(issued * 2654435761u) >> (32 - NONCE_TABLE_BITS);
+}
+
+// Records count as the highest nc used with an unexpired nonce; false if it
+// is not above the last one accepted, or the nonce's record was dropped
+bool acceptNonceCount(uint32_t issued, uint32_t count) {
+  uint32_t now = millis();
+  uint32_t index = nonceSlotIndex(issued);
+  NonceRecord* found = nullptr;
+  NonceRecord* victim = nullptr;
+
+  // Older nonces are stale anyway; keeps the floor's age from wrapping
+  if (now - nonceFloor > DIGEST_NONCE_TTL_MS) {
+    nonceFloor = now - DIGEST_NONCE_TTL_MS;
+  }
+
+  for (uint32_t i = 0; i < NONCE_PROBE_WINDOW; i++) {
+    NonceRecord& record = nonceRecords[(index + i) & (NONCE_TABLE_SIZE - 1)];
+    if (record.highestCount != 0 && now - record.issued >= DIGEST_NONCE_TTL_MS) {
+      record.highestCount = 0;
+    }
+    if (record.highestCount != 0 && record.issued == issued) {
+      found = &record;
+    } else if (!victim || (victim->highestCount != 0 &&
+               (record.highestCount == 0 || now - record.issued > now - victim->issued))) {
+      victim = &record;
+    }
+  }
+
+  if (found) {
+    if (count <= found->highestCount) {
+      return false;
+    }
+    found->highestCount = count;
+    return true;
+  }
+  if (now - issued >= now - nonceFloor) {
+    return false;
+  }
+
+  if (victim->highestCount != 0) {
+    nonceRecordsEvicted++;
+    if (now - victim->issued < now - nonceFloor) {
+      nonceFloor = victim->issued;
+    }
+  }
+  victim->issued = issued;
+  victim->highestCount = count;
+  authNewDigestLogin = true;
+  return true;
+}
+
+// nc is 8 hex digits, counting up from 1 with each request on a nonce
+uint32_t parseNonceCount(const char* nc) {
+  if (strlen(nc) != 8 || strspn(nc, "0123456789abcdefABCDEF") != 8) {
+    return 0;
+  }
+  return strtoul(nc, nullptr, 16);
+}
+
+uint8_t authenticateDigest(const char* header, const char* method, const char* path) {
+  char username[DIGEST_FIELD_SIZE], realm[DIGEST_FIELD_SIZE], nonce[DIGEST_FIELD_SIZE];
+  char uri[DIGEST_FIELD_SIZE], response[DIGEST_FIELD_SIZE];
+  char qop[16] = "", nc[16] = "", cnonce[DIGEST_FIELD_SIZE] = "";
+
+  if (!digestField(header, "username", username, sizeof(username)) ||
+      !digestField(header, "realm", realm, sizeof(realm)) ||
+      !digestField(header, "nonce", nonce, sizeof(nonce)) ||
+      !digestField(header, "uri", uri, sizeof(uri)) ||
+      !digestField(header, "response", response, sizeof(response)) || strlen(response) != 32) {
+    return AUTH_FAILED;
+  }
+  if (digestField(header, "qop", qop, sizeof(qop)) &&
+      (strcmp(qop, "auth") != 0 || !digestField(header, "nc", nc, sizeof(nc)) ||
+       !digestField(header, "cnonce", cnonce, sizeof(cnonce)))) {
+    return AUTH_FAILED;
+  }
+  // Without qop there is no nc, so the nonce is good for one request
+  uint32_t count = qop[0] ? parseNonceCount(nc) : 1;
+  if (count == 0) {
+    return AUTH_FAILED;
+  }
+
+  // The signed URI must be the one requested, not just any URI
+  size_t pathLength = strcspn(uri, "?");
+  if (strcmp(username, deviceConfig.username) != 0 || strcmp(realm, authRealm) != 0 ||
+      pathLength != strlen(path) || strncmp(uri, path, pathLength) != 0) {
+    return AUTH_FAILED;
+  }
+
+  uint8_t nonceState = checkDigestNonce(nonce);
+  if (nonceState == AUTH_FAILED) {
+    return AUTH_FAILED;
+  }
+
+  char ha2[33];
+  char expected[33];
+  MD5Builder md5;
+  md5.begin();
+  md5.add(method);
+  md5.add(":");
+  md5.add(uri);
+  md5Hex(md5, ha2);
+
+  md5.begin();
+  md5.add(authHa1);
+  md5.add(":");
+  md5.add(nonce);
+  md5.add(":");
+  if (qop[0]) {
+    md5.add(nc);
+    md5.add(":");
+    md5.add(cnonce);
+    md5.add(":");
+    md5.add(qop);
+    md5.add(":");
+  }
+  md5.add(ha2);
+  md5Hex(md5, expected);
+
+  if (!equalsConstantTime(response, expected, 32)) {
+    return AUTH_FAILED;
+  }
+
+  // A replayed request has the right credentials; stale sends the browser a fresh nonce
+  if (nonceState == AUTH_OK && !acceptNonceCount(authIssueTime(nonce), count)) {
+    return AUTH_STALE;
+  }
+  return nonceState;
+}
+
+uint8_t authenticateSessionToken(const char* token, const IPAddress& clientIP) {
+  char mac[33];
+  char signedPart[24];
+  if (strlen(token) != SESSION_TOKEN_SIZE - 1 || token[8] != '.') {
+    return AUTH_FAILED;
+  }
+  uint32_t issued = authIssueTime(token);
+  sessionTokenData(signedPart, sizeof(signedPart), issued, clientIP);
+  authMac('s', signedPart, strlen(signedPart), mac, 16);
+  if (!equalsConstantTime(token + 9, mac, 32)) {
+    return AUTH_FAILED;
+  }
+  return millis() - issued < SESSION_TOKEN_TTL_MS ? AUTH_OK : AUTH_FAILED;
+}
+
+// Accepts "Digest ..." or "Bearer <session token>"
+uint8_t authenticateRequest(const char* authorization, const char* method, const char* path, const IPAddress& clientIP) {
+  authNewDigestLogin = false;
+  if (strncmp(authorization, "Digest ", 7) == 0) {
+    return authenticateDigest(authorization + 7, method, path);
+  }
+  if (strncmp(authorization, "Bearer ", 7) == 0) {
+    return authenticateSessionToken(authorization + 7, clientIP);
+  }
+  return AUTH_MISSING;
+}
+
+// Value for a WWW-Authenticate header with a fresh nonce
+void formatDigestChallenge(char* out, size_t size, bool stale) {
+  char nonce[DIGEST_NONCE_SIZE];
+  snprintf(nonce, sizeof(nonce), "%08lx", (unsigned long)millis());
+  authMac('n', nonce, 8, nonce + 8, 8);
+  snprintf(out, size, "Digest realm=\"%s\", qop=\"auth\", nonce=\"%s\"%s",
+    authRealm, nonce, stale ? ", stale=true" : "");
+}
+
+// Bound to the client's address; valid for SESSION_TOKEN_TTL_MS
+void issueSessionToken(char* token, size_t size, const IPAddress& clientIP) {
+  char signedPart[24];
+  char mac[33];
+  sessionTokenData(signedPart, sizeof(signedPart), millis(), clientIP);
+  authMac('s', signedPart, strlen(signedPart), mac, 16);
+  snprintf(token, size, "%.8s.%s", signedPart, mac);
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <Arduino.h>
+
+// Staged startup. USB HID is started first in setup(); everything that can
+// fail or wait on the network is brought up one stage at a time from loop(),
+// so a missing access point or a bad config retries with backoff instead of
+// blocking or restarting the device.
+#define BOOT_STAGE_CONFIG   0
+#define BOOT_STAGE_WIFI     1
+#define BOOT_STAGE_SERVICES 2  // OTA, web server, live channel, announcement
+#define BOOT_STAGE_READY    3
+#define BOOT_STAGE_COUNT    3  // Stages that complete
+
+#define BOOT_RETRY_MIN_MS     1000
+#define BOOT_RETRY_MAX_MS     60000
+#define BOOT_WIFI_TIMEOUT_MS  15000  // Per connection attempt
+
+// Startup state structure
+typedef struct {
+  uint8_t stage;
+  bool attempting;                      // An attempt at the stage is in progress
+  uint16_t attempts;                    // At the current stage
+  uint32_t attemptStartMs;
+  uint32_t retryAtMs;
+  uint32_t retryDelayMs;
+  uint32_t hidReadyMs;                  // Host enumerated the keyboard; 0 until then
+  uint32_t completedMs[BOOT_STAGE_COUNT]; // First completion since power-on; 0 until then
+  uint16_t firstAttempts[BOOT_STAGE_COUNT];
+  uint16_t wifiReconnects;
+} BootState;
+
+// Global startup state
+extern BootState bootState;
+
+// Function declarations
+const char* bootStageName(uint8_t stage);
+bool isBootRetryDue();
+void startBootAttempt();
+void completeBootStage();
+void failBootStage(const char* reason);
+void restartBootStage(uint8_t stage);
+void markHidReady();
+void printBootTimings();
+size_t formatBootTimings(char* out, size_t size);
+
+// Implementation
+BootState bootState = {BOOT_STAGE_CONFIG, false, 0, 0, 0, BOOT_RETRY_MIN_MS, 0, {0}, {0}, 0};
+
+const char* bootStageName(uint8_t stage) {
+  switch (stage) {
+    case BOOT_STAGE_CONFIG:   return "config";
+    case BOOT_STAGE_WIFI:     return "wifi";
+    case BOOT_STAGE_SERVICES: return "web";
+    default:                  return "ready";
+  }
+}
+
+// Whether the backoff after the last failure has passed
+bool isBootRetryDue() {
+  return (int32_t)(millis() - bootState.retryAtMs) >= 0;
+}
+
+void startBootAttempt() {
+  bootState.attempting = true;
+  bootState.attempts++;
+  bootState.attemptStartMs = millis();
+}
+
+// Logs the stage time and moves on to the next stage
+void completeBootStage() {
+  uint8_t stage = bootState.stage;
+  uint32_t now = millis();
+  Serial.printf("Boot: %s up at %lu ms (attempt %u, %lu ms)\n", bootStageName(stage), (unsigned long)now,
+    bootState.attempts, (unsigned long)(now - bootState.attemptStartMs));
+
+  if (bootState.completedMs[stage] == 0) {
+    bootState.completedMs[stage] = now;
+    bootState.firstAttempts[stage] = bootState.attempts;
+  }
+  bootState.stage = stage + 1;
+  bootState.attempting = false;
+  bootState.attempts = 0;
+  bootState.retryAtMs = now;
+  bootState.retryDelayMs = BOOT_RETRY_MIN_MS;
+}
+
+// Retry the current stage after an exponentially growing delay
+void failBootStage(const char* reason) {
+  Serial.printf("Boot: %s failed (%s), retrying in %lu ms\n", bootStageName(bootState.stage), reason,
+    (unsigned long)bootState.retryDelayMs);
+  bootState.attempting = false;
+  bootState.retryAtMs = millis() + bootState.retryDelayMs;
+  bootState.retryDelayMs = bootState.retryDelayMs * 2 > BOOT_RETRY_MAX_MS ? BOOT_RETRY_MAX_MS : bootState.retryDelayMs * 2;
+}
+
+// Go back to an earlier stage, e.g. WiFi after the connection drops
+void restartBootStage(uint8_t stage) {
+  Serial.printf("Boot: restarting from %s\n", bootStageName(stage));
+  if (stage == BOOT_STAGE_WIFI) bootState.wifiReconnects++;
+  bootState.stage = stage;
+  bootState.attempting = false;
+  bootState.attempts = 0;
+  bootState.retryAtMs = millis();
+  bootState.retryDelayMs = BOOT_RETRY_MIN_MS;
+}
+
+void markHidReady() {
+  bootState.hidReadyMs = millis();
+  Serial.printf("Boot: hid up at %lu ms\n", (unsigned long)bootState.hidReadyMs);
+}
+
+// One-line breakdown once everything is up
+void printBootTimings() {
+  Serial.printf("Boot: hid %lu ms, config %lu ms, wifi %lu ms (%u attempts), web %lu ms\n",
+    (unsigned long)bootState.hidReadyMs, (unsigned long)bootState.completedMs[BOOT_STAGE_CONFIG],
+    (unsigned long)bootState.completedMs[BOOT_STAGE_WIFI], bootState.firstAttempts[BOOT_STAGE_WIFI],
+    (unsigned long)bootState.completedMs[BOOT_STAGE_SERVICES]);
+}
+
+// JSON object for /status; times are millis() since power-on, null until reached
+size_t formatBootTimings(char* out, size_t size) {
+  int length = snprintf(out, size, "{\"stage\":\"%s\"", bootStageName(bootState.stage));
+  const char* names[] = {"hid_ms", "config_ms", "wifi_ms", "web_ms"};
+  for (int i = 0; i < 4 && length > 0 && (size_t)length < size; i++) {
+    uint32_t at = i == 0 ? bootState.hidReadyMs : bootState.completedMs[i - 1];
+    if (at) {
+      length += snprintf(out + length, size - length, ",\"%s\":%lu", names[i], (unsigned long)at);
+    } else {
+      length += snprintf(out + length, size - length, ",\"%s\":null", names[i]);
+    }
+  }
+  if (length > 0 && (size_t)length < size) {
+    length += snprintf(out + length, size - length, ",\"wifi_attempts\":%u,\"wifi_reconnects\":%u}",
+      bootState.firstAttempts[BOOT_STAGE_WIFI] ? bootState.firstAttempts[BOOT_STAGE_WIFI] :
+        bootState.stage == BOOT_STAGE_WIFI ? bootState.attempts : 0,
+      bootState.wifiReconnects);
+  }
+  return length > 0 && (size_t)length < size ? length : 0;
+}
+
+#endif
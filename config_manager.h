@@ -3,21 +3,181 @@
 
 #include <Arduino.h>
 #include <LittleFS.h>
-#include <map>
+#include "keystroke_compiler.h"
+#include "program_cache.h"
+
+// Longest line accepted in /config.txt
+#define CONFIG_LINE_SIZE 192
+
+// Device configuration, parsed once from /config.txt. String fields are
+// NUL-terminated and sized for the longest value accepted.
+typedef struct {
+  char ssid[33];
+  char password[65];
+  char username[33];
+  char userpass[65];
+  char pageName[33];
+  char slackWebhook[129];
+  char slackHost[65];
+  uint16_t slackPort;
+  bool slackTls;
+  uint16_t typingRateUs;
+  uint8_t layout;
+  bool coalesceReleases;
+  bool blockSubnet;
+  uint8_t programCacheKb;
+
+  // Derived values
+  char pagePath[34];      // "/" + pageName
+  char announcement[80];  // "http://<ip>/<pageName> ready", set once WiFi is up
+} DeviceConfig;
 
 // Global configuration storage
-extern std::map<String, String> deviceConfig;
+extern DeviceConfig deviceConfig;
 
 // Function declarations
 bool loadConfiguration();
-String getConfigValue(const String& key);
+void updateAnnouncement(const IPAddress& localIP);
 void printConfiguration();
 
 // Implementation
-std::map<String, String> deviceConfig;
+DeviceConfig deviceConfig;
+
+// Copy a value into a fixed-size field; fails instead of truncating
+bool setConfigString(char* field, size_t size, const char* value, const char* key) {
+  size_t length = strlen(value);
+  if (length >= size) {
+    Serial.printf("config.txt: value for '%s' is too long (max %u)\n", key, (unsigned)(size - 1));
+    return false;
+  }
+  memcpy(field, value, length + 1);
+  return true;
+}
+
+char* trimConfigText(char* text) {
+  while (isspace((unsigned char)*text)) text++;
+  char* end = text + strlen(text);
+  while (end > text && isspace((unsigned char)end[-1])) end--;
+  *end = '\0';
+  return text;
+}
+
+// "[http://|https://]host[:port]"; plain http is meant for a local test listener
+bool parseSlackHost(const char* value) {
+  DeviceConfig& config = deviceConfig;
+  config.slackTls = true;
+  config.slackPort = 443;
+  if (strncasecmp(value, "http://", 7) == 0) {
+    config.slackTls = false;
+    config.slackPort = 80;
+    value += 7;
+  } else if (strncasecmp(value, "https://", 8) == 0) {
+    value += 8;
+  }
+
+  const char* colon = strchr(value, ':');
+  size_t length = colon ? (size_t)(colon - value) : strlen(value);
+  if (length == 0 || length >= sizeof(config.slackHost)) {
+    Serial.printf("config.txt: invalid slack_host '%s'\n", value);
+    return false;
+  }
+  if (colon) {
+    char* end;
+    unsigned long port = strtoul(colon + 1, &end, 10);
+    if (*end != '\0' || port == 0 || port > 65535) {
+      Serial.printf("config.txt: invalid slack_host port '%s'\n", colon + 1);
+      return false;
+    }
+    config.slackPort = port;
+  }
+  memcpy(config.slackHost, value, length);
+  config.slackHost[length] = '\0';
+  return true;
+}
+
+// Parse one "key=value" line; blank lines and '#' comments are skipped
+bool parseConfigLine(char* line) {
+  char* text = trimConfigText(line);
+  if (*text == '\0' || *text == '#') {
+    return true;
+  }
+
+  char* separator = strchr(text, '=');
+  if (!separator || separator == text) {
+    Serial.printf("config.txt: ignoring malformed line '%s'\n", text);
+    return true;
+  }
+
+  *separator = '\0';
+  const char* key = trimConfigText(text);
+  const char* value = trimConfigText(separator + 1);
+  DeviceConfig& config = deviceConfig;
+
+  if (strcmp(key, "ssid") == 0) return setConfigString(config.ssid, sizeof(config.ssid), value, key);
+  if (strcmp(key, "password") == 0) return setConfigString(config.password, sizeof(config.password), value, key);
+  if (strcmp(key, "username") == 0) return setConfigString(config.username, sizeof(config.username), value, key);
+  if (strcmp(key, "userpass") == 0) return setConfigString(config.userpass, sizeof(config.userpass), value, key);
+  if (strcmp(key, "slack_webhook") == 0) return setConfigString(config.slackWebhook, sizeof(config.slackWebhook), value, key);
+
+  if (strcmp(key, "slack_host") == 0) return parseSlackHost(value);
+
+  if (strcmp(key, "pagename") == 0) {
+    while (*value == '/') value++;
+    return setConfigString(config.pageName, sizeof(config.pageName), value, key);
+  }
+
+  if (strcmp(key, "typing_rate") == 0) {
+    config.typingRateUs = parseTypingRate(value, 0);
+    if (config.typingRateUs == 0) {
+      Serial.printf("config.txt: invalid typing_rate '%s', using normal\n", value);
+      config.typingRateUs = TYPING_RATE_NORMAL_US;
+    }
+    return true;
+  }
+
+  if (strcmp(key, "layout") == 0) {
+    config.layout = parseKeyboardLayout(value, LAYOUT_COUNT);
+    if (config.layout == LAYOUT_COUNT) {
+      Serial.printf("config.txt: unknown layout '%s', using us\n", value);
+      config.layout = LAYOUT_US;
+    }
+    return true;
+  }
+
+  if (strcmp(key, "coalesce_releases") == 0) {
+    config.coalesceReleases = strcmp(value, "0") != 0;
+    return true;
+  }
+
+  if (strcmp(key, "block_subnet") == 0) {
+    config.blockSubnet = strcmp(value, "1") == 0;
+    return true;
+  }
+
+  if (strcmp(key, "program_cache_kb") == 0) {
+    char* end;
+    unsigned long kb = strtoul(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || kb > PROGRAM_CACHE_MAX_KB) {
+      Serial.printf("config.txt: program_cache_kb must be 0 to %u, using %u\n", PROGRAM_CACHE_MAX_KB, PROGRAM_CACHE_DEFAULT_KB);
+      kb = PROGRAM_CACHE_DEFAULT_KB;
+    }
+    config.programCacheKb = kb;
+    return true;
+  }
+
+  Serial.printf("config.txt: ignoring unknown key '%s'\n", key);
+  return true;
+}
 
 bool loadConfiguration() {
-  deviceConfig.clear();
+  memset(&deviceConfig, 0, sizeof(deviceConfig));
+  deviceConfig.typingRateUs = TYPING_RATE_NORMAL_US;
+  deviceConfig.layout = LAYOUT_US;
+  deviceConfig.coalesceReleases = KEYSTROKE_COALESCE_RELEASES;
+  deviceConfig.programCacheKb = PROGRAM_CACHE_DEFAULT_KB;
+  strcpy(deviceConfig.slackHost, "hooks.slack.com");
+  deviceConfig.slackPort = 443;
+  deviceConfig.slackTls = true;
 
   if (!LittleFS.begin()) {
     Serial.println("LittleFS mount failed");
@@ -30,33 +190,69 @@ bool loadConfiguration() {
     return false;
   }
 
+  bool valid = true;
+  char line[CONFIG_LINE_SIZE];
+  size_t length = 0;
+  bool overflow = false;
+
   while (configFile.available()) {
-    String line = configFile.readStringUntil('\n');
-    int separatorIndex = line.indexOf('=');
-    if (separatorIndex > 0) {
-      String key = line.substring(0, separatorIndex);
-      String value = line.substring(separatorIndex + 1);
-      value.trim();
-      deviceConfig[key] = value;
+    int c = configFile.read();
+    if (c != '\n') {
+      if (length < sizeof(line) - 1) {
+        line[length++] = c;
+      } else {
+        overflow = true;
+      }
+      if (configFile.available()) continue;
+    }
+
+    line[length] = '\0';
+    if (overflow) {
+      Serial.println("config.txt: line too long");
+      valid = false;
+    } else if (!parseConfigLine(line)) {
+      valid = false;
     }
+    length = 0;
+    overflow = false;
   }
 
   configFile.close();
-  return true;
+
+  // Validation
+  if (deviceConfig.ssid[0] == '\0') {
+    Serial.println("config.txt: ssid is required");
+    valid = false;
+  }
+  if (deviceConfig.username[0] == '\0' || deviceConfig.userpass[0] == '\0') {
+    Serial.println("config.txt: username and userpass are required");
+    valid = false;
+  }
+
+  snprintf(deviceConfig.pagePath, sizeof(deviceConfig.pagePath), "/%s", deviceConfig.pageName);
+  return valid;
 }
 
-String getConfigValue(const String& key) {
-  return deviceConfig.count(key) ? deviceConfig[key] : "";
+// Build the daily "ready" message once the device has an address
+void updateAnnouncement(const IPAddress& localIP) {
+  snprintf(deviceConfig.announcement, sizeof(deviceConfig.announcement), "http://%u.%u.%u.%u%s ready",
+    localIP[0], localIP[1], localIP[2], localIP[3], deviceConfig.pagePath);
 }
 
 void printConfiguration() {
-    for (const auto& pair : deviceConfig) {
-      Serial.print("Key: '");
-      Serial.print(pair.first);
-      Serial.print("' => Value: '");
-      Serial.print(pair.second);
-      Serial.println("'");
-    }
+  const DeviceConfig& config = deviceConfig;
+  Serial.printf("ssid: '%s'\n", config.ssid);
+  Serial.printf("password: '%s'\n", config.password);
+  Serial.printf("username: '%s'\n", config.username);
+  Serial.printf("userpass: '%s'\n", config.userpass);
+  Serial.printf("pagename: '%s' (path '%s')\n", config.pageName, config.pagePath);
+  Serial.printf("slack_webhook: '%s'\n", config.slackWebhook);
+  Serial.printf("slack_host: %s://%s:%u\n", config.slackTls ? "https" : "http", config.slackHost, config.slackPort);
+  Serial.printf("typing_rate: %u us\n", config.typingRateUs);
+  Serial.printf("layout: %u\n", config.layout);
+  Serial.printf("coalesce_releases: %d\n", config.coalesceReleases);
+  Serial.printf("block_subnet: %d\n", config.blockSubnet);
+  Serial.printf("program_cache_kb: %u\n", config.programCacheKb);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,221 @@
+#ifndef KEYBOARD_LAYOUTS_H
+#define KEYBOARD_LAYOUTS_H
+
+#include <stdint.h>
+#include <strings.h>
+
+#ifdef ARDUINO
+#include "Adafruit_TinyUSB.h"
+#else
+#include "class/hid/hid.h" // HID usage constants from the TinyUSB source tree
+#endif
+
+// Keyboard layouts of the target host
+#define LAYOUT_US    0
+#define LAYOUT_UK    1
+#define LAYOUT_DE    2
+#define LAYOUT_COUNT 3
+
+// HID key structure
+typedef struct {
+  uint8_t modifier;
+  uint8_t keycode;
+} HidKey;
+
+// ASCII to HID table for one layout. Dead keys (e.g. ^ on DE) only produce
+// their character once followed by a space.
+typedef struct {
+  HidKey keys[128];
+  uint32_t deadKeys[4];
+} AsciiLayout;
+
+// Function declarations
+HidKey convertAsciiToHid(char character, uint8_t layout = LAYOUT_US);
+bool isDeadKey(char character, uint8_t layout);
+uint8_t parseKeyboardLayout(const char* name, uint8_t fallback);
+
+// Implementation
+constexpr HidKey plainKey(uint8_t keycode) {
+  return {0, keycode};
+}
+
+constexpr HidKey shiftedKey(uint8_t keycode) {
+  return {KEYBOARD_MODIFIER_LEFTSHIFT, keycode};
+}
+
+// Third-level characters on ISO layouts (AltGr, reported as right Alt)
+constexpr HidKey altGrKey(uint8_t keycode) {
+  return {KEYBOARD_MODIFIER_RIGHTALT, keycode};
+}
+
+constexpr HidKey usLayoutKey(char character) {
+  if (character >= 'a' && character <= 'z') return plainKey(HID_KEY_A + (character - 'a'));
+  if (character >= 'A' && character <= 'Z') return shiftedKey(HID_KEY_A + (character - 'A'));
+  if (character >= '1' && character <= '9') return plainKey(HID_KEY_1 + (character - '1'));
+
+  // Handle symbols and punctuation
+  switch (character) {
+    case '0':  return plainKey(HID_KEY_0);
+    case ' ':  return plainKey(HID_KEY_SPACE);
+    case '\t': return plainKey(HID_KEY_TAB);
+    case '\n': return plainKey(HID_KEY_ENTER);
+    case '!':  return shiftedKey(HID_KEY_1);
+    case '@':  return shiftedKey(HID_KEY_2);
+    case '#':  return shiftedKey(HID_KEY_3);
+    case '$':  return shiftedKey(HID_KEY_4);
+    case '%':  return shiftedKey(HID_KEY_5);
+    case '^':  return shiftedKey(HID_KEY_6);
+    case '&':  return shiftedKey(HID_KEY_7);
+    case '*':  return shiftedKey(HID_KEY_8);
+    case '(':  return shiftedKey(HID_KEY_9);
+    case ')':  return shiftedKey(HID_KEY_0);
+    case '-':  return plainKey(HID_KEY_MINUS);
+    case '_':  return shiftedKey(HID_KEY_MINUS);
+    case '=':  return plainKey(HID_KEY_EQUAL);
+    case '+':  return shiftedKey(HID_KEY_EQUAL);
+    case '[':  return plainKey(HID_KEY_BRACKET_LEFT);
+    case '{':  return shiftedKey(HID_KEY_BRACKET_LEFT);
+    case ']':  return plainKey(HID_KEY_BRACKET_RIGHT);
+    case '}':  return shiftedKey(HID_KEY_BRACKET_RIGHT);
+    case '\\': return plainKey(HID_KEY_BACKSLASH);
+    case '|':  return shiftedKey(HID_KEY_BACKSLASH);
+    case ';':  return plainKey(HID_KEY_SEMICOLON);
+    case ':':  return shiftedKey(HID_KEY_SEMICOLON);
+    case '\'': return plainKey(HID_KEY_APOSTROPHE);
+    case '"':  return shiftedKey(HID_KEY_APOSTROPHE);
+    case '`':  return plainKey(HID_KEY_GRAVE);
+    case '~':  return shiftedKey(HID_KEY_GRAVE);
+    case ',':  return plainKey(HID_KEY_COMMA);
+    case '<':  return shiftedKey(HID_KEY_COMMA);
+    case '.':  return plainKey(HID_KEY_PERIOD);
+    case '>':  return shiftedKey(HID_KEY_PERIOD);
+    case '/':  return plainKey(HID_KEY_SLASH);
+    case '?':  return shiftedKey(HID_KEY_SLASH);
+  }
+  return {0, 0};
+}
+
+// UK (ISO): differs from US only around the extra key next to left shift
+constexpr HidKey ukLayoutKey(char character) {
+  switch (character) {
+    case '"':  return shiftedKey(HID_KEY_2);
+    case '@':  return shiftedKey(HID_KEY_APOSTROPHE);
+    case '#':  return plainKey(HID_KEY_EUROPE_1);
+    case '~':  return shiftedKey(HID_KEY_EUROPE_1);
+    case '\\': return plainKey(HID_KEY_EUROPE_2);
+    case '|':  return shiftedKey(HID_KEY_EUROPE_2);
+  }
+  return usLayoutKey(character);
+}
+
+// German (QWERTZ, ISO)
+constexpr HidKey deLayoutKey(char character) {
+  switch (character) {
+    case 'y':  return plainKey(HID_KEY_Z);
+    case 'Y':  return shiftedKey(HID_KEY_Z);
+    case 'z':  return plainKey(HID_KEY_Y);
+    case 'Z':  return shiftedKey(HID_KEY_Y);
+    case '"':  return shiftedKey(HID_KEY_2);
+    case '&':  return shiftedKey(HID_KEY_6);
+    case '/':  return shiftedKey(HID_KEY_7);
+    case '(':  return shiftedKey(HID_KEY_8);
+    case ')':  return shiftedKey(HID_KEY_9);
+    case '=':  return shiftedKey(HID_KEY_0);
+    case '?':  return shiftedKey(HID_KEY_MINUS);
+    case '\\': return altGrKey(HID_KEY_MINUS);
+    case '`':  return shiftedKey(HID_KEY_EQUAL);
+    case '+':  return plainKey(HID_KEY_BRACKET_RIGHT);
+    case '*':  return shiftedKey(HID_KEY_BRACKET_RIGHT);
+    case '~':  return altGrKey(HID_KEY_BRACKET_RIGHT);
+    case '#':  return plainKey(HID_KEY_EUROPE_1);
+    case '\'': return shiftedKey(HID_KEY_EUROPE_1);
+    case '^':  return plainKey(HID_KEY_GRAVE);
+    case ';':  return shiftedKey(HID_KEY_COMMA);
+    case ':':  return shiftedKey(HID_KEY_PERIOD);
+    case '-':  return plainKey(HID_KEY_SLASH);
+    case '_':  return shiftedKey(HID_KEY_SLASH);
+    case '<':  return plainKey(HID_KEY_EUROPE_2);
+    case '>':  return shiftedKey(HID_KEY_EUROPE_2);
+    case '|':  return altGrKey(HID_KEY_EUROPE_2);
+    case '@':  return altGrKey(HID_KEY_Q);
+    case '{':  return altGrKey(HID_KEY_7);
+    case '[':  return altGrKey(HID_KEY_8);
+    case ']':  return altGrKey(HID_KEY_9);
+    case '}':  return altGrKey(HID_KEY_0);
+  }
+  return usLayoutKey(character);
+}
+
+constexpr bool isDeadLayoutKey(uint8_t layout, char character) {
+  return layout == LAYOUT_DE && (character == '^' || character == '`');
+}
+
+constexpr HidKey layoutKey(uint8_t layout, char character) {
+  return layout == LAYOUT_UK ? ukLayoutKey(character)
+       : layout == LAYOUT_DE ? deLayoutKey(character)
+       : usLayoutKey(character);
+}
+
+template <uint8_t Layout>
+constexpr AsciiLayout buildAsciiLayout() {
+  static_assert(Layout < LAYOUT_COUNT, "Unknown keyboard layout");
+  AsciiLayout table = {};
+  for (int c = 0; c < 128; ++c) {
+    table.keys[c] = layoutKey(Layout, (char)c);
+    if (isDeadLayoutKey(Layout, (char)c)) {
+      table.deadKeys[c / 32] |= 1UL << (c % 32);
+    }
+  }
+  return table;
+}
+
+// Every printable character must be typeable and map to its own key combination
+constexpr bool isRoundTripLayout(const AsciiLayout& table) {
+  for (int a = ' '; a < 127; ++a) {
+    if (table.keys[a].keycode == 0) return false;
+    for (int b = a + 1; b < 127; ++b) {
+      if (table.keys[a].keycode == table.keys[b].keycode &&
+          table.keys[a].modifier == table.keys[b].modifier) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Indexed by LAYOUT_*
+constexpr AsciiLayout ASCII_LAYOUTS[LAYOUT_COUNT] = {
+  buildAsciiLayout<LAYOUT_US>(),
+  buildAsciiLayout<LAYOUT_UK>(),
+  buildAsciiLayout<LAYOUT_DE>()
+};
+
+static_assert(isRoundTripLayout(ASCII_LAYOUTS[LAYOUT_US]), "US layout table is incomplete or ambiguous");
+static_assert(isRoundTripLayout(ASCII_LAYOUTS[LAYOUT_UK]), "UK layout table is incomplete or ambiguous");
+static_assert(isRoundTripLayout(ASCII_LAYOUTS[LAYOUT_DE]), "DE layout table is incomplete or ambiguous");
+
+HidKey convertAsciiToHid(char character, uint8_t layout) {
+  if ((unsigned char)character >= 128 || layout >= LAYOUT_COUNT) {
+    return {0, 0};
+  }
+  return ASCII_LAYOUTS[layout].keys[(unsigned char)character];
+}
+
+bool isDeadKey(char character, uint8_t layout) {
+  if ((unsigned char)character >= 128 || layout >= LAYOUT_COUNT) {
+    return false;
+  }
+  unsigned char c = character;
+  return ASCII_LAYOUTS[layout].deadKeys[c / 32] & (1UL << (c % 32));
+}
+
+// Accepts us, uk (or gb) and de, case-insensitively
+uint8_t parseKeyboardLayout(const char* name, uint8_t fallback) {
+  if (!name || !*name) return fallback;
+  if (strcasecmp(name, "us") == 0) return LAYOUT_US;
+  if (strcasecmp(name, "uk") == 0 || strcasecmp(name, "gb") == 0) return LAYOUT_UK;
+  if (strcasecmp(name, "de") == 0) return LAYOUT_DE;
+  return fallback;
+}
+
+#endif
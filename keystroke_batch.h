@@ -0,0 +1,703 @@
+#ifndef KEYSTROKE_BATCH_H
+#define KEYSTROKE_BATCH_H
+
+#include <Arduino.h>
+#include "keystroke_compiler.h"
+#include "macro_store.h"
+#include "program_cache.h"
+
+// A batch is a list of steps, one per line, compiled into a single program:
+//
+//   TEXT <text>        typed exactly as written
+//   STRING <text>      typed as written, except for \n (ENTER), \t (TAB), \\ and \xHH
+//   KEYS <keys>        key names and chords, e.g. "CTRL+ALT+T" or "ENTER TAB"
+//   HOLD <keys>        keys or modifiers kept down through the steps that follow
+//   RELEASE [<keys>]   let go of the given held keys, or of all of them
+//   WAIT <ms>          pause (DELAY is the same)
+//   RATE <rate>        typing rate for the following steps (fast, normal, safe or us)
+//   MACRO <name>       a stored macro, played at its own rate
+//   REPEAT <n> <step>  one step played n times, e.g. "REPEAT 40 KEYS DOWN"
+//   REPEAT <n> {       the steps up to the matching "}" played n times
+//
+// Blank lines and lines starting with '#' are ignored. Every step is checked
+// before anything is queued, so a bad line never leaves a half-typed batch.
+// A repeat stays in the program as one HID_OP_REPEAT step that the job feeder
+// follows, so its size does not grow with n. Keys still held at the end are
+// released.
+//
+// Ducky Script payloads are imported line by line: REM, STRING, STRINGLN,
+// DELAY, DEFAULT_DELAY, REPEAT, HOLD, RELEASE and key lines such as "GUI r".
+#define BATCH_MAX_STEPS   256
+#define BATCH_MAX_REPORTS 4096    // 32 KB of compiled reports
+#define BATCH_MAX_PLAYED  1048576 // Reports sent to the host, with repeats unrolled
+#define BATCH_MAX_REPEAT  65535
+#define BATCH_MAX_WAIT_MS 600000
+#define BATCH_ERROR_SIZE  80
+
+// Longest key line of a Ducky Script payload
+#define BATCH_DUCKY_LINE_SIZE 96
+
+// Input formats
+#define BATCH_FORMAT_STEPS 0
+#define BATCH_FORMAT_DUCKY 1
+#define BATCH_FORMAT_COUNT 2
+
+// Step counts, for the response and the audit notification
+typedef struct {
+  uint16_t steps;
+  uint16_t text;
+  uint16_t keys;
+  uint16_t waits;
+  uint16_t macros;
+  uint32_t estimatedMs;
+  char error[BATCH_ERROR_SIZE];   // Set when compilation fails
+} BatchSummary;
+
+// REPEAT block waiting for its "}"
+typedef struct {
+  size_t start;          // Its HID_OP_REPEAT step
+  size_t line;
+  uint8_t heldModifier;  // Held keys when it opened; the body must end with the same
+  uint8_t heldKeys[6];
+} BatchBlock;
+
+// Compiler state carried from one step to the next
+typedef struct {
+  KeystrokeProgram* program;
+  KeystrokeOptions options;
+  uint16_t intervalUs;
+  size_t line;
+  uint8_t heldModifier;     // Named modifiers plus those the held keys need
+  uint8_t heldKeys[6];      // Keys down through HOLD, packed from the front
+  uint8_t namedModifier;    // Modifiers held by name, e.g. HOLD SHIFT
+  uint8_t keyModifiers[6];  // Modifier each held key was typed with, e.g. SHIFT for A
+  uint8_t depth;            // Repeats around the current step
+  uint8_t blockCount;
+  BatchBlock blocks[KEYSTROKE_REPEAT_DEPTH];
+
+  // Ducky Script import only
+  size_t commandStart;      // Steps of the previous command, for REPEAT
+  size_t commandEnd;
+  uint16_t defaultDelayMs;
+} BatchState;
+
+// Function declarations
+bool compileKeystrokeBatch(const char* body, size_t length, KeystrokeProgram& program,
+                           const KeystrokeOptions& options, uint16_t intervalUs, BatchSummary& summary,
+                           uint8_t format = BATCH_FORMAT_STEPS);
+uint8_t parseBatchFormat(const char* value, uint8_t fallback);
+void formatBatchSummary(const BatchSummary& summary, char* out, size_t size);
+
+// Implementation
+
+// Ducky Script key names that differ from ours
+const struct { const char* ducky; const char* name; } DUCKY_KEY_NAMES[] = {
+  {"CONTROL", "CTRL"}, {"WINDOWS", "GUI"}, {"COMMAND", "CMD"}, {"OPTION", "ALT"}, {"ESCAPE", "ESC"},
+  {"UPARROW", "UP"}, {"DOWNARROW", "DOWN"}, {"LEFTARROW", "LEFT"}, {"RIGHTARROW", "RIGHT"},
+  {"PRINTSCREEN", "PRTSCRN"}, {"SCROLLLOCK", "SCRLLOCK"}, {"BREAK", "PAUSE"},
+};
+
+// A key name or a single typeable character; modifier names only within a
+// chord, media keys only on their own
+bool isValidBatchKey(const char* key, size_t length, uint8_t layout, bool inChord) {
+  uint8_t modifier;
+  uint16_t usage;
+  HidKey hk;
+  if (length == 0) return false;
+  if (lookupSpecialKey(key, length, hk, layout)) return true;
+  if (inChord && lookupModifierKey(key, length, modifier)) return true;
+  if (!inChord && lookupMediaKey(key, length, usage)) return true;
+  return length == 1 && convertAsciiToHid(key[0], layout).keycode != 0;
+}
+
+bool isValidBatchToken(const char* token, size_t length, uint8_t layout) {
+  if (length > 1 && memchr(token, '+', length)) {
+    size_t start = 0;
+    while (start <= length) {
+      size_t end = start;
+      while (end < length && token[end] != '+') end++;
+      if (!isValidBatchKey(token + start, end - start, layout, true)) return false;
+      start = end + 1;
+    }
+    return true;
+  }
+  return isValidBatchKey(token, length, layout, false);
+}
+
+// Reports of a stored macro, inlined so the whole batch is one job
+bool appendBatchMacro(const char* name, BatchState& state, BatchSummary& summary) {
+  KeystrokeProgram& program = *state.program;
+  File file;
+  MacroHeader header;
+  if (!openMacro(name, file, header)) {
+    snprintf(summary.error, sizeof(summary.error), "unknown macro '%.24s'", name);
+    return false;
+  }
+  if (program.size() + header.reportCount + 2 > BATCH_MAX_REPORTS) {
+    file.close();
+    snprintf(summary.error, sizeof(summary.error), "batch longer than %d reports", BATCH_MAX_REPORTS);
+    return false;
+  }
+
+  appendTypingRate(program, header.intervalUs);
+  size_t start = program.size();
+  program.resize(start + header.reportCount);
+  size_t bytes = header.reportCount * sizeof(HidReport);
+  bool complete = file.read((uint8_t*)(program.data() + start), bytes) == bytes;
+  file.close();
+  if (!complete || fnv1a64(program.data() + start, bytes) != header.digest) {
+    snprintf(summary.error, sizeof(summary.error), "macro '%.24s' is damaged", name);
+    return false;
+  }
+
+  // Stored macros hold no repeats (see finishMacroFile()); one that does
+  // would play differently here than from /macro/<name>
+  for (size_t i = start; i < program.size(); i++) {
+    if (program[i].opcode == HID_OP_REPEAT) {
+      snprintf(summary.error, sizeof(summary.error), "macro '%.24s' is damaged", name);
+      return false;
+    }
+  }
+  appendTypingRate(program, state.intervalUs);
+  return true;
+}
+
+bool compileBatchText(const char* text, size_t length, BatchState& state, BatchSummary& summary) {
+  for (size_t i = 0; i < length; i++) {
+    if (convertAsciiToHid(text[i], state.options.layout).keycode == 0) {
+      snprintf(summary.error, sizeof(summary.error), "character 0x%02x cannot be typed", (uint8_t)text[i]);
+      return false;
+    }
+  }
+  KeystrokeStream stream;
+  beginKeystrokeStream(stream, *state.program, state.options, true);
+  feedKeystrokeStream(stream, text, length);
+  endKeystrokeStream(stream);
+  summary.text++;
+  return true;
+}
+
+int hexDigitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// TEXT with backslash escapes, one character at a time through the same stream
+bool compileBatchString(const char* text, size_t length, BatchState& state, BatchSummary& summary) {
+  KeystrokeStream stream;
+  beginKeystrokeStream(stream, *state.program, state.options, true);
+
+  for (size_t i = 0; i < length; i++) {
+    char c = text[i];
+    if (c == '\\') {
+      char escape = i + 1 < length ? text[++i] : '\0';
+      int high = i + 2 < length ? hexDigitValue(text[i + 1]) : -1;
+      int low = i + 2 < length ? hexDigitValue(text[i + 2]) : -1;
+      if (escape == 'n') {
+        c = '\n';
+      } else if (escape == 't') {
+        c = '\t';
+      } else if (escape == '\\') {
+        c = '\\';
+      } else if (escape == 'x' && high >= 0 && low >= 0) {
+        c = (char)(high << 4 | low);
+        i += 2;
+      } else {
+        snprintf(summary.error, sizeof(summary.error), "unknown escape '\\%c'", escape ? escape : ' ');
+        return false;
+      }
+    }
+    if (convertAsciiToHid(c, state.options.layout).keycode == 0) {
+      snprintf(summary.error, sizeof(summary.error), "character 0x%02x cannot be typed", (uint8_t)c);
+      return false;
+    }
+    feedKeystrokeStream(stream, &c, 1);
+  }
+  endKeystrokeStream(stream);
+  summary.text++;
+  return true;
+}
+
+bool compileBatchKeys(const char* keys, size_t length, BatchState& state, BatchSummary& summary) {
+  size_t start = 0;
+  while (start < length) {
+    size_t end = start;
+    while (end < length && keys[end] != ' ') end++;
+    if (end > start && !isValidBatchToken(keys + start, end - start, state.options.layout)) {
+      snprintf(summary.error, sizeof(summary.error), "unknown key '%.*s'", (int)(end - start > 32 ? 32 : end - start), keys + start);
+      return false;
+    }
+    start = end + 1;
+  }
+  if (length == 0) {
+    snprintf(summary.error, sizeof(summary.error), "KEYS needs at least one key");
+    return false;
+  }
+  compileCachedKeystrokeSequence(keys, length, *state.program, state.options);
+  summary.keys++;
+  return true;
+}
+
+bool compileBatchWait(const char* value, BatchState& state, BatchSummary& summary) {
+  char* end = nullptr;
+  unsigned long ms = strtoul(value, &end, 10);
+  if (value[0] == '\0' || *end != '\0' || ms == 0 || ms > BATCH_MAX_WAIT_MS) {
+    snprintf(summary.error, sizeof(summary.error), "WAIT needs 1 to %lu ms", (unsigned long)BATCH_MAX_WAIT_MS);
+    return false;
+  }
+  while (ms > 0) {
+    uint16_t chunk = ms > 0xFFFF ? 0xFFFF : ms;
+    HidReport pause = {0, HID_OP_DELAY, {(uint8_t)(chunk & 0xFF), (uint8_t)(chunk >> 8)}};
+    state.program->push_back(pause);
+    ms -= chunk;
+  }
+  summary.waits++;
+  return true;
+}
+
+// The report for what HOLD currently keeps down
+void emitHeldKeys(BatchState& state) {
+  HidReport report = {state.heldModifier, HID_OP_REPORT, {0}};
+  memcpy(report.keycode, state.heldKeys, sizeof(report.keycode));
+  state.program->push_back(report);
+}
+
+// Adds the held keys to every report compiled since from, so they stay down
+bool applyHeldKeys(BatchState& state, size_t from, BatchSummary& summary) {
+  if (state.heldModifier == 0 && state.heldKeys[0] == 0) {
+    return true;
+  }
+
+  KeystrokeProgram& program = *state.program;
+  for (size_t i = from; i < program.size(); i++) {
+    HidReport& report = program[i];
+    if (report.opcode != HID_OP_REPORT) continue;
+    report.modifier |= state.heldModifier;
+    for (int k = 0; k < 6 && state.heldKeys[k]; k++) {
+      if (memchr(report.keycode, state.heldKeys[k], sizeof(report.keycode))) continue;
+      uint8_t* free = (uint8_t*)memchr(report.keycode, 0, sizeof(report.keycode));
+      if (!free) {
+        snprintf(summary.error, sizeof(summary.error), "more than 6 keys down with HOLD");
+        return false;
+      }
+      *free = state.heldKeys[k];
+    }
+  }
+  return true;
+}
+
+// A modifier stays down while it is held by name or a held key still needs it
+void updateHeldModifier(BatchState& state) {
+  state.heldModifier = state.namedModifier;
+  for (int k = 0; k < 6 && state.heldKeys[k]; k++) {
+    state.heldModifier |= state.keyModifiers[k];
+  }
+}
+
+// HOLD and RELEASE: keys separated by spaces or '+'
+bool compileBatchHold(const char* keys, size_t length, bool hold, BatchState& state, BatchSummary& summary) {
+  if (!hold && length == 0) {
+    state.namedModifier = 0;
+    memset(state.heldKeys, 0, sizeof(state.heldKeys));
+    memset(state.keyModifiers, 0, sizeof(state.keyModifiers));
+  }
+
+  size_t start = 0;
+  while (start < length) {
+    size_t end = start;
+    while (end < length && keys[end] != ' ' && keys[end] != '+') end++;
+    const char* key = keys + start;
+    size_t keyLength = end - start;
+    start = end + 1;
+    if (keyLength == 0) continue;
+
+    uint8_t modifier = 0;
+    HidKey hk = {0, 0};
+    if (!lookupModifierKey(key, keyLength, modifier) &&
+        !lookupSpecialKey(key, keyLength, hk, state.options.layout) && keyLength == 1) {
+      hk = convertAsciiToHid(key[0], state.options.layout);
+    }
+    if (modifier == 0 && hk.keycode == 0) {
+      snprintf(summary.error, sizeof(summary.error), "unknown key '%.*s'", (int)(keyLength > 32 ? 32 : keyLength), key);
+      return false;
+    }
+
+    uint8_t* held = (uint8_t*)memchr(state.heldKeys, hk.keycode, sizeof(state.heldKeys));
+    if (hold) {
+      state.namedModifier |= modifier;
+      if (hk.keycode != 0 && !held) {
+        held = (uint8_t*)memchr(state.heldKeys, 0, sizeof(state.heldKeys));
+        if (!held) {
+          snprintf(summary.error, sizeof(summary.error), "HOLD keeps at most 6 keys down");
+          return false;
+        }
+        *held = hk.keycode;
+      }
+      if (hk.keycode != 0) {
+        state.keyModifiers[held - state.heldKeys] = hk.modifier;
+      }
+    } else {
+      state.namedModifier &= ~modifier;
+      if (hk.keycode != 0 && held) {
+        size_t index = held - state.heldKeys;
+        memmove(held, held + 1, sizeof(state.heldKeys) - index - 1);
+        memmove(state.keyModifiers + index, state.keyModifiers + index + 1, sizeof(state.keyModifiers) - index - 1);
+        state.heldKeys[sizeof(state.heldKeys) - 1] = 0;
+        state.keyModifiers[sizeof(state.keyModifiers) - 1] = 0;
+      }
+    }
+  }
+
+  updateHeldModifier(state);
+  emitHeldKeys(state);
+  summary.keys++;
+  return true;
+}
+
+// Plays the steps from start to the end of the program times times in all
+bool wrapBatchRepeat(BatchState& state, size_t start, uint32_t times, BatchSummary& summary) {
+  KeystrokeProgram& program = *state.program;
+  size_t length = program.size() - start;
+  if (length > 0xFFFF) {
+    snprintf(summary.error, sizeof(summary.error), "REPEAT body longer than 65535 steps");
+    return false;
+  }
+  HidReport repeat = {0, HID_OP_REPEAT, {(uint8_t)(times & 0xFF), (uint8_t)(times >> 8),
+                                         (uint8_t)(length & 0xFF), (uint8_t)(length >> 8)}};
+  program.insert(program.begin() + start, repeat);
+  return true;
+}
+
+bool isSameHeldKeys(const BatchState& state, uint8_t modifier, const uint8_t keys[6]) {
+  return state.heldModifier == modifier && memcmp(state.heldKeys, keys, sizeof(state.heldKeys)) == 0;
+}
+
+bool compileBatchStep(const char* line, size_t length, BatchState& state, BatchSummary& summary);
+
+// "REPEAT <n> <step>" or "REPEAT <n> {"
+bool compileBatchRepeat(const char* argument, size_t length, BatchState& state, BatchSummary& summary) {
+  uint32_t times = 0;
+  size_t digits = 0;
+  while (digits < length && isdigit((unsigned char)argument[digits]) && times <= BATCH_MAX_REPEAT) {
+    times = times * 10 + (argument[digits++] - '0');
+  }
+  if (digits == 0 || times == 0 || times > BATCH_MAX_REPEAT || digits + 1 >= length || argument[digits] != ' ') {
+    snprintf(summary.error, sizeof(summary.error), "REPEAT needs a count from 1 to %d, then a step or {", BATCH_MAX_REPEAT);
+    return false;
+  }
+  if (state.depth >= KEYSTROKE_REPEAT_DEPTH) {
+    snprintf(summary.error, sizeof(summary.error), "REPEAT nested more than %d deep", KEYSTROKE_REPEAT_DEPTH);
+    return false;
+  }
+
+  const char* step = argument + digits + 1;
+  size_t stepLength = length - digits - 1;
+  KeystrokeProgram& program = *state.program;
+
+  if (stepLength == 1 && step[0] == '{') {
+    BatchBlock& block = state.blocks[state.blockCount++];
+    block.start = program.size();
+    block.line = state.line;
+    block.heldModifier = state.heldModifier;
+    memcpy(block.heldKeys, state.heldKeys, sizeof(block.heldKeys));
+    HidReport repeat = {0, HID_OP_REPEAT, {(uint8_t)(times & 0xFF), (uint8_t)(times >> 8)}};
+    program.push_back(repeat);
+    state.depth++;
+    return true;
+  }
+
+  size_t start = program.size();
+  uint8_t heldModifier = state.heldModifier;
+  uint8_t heldKeys[6];
+  memcpy(heldKeys, state.heldKeys, sizeof(heldKeys));
+  uint8_t blockCount = state.blockCount;
+
+  state.depth++;
+  bool compiled = compileBatchStep(step, stepLength, state, summary);
+  state.depth--;
+  if (!compiled) {
+    return false;
+  }
+  if (state.blockCount != blockCount) {
+    snprintf(summary.error, sizeof(summary.error), "a REPEAT step cannot open or close a block");
+    return false;
+  }
+  if (!isSameHeldKeys(state, heldModifier, heldKeys)) {
+    snprintf(summary.error, sizeof(summary.error), "HOLD and RELEASE must pair up inside a REPEAT");
+    return false;
+  }
+  return wrapBatchRepeat(state, start, times, summary);
+}
+
+// "}" ends the innermost REPEAT block
+bool closeBatchRepeat(BatchState& state, BatchSummary& summary) {
+  if (state.blockCount == 0) {
+    snprintf(summary.error, sizeof(summary.error), "} without REPEAT");
+    return false;
+  }
+  const BatchBlock& block = state.blocks[--state.blockCount];
+  state.depth--;
+  if (!isSameHeldKeys(state, block.heldModifier, block.heldKeys)) {
+    snprintf(summary.error, sizeof(summary.error), "HOLD and RELEASE must pair up inside a REPEAT");
+    return false;
+  }
+
+  HidReport& repeat = (*state.program)[block.start];
+  size_t length = state.program->size() - block.start - 1;
+  if (length > 0xFFFF) {
+    snprintf(summary.error, sizeof(summary.error), "REPEAT body longer than 65535 steps");
+    return false;
+  }
+  repeat.keycode[2] = length & 0xFF;
+  repeat.keycode[3] = length >> 8;
+  return true;
+}
+
+bool compileBatchStep(const char* line, size_t length, BatchState& state, BatchSummary& summary) {
+  if (length == 1 && line[0] == '}') {
+    return closeBatchRepeat(state, summary);
+  }
+
+  size_t commandLength = 0;
+  while (commandLength < length && line[commandLength] != ' ') commandLength++;
+  const char* argument = line + commandLength + (commandLength < length ? 1 : 0);
+  size_t argumentLength = line + length - argument;
+
+  // Arguments other than TEXT, STRING, KEYS and REPEAT are short; keep a terminated copy
+  char value[MACRO_NAME_MAX + 8];
+  if (argumentLength < sizeof(value)) {
+    memcpy(value, argument, argumentLength);
+    value[argumentLength] = '\0';
+  } else {
+    value[0] = '\0';
+  }
+
+  if (commandLength == 6 && strncmp(line, "REPEAT", 6) == 0) {
+    return compileBatchRepeat(argument, argumentLength, state, summary);
+  }
+
+  // Everything else presses keys or waits while HOLD keeps its keys down
+  size_t start = state.program->size();
+  bool compiled;
+
+  if (commandLength == 4 && strncmp(line, "TEXT", 4) == 0) {
+    compiled = compileBatchText(argument, argumentLength, state, summary);
+  } else if (commandLength == 6 && strncmp(line, "STRING", 6) == 0) {
+    compiled = compileBatchString(argument, argumentLength, state, summary);
+  } else if (commandLength == 4 && strncmp(line, "KEYS", 4) == 0) {
+    compiled = compileBatchKeys(argument, argumentLength, state, summary);
+  } else if (commandLength == 4 && strncmp(line, "HOLD", 4) == 0) {
+    if (argumentLength == 0) {
+      snprintf(summary.error, sizeof(summary.error), "HOLD needs at least one key");
+      return false;
+    }
+    return compileBatchHold(argument, argumentLength, true, state, summary);
+  } else if (commandLength == 7 && strncmp(line, "RELEASE", 7) == 0) {
+    return compileBatchHold(argument, argumentLength, false, state, summary);
+  } else if ((commandLength == 4 && strncmp(line, "WAIT", 4) == 0) ||
+             (commandLength == 5 && strncmp(line, "DELAY", 5) == 0)) {
+    return compileBatchWait(value, state, summary);
+  } else if (commandLength == 4 && strncmp(line, "RATE", 4) == 0) {
+    uint16_t rate = parseTypingRate(value, 0);
+    if (rate == 0) {
+      snprintf(summary.error, sizeof(summary.error), "RATE needs fast, normal, safe or microseconds");
+      return false;
+    }
+    state.intervalUs = rate;
+    appendTypingRate(*state.program, state.intervalUs);
+    return true;
+  } else if (commandLength == 5 && strncmp(line, "MACRO", 5) == 0) {
+    compiled = appendBatchMacro(value, state, summary);
+    if (compiled) summary.macros++;
+  } else {
+    snprintf(summary.error, sizeof(summary.error), "unknown step '%.*s'", (int)(commandLength > 16 ? 16 : commandLength), line);
+    return false;
+  }
+
+  return compiled && applyHeldKeys(state, start, summary);
+}
+
+// One line of a Ducky Script payload, compiled through the steps above
+bool compileDuckyLine(const char* line, size_t length, BatchState& state, BatchSummary& summary) {
+  size_t commandLength = 0;
+  while (commandLength < length && line[commandLength] != ' ') commandLength++;
+  const char* argument = line + commandLength + (commandLength < length ? 1 : 0);
+  size_t argumentLength = line + length - argument;
+  char value[16];
+  snprintf(value, sizeof(value), "%.*s", (int)(argumentLength < sizeof(value) ? argumentLength : sizeof(value) - 1), argument);
+  KeystrokeProgram& program = *state.program;
+
+  if (commandLength == 3 && strncmp(line, "REM", 3) == 0) {
+    summary.steps--;
+    return true;
+  }
+
+  if ((commandLength == 13 && strncmp(line, "DEFAULT_DELAY", 13) == 0) ||
+      (commandLength == 12 && strncmp(line, "DEFAULTDELAY", 12) == 0)) {
+    char* end = nullptr;
+    unsigned long ms = strtoul(value, &end, 10);
+    if (value[0] == '\0' || *end != '\0' || ms > BATCH_MAX_WAIT_MS) {
+      snprintf(summary.error, sizeof(summary.error), "DEFAULT_DELAY needs 0 to %lu ms", (unsigned long)BATCH_MAX_WAIT_MS);
+      return false;
+    }
+    state.defaultDelayMs = ms > 0xFFFF ? 0xFFFF : ms;
+    return true;
+  }
+
+  // REPEAT plays the previous command, with its default delay, n more times
+  if (commandLength == 6 && strncmp(line, "REPEAT", 6) == 0) {
+    char* end = nullptr;
+    unsigned long times = strtoul(value, &end, 10);
+    if (value[0] == '\0' || *end != '\0' || times == 0 || times >= BATCH_MAX_REPEAT) {
+      snprintf(summary.error, sizeof(summary.error), "REPEAT needs a count from 1 to %d", BATCH_MAX_REPEAT - 1);
+      return false;
+    }
+    if (state.commandEnd == state.commandStart) {
+      snprintf(summary.error, sizeof(summary.error), "REPEAT needs a command before it");
+      return false;
+    }
+    size_t count = state.commandEnd - state.commandStart;
+    size_t start = program.size();
+    program.resize(start + count);
+    std::copy(program.begin() + state.commandStart, program.begin() + state.commandEnd, program.begin() + start);
+    return wrapBatchRepeat(state, start, times, summary);
+  }
+
+  state.commandStart = program.size();
+  bool compiled;
+  if (commandLength == 6 && strncmp(line, "STRING", 6) == 0) {
+    compiled = compileBatchText(argument, argumentLength, state, summary) && applyHeldKeys(state, state.commandStart, summary);
+  } else if (commandLength == 8 && strncmp(line, "STRINGLN", 8) == 0) {
+    compiled = compileBatchText(argument, argumentLength, state, summary) &&
+               compileBatchKeys("ENTER", 5, state, summary) && applyHeldKeys(state, state.commandStart, summary);
+  } else if (commandLength == 5 && strncmp(line, "DELAY", 5) == 0) {
+    compiled = compileBatchWait(value, state, summary);
+  } else if ((commandLength == 4 && strncmp(line, "HOLD", 4) == 0) ||
+             (commandLength == 7 && strncmp(line, "RELEASE", 7) == 0)) {
+    compiled = compileBatchStep(line, length, state, summary);
+  } else {
+    // Key line: every key on it pressed together
+    char keys[BATCH_DUCKY_LINE_SIZE];
+    size_t keysLength = 0;
+    size_t start = 0;
+    while (start < length) {
+      size_t end = start;
+      while (end < length && line[end] != ' ') end++;
+      const char* key = line + start;
+      size_t keyLength = end - start;
+      start = end + 1;
+      if (keyLength == 0) continue;
+
+      for (const auto& entry : DUCKY_KEY_NAMES) {
+        if (strlen(entry.ducky) == keyLength && strncmp(entry.ducky, key, keyLength) == 0) {
+          key = entry.name;
+          keyLength = strlen(entry.name);
+          break;
+        }
+      }
+      if (keysLength + keyLength + 1 >= sizeof(keys)) {
+        snprintf(summary.error, sizeof(summary.error), "key line longer than %d characters", BATCH_DUCKY_LINE_SIZE - 1);
+        return false;
+      }
+      if (keysLength > 0) keys[keysLength++] = '+';
+      memcpy(keys + keysLength, key, keyLength);
+      keysLength += keyLength;
+    }
+    compiled = compileBatchKeys(keys, keysLength, state, summary) && applyHeldKeys(state, state.commandStart, summary);
+  }
+
+  if (compiled && state.defaultDelayMs > 0) {
+    HidReport pause = {0, HID_OP_DELAY, {(uint8_t)(state.defaultDelayMs & 0xFF), (uint8_t)(state.defaultDelayMs >> 8)}};
+    program.push_back(pause);
+  }
+  state.commandEnd = program.size();
+  return compiled;
+}
+
+// On failure summary.error names the first bad line and program is left empty
+bool compileKeystrokeBatch(const char* body, size_t length, KeystrokeProgram& program,
+                           const KeystrokeOptions& options, uint16_t intervalUs, BatchSummary& summary,
+                           uint8_t format) {
+  memset(&summary, 0, sizeof(summary));
+  BatchState state;
+  memset(&state, 0, sizeof(state));
+  state.program = &program;
+  state.options = options;
+  state.intervalUs = intervalUs;
+  appendTypingRate(program, intervalUs);
+
+  size_t start = 0;
+  while (start < length && !summary.error[0]) {
+    size_t end = start;
+    while (end < length && body[end] != '\n') end++;
+    size_t lineLength = end - start;
+    if (lineLength > 0 && body[end - 1] == '\r') lineLength--;
+    state.line++;
+
+    const char* line = body + start;
+    start = end + 1;
+    if (format == BATCH_FORMAT_DUCKY) {
+      while (lineLength > 0 && (*line == ' ' || *line == '\t')) {
+        line++;
+        lineLength--;
+      }
+    }
+    if (lineLength == 0 || line[0] == '#') {
+      continue;
+    }
+
+    if (++summary.steps > BATCH_MAX_STEPS) {
+      snprintf(summary.error, sizeof(summary.error), "more than %d steps", BATCH_MAX_STEPS);
+    } else if ((format == BATCH_FORMAT_DUCKY ? compileDuckyLine(line, lineLength, state, summary)
+                                             : compileBatchStep(line, lineLength, state, summary)) &&
+               program.size() > BATCH_MAX_REPORTS) {
+      snprintf(summary.error, sizeof(summary.error), "batch longer than %d reports", BATCH_MAX_REPORTS);
+    }
+  }
+
+  if (!summary.error[0] && state.blockCount > 0) {
+    state.line = state.blocks[state.blockCount - 1].line;
+    snprintf(summary.error, sizeof(summary.error), "REPEAT has no closing }");
+  }
+  if (summary.error[0]) {
+    char error[BATCH_ERROR_SIZE];
+    snprintf(error, sizeof(error), "line %u: %.64s", (unsigned)state.line, summary.error);
+    memcpy(summary.error, error, sizeof(error));
+    program.clear();
+    return false;
+  }
+
+  if (summary.steps == 0) {
+    snprintf(summary.error, sizeof(summary.error), "empty batch");
+    program.clear();
+    return false;
+  }
+  if (state.heldModifier != 0 || state.heldKeys[0] != 0) {
+    HidReport release = {0, HID_OP_REPORT, {0}};
+    program.push_back(release);
+  }
+  if (countPlayedReports(program.data(), program.size()) > BATCH_MAX_PLAYED) {
+    snprintf(summary.error, sizeof(summary.error), "batch plays more than %d reports", BATCH_MAX_PLAYED);
+    program.clear();
+    return false;
+  }
+  summary.estimatedMs = estimateKeystrokeProgramMs(program, intervalUs);
+  return true;
+}
+
+// "steps" (the default) or "ducky"; anything else gives fallback
+uint8_t parseBatchFormat(const char* value, uint8_t fallback) {
+  if (!value || !*value || strcasecmp(value, "steps") == 0) return BATCH_FORMAT_STEPS;
+  if (strcasecmp(value, "ducky") == 0) return BATCH_FORMAT_DUCKY;
+  return fallback;
+}
+
+// e.g. "5 steps: 2 text, 2 keys, 1 wait, 0 macros"
+void formatBatchSummary(const BatchSummary& summary, char* out, size_t size) {
+  snprintf(out, size, "%u steps: %u text, %u keys, %u waits, %u macros", (unsigned)summary.steps,
+    (unsigned)summary.text, (unsigned)summary.keys, (unsigned)summary.waits, (unsigned)summary.macros);
+}
+
+#endif
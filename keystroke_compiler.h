@@ -0,0 +1,694 @@
+#ifndef KEYSTROKE_COMPILER_H
+#define KEYSTROKE_COMPILER_H
+
+// Keystroke sequence compiler. Turns text such as "Hello CTRL+ALT+DEL" into a
+// flat program of boot keyboard reports. Kept free of Arduino and USB stack
+// dependencies so it can be built and measured on a host.
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <vector>
+#include "keyboard_layouts.h"
+
+// Typing rate profiles: minimum microseconds between two reports.
+// Reports are also never sent before the host has collected the previous one.
+#define TYPING_RATE_FAST_US   1000  // One report per 1 ms poll interval
+#define TYPING_RATE_NORMAL_US 2000
+#define TYPING_RATE_SAFE_US   10000 // Slow targets such as the FileVault pre-boot screen
+
+// Go straight from one key to the next when they share a modifier state,
+// instead of sending an all-keys-up report after every keystroke
+#define KEYSTROKE_COALESCE_RELEASES true
+
+// Program opcodes, stored in the reserved byte of the boot keyboard report
+#define HID_OP_REPORT 0 // Send modifier + keycode[] as a keyboard report
+#define HID_OP_DELAY  1 // Pause for keycode[0] | keycode[1] << 8 milliseconds
+#define HID_OP_RATE   2 // Space following reports keycode[0] | keycode[1] << 8 microseconds apart
+#define HID_OP_KEYS   3 // Extra keycode[] held with the next report, for chords beyond six keys
+#define HID_OP_MEDIA  4 // Consumer control usage keycode[0] | keycode[1] << 8, 0 releases it
+#define HID_OP_REPEAT 5 // Play the next keycode[2] | keycode[3] << 8 steps keycode[0] | keycode[1] << 8 times;
+                        // run by the job feeder, never sent to core1
+
+// Deepest nesting of HID_OP_REPEAT bodies the feeder follows
+#define KEYSTROKE_REPEAT_DEPTH 4
+
+// Most keys one chord can hold: the report's six plus two HID_OP_KEYS steps
+#define KEYSTROKE_CHORD_KEYS 18
+
+// Longest token the incremental compiler buffers while looking for its end
+#define KEYSTROKE_TOKEN_WINDOW 64
+
+// FNV-1a 64-bit, used to fingerprint uploaded input
+#define FNV1A64_OFFSET 0xcbf29ce484222325ULL
+#define FNV1A64_PRIME  0x100000001b3ULL
+
+// Named key table entries; names are matched case-sensitively
+typedef struct {
+  const char* name;
+  uint8_t modifier;
+} NamedModifier;
+
+typedef struct {
+  const char* name;
+  HidKey key;
+} NamedKey;
+
+typedef struct {
+  const char* name;
+  uint16_t usage;
+} NamedMediaKey;
+
+// Table order sorted by name, computed at compile time
+template <size_t N>
+struct KeyNameIndex {
+  uint8_t order[N];
+};
+
+// Compiled program step, laid out as an 8-byte boot keyboard report
+typedef struct {
+  uint8_t modifier;
+  uint8_t opcode;
+  uint8_t keycode[6];
+} HidReport;
+
+typedef std::vector<HidReport> KeystrokeProgram;
+
+// Program buffers are emptied rather than freed when they are reused, so the
+// heap stops changing once they have grown to the usual request size. Larger
+// ones are freed so a single long job does not pin its memory.
+#define KEYSTROKE_RETAINED_REPORTS 512 // 4 KB per buffer
+
+// Options that control how a sequence is compiled
+typedef struct {
+  bool coalesceReleases;
+  uint8_t layout;
+} KeystrokeOptions;
+
+const KeystrokeOptions DEFAULT_KEYSTROKE_OPTIONS = {KEYSTROKE_COALESCE_RELEASES, LAYOUT_US};
+
+// Compiler output plus the keys held down by the last report it emitted
+typedef struct {
+  KeystrokeProgram* program;
+  KeystrokeOptions options;
+  uint8_t modifier;
+  uint8_t keycode[6];
+  bool extraHeld;      // The last press also held HID_OP_KEYS keys
+} KeystrokeEmitter;
+
+// Incremental compiler state. Input may arrive in chunks of any size; a token
+// split between chunks is held in the window until its end is seen. Tokens
+// longer than the window cannot be key names and are typed as text.
+typedef struct {
+  KeystrokeEmitter emitter;
+  bool literal;          // Type every character as-is, newlines as ENTER
+  bool previousWasText;
+  size_t pendingSpaces;
+  size_t tokenLength;
+  bool tokenHasPlus;
+  bool tokenIsText;
+  char token[KEYSTROKE_TOKEN_WINDOW];
+} KeystrokeStream;
+
+// Function declarations
+void beginKeystrokeStream(KeystrokeStream& stream, KeystrokeProgram& program,
+                          const KeystrokeOptions& options, bool literal = false);
+void feedKeystrokeStream(KeystrokeStream& stream, const char* input, size_t length);
+void endKeystrokeStream(KeystrokeStream& stream);
+uint64_t fnv1a64(const void* data, size_t length, uint64_t hash = FNV1A64_OFFSET);
+void compileKeystrokeSequence(const char* input, size_t length, KeystrokeProgram& program,
+                              const KeystrokeOptions& options = DEFAULT_KEYSTROKE_OPTIONS);
+void appendTypingRate(KeystrokeProgram& program, uint16_t intervalUs);
+void recycleKeystrokeProgram(KeystrokeProgram& program);
+uint16_t parseTypingRate(const char* value, uint16_t fallbackUs);
+uint32_t estimateKeystrokeProgramMs(const KeystrokeProgram& program, uint16_t intervalUs);
+uint64_t countPlayedReports(const HidReport* reports, size_t count, uint8_t depth = 0);
+uint32_t hidReportDurationUs(const HidReport& report, uint16_t& intervalUs);
+bool lookupModifierKey(const char* name, size_t length, uint8_t& modifier);
+bool lookupSpecialKey(const char* name, size_t length, HidKey& key, uint8_t layout = LAYOUT_US);
+bool lookupMediaKey(const char* name, size_t length, uint16_t& usage);
+
+// Implementation
+
+// Special key that moves between layouts, resolved through the active one
+#define LAYOUT_CHAR(character) {character, 0}
+
+// Modifier key mappings
+constexpr NamedModifier MODIFIER_KEYS[] = {
+  {"SHIFT",  KEYBOARD_MODIFIER_LEFTSHIFT},
+  {"LSHIFT", KEYBOARD_MODIFIER_LEFTSHIFT},
+  {"RSHIFT", KEYBOARD_MODIFIER_RIGHTSHIFT},
+
+  {"CTRL",   KEYBOARD_MODIFIER_LEFTCTRL},
+  {"LCTRL",  KEYBOARD_MODIFIER_LEFTCTRL},
+  {"RCTRL",  KEYBOARD_MODIFIER_RIGHTCTRL},
+
+  {"ALT",    KEYBOARD_MODIFIER_LEFTALT},
+  {"LALT",   KEYBOARD_MODIFIER_LEFTALT},
+  {"RALT",   KEYBOARD_MODIFIER_RIGHTALT},
+
+  {"GUI",    KEYBOARD_MODIFIER_LEFTGUI},
+  {"WIN",    KEYBOARD_MODIFIER_LEFTGUI},
+  {"LWIN",   KEYBOARD_MODIFIER_LEFTGUI},
+  {"RWIN",   KEYBOARD_MODIFIER_RIGHTGUI},
+  {"CMD",    KEYBOARD_MODIFIER_LEFTGUI},
+  {"LCMD",   KEYBOARD_MODIFIER_LEFTGUI},
+  {"RCMD",   KEYBOARD_MODIFIER_RIGHTGUI}
+};
+
+// Special key mappings
+constexpr NamedKey SPECIAL_KEYS[] = {
+  {"ESC",        {0, HID_KEY_ESCAPE}},
+  {"F1",         {0, HID_KEY_F1}},
+  {"F2",         {0, HID_KEY_F2}},
+  {"F3",         {0, HID_KEY_F3}},
+  {"F4",         {0, HID_KEY_F4}},
+  {"F5",         {0, HID_KEY_F5}},
+  {"F6",         {0, HID_KEY_F6}},
+  {"F7",         {0, HID_KEY_F7}},
+  {"F8",         {0, HID_KEY_F8}},
+  {"F9",         {0, HID_KEY_F9}},
+  {"F10",        {0, HID_KEY_F10}},
+  {"F11",        {0, HID_KEY_F11}},
+  {"F12",        {0, HID_KEY_F12}},
+  {"F13",        {0, HID_KEY_F13}},
+  {"F14",        {0, HID_KEY_F14}},
+  {"F15",        {0, HID_KEY_F15}},
+  {"F16",        {0, HID_KEY_F16}},
+  {"F17",        {0, HID_KEY_F17}},
+  {"F18",        {0, HID_KEY_F18}},
+  {"F19",        {0, HID_KEY_F19}},
+  {"F20",        {0, HID_KEY_F20}},
+  {"F21",        {0, HID_KEY_F21}},
+  {"F22",        {0, HID_KEY_F22}},
+  {"F23",        {0, HID_KEY_F23}},
+  {"F24",        {0, HID_KEY_F24}},
+
+  {"BACKSPACE",  {0, HID_KEY_BACKSPACE}},
+  {"DEL",        {0, HID_KEY_DELETE}},
+  {"DELETE",     {0, HID_KEY_DELETE}},
+
+  {"TAB",        {0, HID_KEY_TAB}},
+  {"ENTER",      {0, HID_KEY_ENTER}},
+
+  {"SHIFT",      {0, HID_KEY_SHIFT_LEFT}},
+  {"LSHIFT",     {0, HID_KEY_SHIFT_LEFT}},
+  {"RSHIFT",     {0, HID_KEY_SHIFT_RIGHT}},
+
+  {"CTRL",       {0, HID_KEY_CONTROL_LEFT}},
+  {"LCTRL",      {0, HID_KEY_CONTROL_LEFT}},
+  {"RCTRL",      {0, HID_KEY_CONTROL_RIGHT}},
+
+  {"ALT",        {0, HID_KEY_ALT_LEFT}},
+  {"LALT",       {0, HID_KEY_ALT_LEFT}},
+  {"RALT",       {0, HID_KEY_ALT_RIGHT}},
+
+  {"GUI",        {0, HID_KEY_GUI_LEFT}},
+  {"WIN",        {0, HID_KEY_GUI_LEFT}},
+  {"LWIN",       {0, HID_KEY_GUI_LEFT}},
+  {"RWIN",       {0, HID_KEY_GUI_RIGHT}},
+  {"CMD",        {0, HID_KEY_GUI_LEFT}},
+  {"LCMD",       {0, HID_KEY_GUI_LEFT}},
+  {"RCMD",       {0, HID_KEY_GUI_RIGHT}},
+
+  {"SPACE",      {0, HID_KEY_SPACE}},
+  {"PLUS",       LAYOUT_CHAR('+')},
+
+  {"PRTSCRN",    {0, HID_KEY_PRINT_SCREEN}},
+  {"SCRLLOCK",   {0, HID_KEY_SCROLL_LOCK}},
+  {"PAUSE",      {0, HID_KEY_PAUSE}},
+
+  {"INSERT",     {0, HID_KEY_INSERT}},
+  {"HOME",       {0, HID_KEY_HOME}},
+  {"END",        {0, HID_KEY_END}},
+  {"PAGEUP",     {0, HID_KEY_PAGE_UP}},
+  {"PAGEDOWN",   {0, HID_KEY_PAGE_DOWN}},
+
+  {"UP",         {0, HID_KEY_ARROW_UP}},
+  {"DOWN",       {0, HID_KEY_ARROW_DOWN}},
+  {"LEFT",       {0, HID_KEY_ARROW_LEFT}},
+  {"RIGHT",      {0, HID_KEY_ARROW_RIGHT}},
+
+  {"KP1",        {0, HID_KEY_KEYPAD_1}},
+  {"KP2",        {0, HID_KEY_KEYPAD_2}},
+  {"KP3",        {0, HID_KEY_KEYPAD_3}},
+  {"KP4",        {0, HID_KEY_KEYPAD_4}},
+  {"KP5",        {0, HID_KEY_KEYPAD_5}},
+  {"KP6",        {0, HID_KEY_KEYPAD_6}},
+  {"KP7",        {0, HID_KEY_KEYPAD_7}},
+  {"KP8",        {0, HID_KEY_KEYPAD_8}},
+  {"KP9",        {0, HID_KEY_KEYPAD_9}},
+  {"KP0",        {0, HID_KEY_KEYPAD_0}},
+  {"KPDIV",      {0, HID_KEY_KEYPAD_DIVIDE}},
+  {"KPMUL",      {0, HID_KEY_KEYPAD_MULTIPLY}},
+  {"KPSUB",      {0, HID_KEY_KEYPAD_SUBTRACT}},
+  {"KPADD",      {0, HID_KEY_KEYPAD_ADD}},
+  {"KPENTER",    {0, HID_KEY_KEYPAD_ENTER}},
+  {"KP.",        {0, HID_KEY_KEYPAD_DECIMAL}},
+  {"KP=",        {0, HID_KEY_KEYPAD_EQUAL}},
+  {"KP,",        {0, HID_KEY_KEYPAD_COMMA}}
+};
+
+// Consumer control (media) keys, sent through their own report
+constexpr NamedMediaKey MEDIA_KEYS[] = {
+  {"VOLUP",      HID_USAGE_CONSUMER_VOLUME_INCREMENT},
+  {"VOLDOWN",    HID_USAGE_CONSUMER_VOLUME_DECREMENT},
+  {"MUTE",       HID_USAGE_CONSUMER_MUTE},
+  {"PLAYPAUSE",  HID_USAGE_CONSUMER_PLAY_PAUSE},
+  {"NEXTTRACK",  HID_USAGE_CONSUMER_SCAN_NEXT},
+  {"PREVTRACK",  HID_USAGE_CONSUMER_SCAN_PREVIOUS},
+  {"STOPMEDIA",  HID_USAGE_CONSUMER_STOP},
+  {"BRIGHTUP",   HID_USAGE_CONSUMER_BRIGHTNESS_INCREMENT},
+  {"BRIGHTDOWN", HID_USAGE_CONSUMER_BRIGHTNESS_DECREMENT}
+};
+
+constexpr int compareKeyNames(const char* a, const char* b) {
+  while (*a && *a == *b) {
+    a++;
+    b++;
+  }
+  return (unsigned char)*a - (unsigned char)*b;
+}
+
+// Insertion sort at compile time, so the tables above can stay grouped by
+// purpose while lookups binary search without touching the heap
+template <typename T, size_t N>
+constexpr KeyNameIndex<N> sortKeyNames(const T (&table)[N]) {
+  static_assert(N <= 256, "Key table too large for a uint8_t index");
+  KeyNameIndex<N> index = {};
+  for (size_t i = 0; i < N; ++i) {
+    index.order[i] = i;
+  }
+  for (size_t i = 1; i < N; ++i) {
+    uint8_t current = index.order[i];
+    size_t j = i;
+    while (j > 0 && compareKeyNames(table[index.order[j - 1]].name, table[current].name) > 0) {
+      index.order[j] = index.order[j - 1];
+      j--;
+    }
+    index.order[j] = current;
+  }
+  return index;
+}
+
+template <typename T, size_t N>
+constexpr bool hasUniqueKeyNames(const T (&table)[N], const KeyNameIndex<N>& index) {
+  for (size_t i = 1; i < N; ++i) {
+    if (compareKeyNames(table[index.order[i - 1]].name, table[index.order[i]].name) == 0) return false;
+  }
+  return true;
+}
+
+constexpr KeyNameIndex<sizeof(MODIFIER_KEYS) / sizeof(MODIFIER_KEYS[0])> MODIFIER_KEY_INDEX = sortKeyNames(MODIFIER_KEYS);
+constexpr KeyNameIndex<sizeof(SPECIAL_KEYS) / sizeof(SPECIAL_KEYS[0])> SPECIAL_KEY_INDEX = sortKeyNames(SPECIAL_KEYS);
+constexpr KeyNameIndex<sizeof(MEDIA_KEYS) / sizeof(MEDIA_KEYS[0])> MEDIA_KEY_INDEX = sortKeyNames(MEDIA_KEYS);
+
+static_assert(hasUniqueKeyNames(MODIFIER_KEYS, MODIFIER_KEY_INDEX), "Duplicate name in MODIFIER_KEYS");
+static_assert(hasUniqueKeyNames(SPECIAL_KEYS, SPECIAL_KEY_INDEX), "Duplicate name in SPECIAL_KEYS");
+static_assert(hasUniqueKeyNames(MEDIA_KEYS, MEDIA_KEY_INDEX), "Duplicate name in MEDIA_KEYS");
+
+// Binary search for a length-bounded name; returns nullptr if not found
+template <typename T, size_t N>
+const T* findNamedKey(const T (&table)[N], const KeyNameIndex<N>& index, const char* name, size_t length) {
+  size_t low = 0;
+  size_t high = N;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    const T& entry = table[index.order[mid]];
+    int result = strncmp(entry.name, name, length);
+    if (result == 0 && entry.name[length] != '\0') result = 1;
+
+    if (result == 0) return &entry;
+    if (result < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return nullptr;
+}
+
+// Look up a modifier name such as "CTRL" in MODIFIER_KEYS
+bool lookupModifierKey(const char* name, size_t length, uint8_t& modifier) {
+  const NamedModifier* entry = findNamedKey(MODIFIER_KEYS, MODIFIER_KEY_INDEX, name, length);
+  if (!entry) return false;
+  modifier = entry->modifier;
+  return true;
+}
+
+// Look up a key name such as "ENTER" in SPECIAL_KEYS
+bool lookupSpecialKey(const char* name, size_t length, HidKey& key, uint8_t layout) {
+  const NamedKey* entry = findNamedKey(SPECIAL_KEYS, SPECIAL_KEY_INDEX, name, length);
+  if (!entry) return false;
+  key = entry->key;
+  if (key.keycode == 0) {
+    key = convertAsciiToHid(key.modifier, layout);
+  }
+  return true;
+}
+
+// Look up a media key name such as "VOLUP" in MEDIA_KEYS
+bool lookupMediaKey(const char* name, size_t length, uint16_t& usage) {
+  const NamedMediaKey* entry = findNamedKey(MEDIA_KEYS, MEDIA_KEY_INDEX, name, length);
+  if (!entry) return false;
+  usage = entry->usage;
+  return true;
+}
+
+void emitReport(KeystrokeEmitter& emitter, uint8_t modifier, const uint8_t keycode[6]) {
+  HidReport report = {modifier, HID_OP_REPORT, {0}};
+  if (keycode) memcpy(report.keycode, keycode, sizeof(report.keycode));
+  emitter.program->push_back(report);
+
+  emitter.modifier = report.modifier;
+  memcpy(emitter.keycode, report.keycode, sizeof(emitter.keycode));
+  emitter.extraHeld = false;
+}
+
+// Send the all-keys-up report if anything is still held
+void emitRelease(KeystrokeEmitter& emitter) {
+  if (emitter.modifier != 0 || emitter.keycode[0] != 0) {
+    emitReport(emitter, 0, nullptr);
+  }
+}
+
+// A held key can be replaced directly when the modifiers stay the same and
+// no key repeats; otherwise the host needs an empty report in between
+bool canSkipRelease(const KeystrokeEmitter& emitter, uint8_t modifier, const uint8_t keycode[6]) {
+  if (!emitter.options.coalesceReleases) return false;
+  if (emitter.modifier != modifier || emitter.extraHeld) return false;
+  if (emitter.keycode[0] == 0 || keycode[0] == 0) return false;
+
+  for (int i = 0; i < 6 && keycode[i]; ++i) {
+    for (int j = 0; j < 6 && emitter.keycode[j]; ++j) {
+      if (keycode[i] == emitter.keycode[j]) return false;
+    }
+  }
+  return true;
+}
+
+// Press a key combination; its release is deferred until the next transition.
+// Keys beyond the report's six go in HID_OP_KEYS steps just before it.
+void emitKeystroke(KeystrokeEmitter& emitter, uint8_t modifier, const uint8_t keycode[6],
+                   const uint8_t* extraKeys = nullptr, size_t extraCount = 0) {
+  if (extraCount > 0 || !canSkipRelease(emitter, modifier, keycode)) {
+    emitRelease(emitter);
+  }
+  for (size_t i = 0; i < extraCount; i += 6) {
+    HidReport more = {modifier, HID_OP_KEYS, {0}};
+    memcpy(more.keycode, extraKeys + i, extraCount - i < 6 ? extraCount - i : 6);
+    emitter.program->push_back(more);
+  }
+  emitReport(emitter, modifier, keycode);
+  emitter.extraHeld = extraCount > 0;
+
+  if (!emitter.options.coalesceReleases) {
+    emitRelease(emitter);
+  }
+}
+
+// Tap a media key; held keyboard keys are let go first
+void emitMediaKey(KeystrokeEmitter& emitter, uint16_t usage) {
+  emitRelease(emitter);
+  HidReport press = {0, HID_OP_MEDIA, {(uint8_t)(usage & 0xFF), (uint8_t)(usage >> 8)}};
+  HidReport release = {0, HID_OP_MEDIA, {0}};
+  emitter.program->push_back(press);
+  emitter.program->push_back(release);
+}
+
+void emitCharacter(KeystrokeEmitter& emitter, char character) {
+  HidKey hk = convertAsciiToHid(character, emitter.options.layout);
+  if (hk.keycode == 0) return; // skip unsupported chars
+
+  uint8_t keycode[6] = {hk.keycode};
+  emitKeystroke(emitter, hk.modifier, keycode);
+
+  // Dead keys wait for the next key; a space makes them print as themselves
+  if (isDeadKey(character, emitter.options.layout)) {
+    uint8_t space[6] = {HID_KEY_SPACE};
+    emitKeystroke(emitter, 0, space);
+  }
+}
+
+// Compile a chorded token like CTRL+ALT+DEL into a single press
+void compileChord(const char* token, size_t length, KeystrokeEmitter& emitter) {
+  uint8_t modifier = 0;
+  uint8_t keycode[KEYSTROKE_CHORD_KEYS] = {0};
+  uint8_t keyIndex = 0;
+
+  size_t chordStart = 0;
+  while (chordStart <= length) {
+    size_t chordEnd = chordStart;
+    while (chordEnd < length && token[chordEnd] != '+') chordEnd++;
+
+    const char* key = token + chordStart;
+    size_t keyLength = chordEnd - chordStart;
+    uint8_t keyModifier = 0;
+    HidKey hk = {0, 0};
+
+    // Check if it's a modifier key
+    if (lookupModifierKey(key, keyLength, keyModifier)) {
+      modifier |= keyModifier;
+    } else {
+      if (!lookupSpecialKey(key, keyLength, hk, emitter.options.layout) && keyLength == 1) {
+        hk = convertAsciiToHid(key[0], emitter.options.layout);
+      }
+
+      if (hk.keycode != 0 && keyIndex < KEYSTROKE_CHORD_KEYS) {
+        keycode[keyIndex++] = hk.keycode;
+        modifier |= hk.modifier;
+      }
+    }
+    chordStart = chordEnd + 1;
+  }
+
+  emitKeystroke(emitter, modifier, keycode, keycode + 6, keyIndex > 6 ? keyIndex - 6 : 0);
+}
+
+// Type the spaces held back between two runs of text
+void beginTextToken(KeystrokeStream& stream) {
+  if (stream.previousWasText) {
+    for (; stream.pendingSpaces > 0; stream.pendingSpaces--) emitCharacter(stream.emitter, ' ');
+  }
+  stream.previousWasText = true;
+}
+
+// Compile the token held in the window
+void compileStreamToken(KeystrokeStream& stream) {
+  KeystrokeEmitter& emitter = stream.emitter;
+  const char* token = stream.token;
+  size_t tokenLength = stream.tokenLength;
+  HidKey hk = {0, 0};
+  uint16_t usage = 0;
+
+  if (stream.tokenIsText) {
+    // Rest of a token that outgrew the window
+    for (size_t i = 0; i < tokenLength; ++i) {
+      emitCharacter(emitter, token[i]);
+    }
+  } else if (stream.tokenHasPlus && tokenLength > 1) {
+    // Handle chorded input like CTRL+ALT+DEL
+    compileChord(token, tokenLength, emitter);
+    stream.previousWasText = false;
+  } else if (lookupSpecialKey(token, tokenLength, hk, emitter.options.layout)) {
+    // Special key (e.g. ENTER, CTRL, etc.)
+    uint8_t keycode[6] = {hk.keycode};
+    emitKeystroke(emitter, hk.modifier, keycode);
+    stream.previousWasText = false;
+  } else if (lookupMediaKey(token, tokenLength, usage)) {
+    emitMediaKey(emitter, usage);
+    stream.previousWasText = false;
+  } else {
+    // Treat as a sequence of characters
+    beginTextToken(stream);
+    for (size_t i = 0; i < tokenLength; ++i) {
+      emitCharacter(emitter, token[i]);
+    }
+  }
+
+  stream.pendingSpaces = 0;
+  stream.tokenLength = 0;
+  stream.tokenHasPlus = false;
+  stream.tokenIsText = false;
+}
+
+void beginKeystrokeStream(KeystrokeStream& stream, KeystrokeProgram& program,
+                          const KeystrokeOptions& options, bool literal) {
+  memset(&stream, 0, sizeof(stream));
+  stream.emitter.program = &program;
+  stream.emitter.options = options;
+  stream.literal = literal;
+}
+
+void feedKeystrokeStream(KeystrokeStream& stream, const char* input, size_t length) {
+  for (size_t pos = 0; pos < length; pos++) {
+    char c = input[pos];
+    if (stream.literal) {
+      if (c != '\r') emitCharacter(stream.emitter, c);
+      continue;
+    }
+
+    // Whitespace separates tokens; spaces between two runs of text are typed
+    if (isspace((unsigned char)c)) {
+      if (stream.tokenLength > 0) compileStreamToken(stream);
+      if (c == ' ') stream.pendingSpaces++;
+      continue;
+    }
+
+    // Too long for a key name or chord: type what the window holds as text
+    if (stream.tokenLength == sizeof(stream.token)) {
+      if (!stream.tokenIsText) {
+        beginTextToken(stream);
+        stream.tokenIsText = true;
+      }
+      for (size_t i = 0; i < stream.tokenLength; ++i) {
+        emitCharacter(stream.emitter, stream.token[i]);
+      }
+      stream.tokenLength = 0;
+    }
+
+    if (c == '+') stream.tokenHasPlus = true;
+    stream.token[stream.tokenLength++] = c;
+  }
+}
+
+void endKeystrokeStream(KeystrokeStream& stream) {
+  if (stream.tokenLength > 0) {
+    compileStreamToken(stream);
+  }
+  emitRelease(stream.emitter);
+}
+
+void compileKeystrokeSequence(const char* input, size_t length, KeystrokeProgram& program,
+                              const KeystrokeOptions& options) {
+  KeystrokeStream stream;
+  beginKeystrokeStream(stream, program, options);
+  feedKeystrokeStream(stream, input, length);
+  endKeystrokeStream(stream);
+}
+
+// Prefix a program with the typing rate it should be played at
+void appendTypingRate(KeystrokeProgram& program, uint16_t intervalUs) {
+  HidReport report = {0, HID_OP_RATE, {(uint8_t)(intervalUs & 0xFF), (uint8_t)(intervalUs >> 8)}};
+  program.push_back(report);
+}
+
+// Empties a program for reuse, keeping its buffer unless it has grown large
+void recycleKeystrokeProgram(KeystrokeProgram& program) {
+  if (program.capacity() > KEYSTROKE_RETAINED_REPORTS) {
+    KeystrokeProgram().swap(program);
+  } else {
+    program.clear();
+  }
+}
+
+// Accepts a profile name (fast, normal, safe) or an interval in microseconds
+uint16_t parseTypingRate(const char* value, uint16_t fallbackUs) {
+  if (!value || !*value) return fallbackUs;
+  if (strcasecmp(value, "fast") == 0) return TYPING_RATE_FAST_US;
+  if (strcasecmp(value, "normal") == 0) return TYPING_RATE_NORMAL_US;
+  if (strcasecmp(value, "safe") == 0) return TYPING_RATE_SAFE_US;
+
+  char* end = nullptr;
+  unsigned long intervalUs = strtoul(value, &end, 10);
+  if (*end != '\0' || intervalUs == 0 || intervalUs > 0xFFFF) return fallbackUs;
+  return (uint16_t)intervalUs;
+}
+
+// Steps covered by a HID_OP_REPEAT, clipped to the steps that follow it
+size_t repeatBodyLength(const HidReport& report, size_t following) {
+  size_t length = report.keycode[2] | (report.keycode[3] << 8);
+  return length < following ? length : following;
+}
+
+// Repeat counts multiply, so totals saturate instead of wrapping round
+uint64_t saturatingAdd(uint64_t a, uint64_t b) {
+  return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+}
+
+uint64_t saturatingMultiply(uint64_t a, uint64_t b) {
+  return b != 0 && a > UINT64_MAX / b ? UINT64_MAX : a * b;
+}
+
+// Playback time of count steps; a repeated body is timed twice, since only
+// its first pass can start at a different typing rate. Past
+// KEYSTROKE_REPEAT_DEPTH a body plays once, as in the job feeder.
+uint64_t hidProgramDurationUs(const HidReport* reports, size_t count, uint16_t& intervalUs, uint8_t depth = 0) {
+  uint64_t totalUs = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (reports[i].opcode != HID_OP_REPEAT) {
+      totalUs += hidReportDurationUs(reports[i], intervalUs);
+      continue;
+    }
+    uint16_t times = reports[i].keycode[0] | (reports[i].keycode[1] << 8);
+    size_t length = repeatBodyLength(reports[i], count - i - 1);
+    if (times == 0) {
+      i += length;
+      continue;
+    }
+    if (times == 1 || depth >= KEYSTROKE_REPEAT_DEPTH) {
+      continue; // Body plays once, in line
+    }
+    uint64_t firstUs = hidProgramDurationUs(reports + i + 1, length, intervalUs, depth + 1);
+    uint64_t laterUs = hidProgramDurationUs(reports + i + 1, length, intervalUs, depth + 1);
+    totalUs = saturatingAdd(totalUs, saturatingAdd(firstUs, saturatingMultiply(times - 1, laterUs)));
+    i += length;
+  }
+  return totalUs;
+}
+
+// Time the program takes to play when every report waits out the typing rate
+uint32_t estimateKeystrokeProgramMs(const KeystrokeProgram& program, uint16_t intervalUs) {
+  uint64_t totalMs = saturatingAdd(hidProgramDurationUs(program.data(), program.size(), intervalUs), 999) / 1000;
+  return totalMs > UINT32_MAX ? UINT32_MAX : (uint32_t)totalMs;
+}
+
+// Reports sent to core1 when the steps are played, with repeats unrolled the
+// way the job feeder does it
+uint64_t countPlayedReports(const HidReport* reports, size_t count, uint8_t depth) {
+  uint64_t played = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (reports[i].opcode != HID_OP_REPEAT) {
+      played++;
+      continue;
+    }
+    uint16_t times = reports[i].keycode[0] | (reports[i].keycode[1] << 8);
+    size_t length = repeatBodyLength(reports[i], count - i - 1);
+    if (times == 0) {
+      i += length;
+      continue;
+    }
+    if (times == 1 || depth >= KEYSTROKE_REPEAT_DEPTH) {
+      continue;
+    }
+    played = saturatingAdd(played, saturatingMultiply(times, countPlayedReports(reports + i + 1, length, depth + 1)));
+    i += length;
+  }
+  return played;
+}
+
+// Playback time of one report; a rate opcode updates intervalUs for the ones after it
+uint32_t hidReportDurationUs(const HidReport& report, uint16_t& intervalUs) {
+  uint16_t argument = report.keycode[0] | (report.keycode[1] << 8);
+  if (report.opcode == HID_OP_DELAY) {
+    return argument * 1000UL;
+  } else if (report.opcode == HID_OP_RATE) {
+    intervalUs = argument;
+    return 0;
+  } else if (report.opcode == HID_OP_KEYS || report.opcode == HID_OP_REPEAT) {
+    return 0;
+  }
+  return intervalUs;
+}
+
+uint64_t fnv1a64(const void* data, size_t length, uint64_t hash) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * FNV1A64_PRIME;
+  }
+  return hash;
+}
+
+#endif
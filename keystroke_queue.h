@@ -0,0 +1,284 @@
+#ifndef KEYSTROKE_QUEUE_H
+#define KEYSTROKE_QUEUE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "keyboard_handler.h"
+#include "report_ring.h"
+
+// Number of job slots; finished jobs keep their slot (and status) until reused
+#define KEYSTROKE_QUEUE_SIZE 4
+
+// Reports buffered between core0 (producer) and core1 (HID playback)
+#define HID_REPORT_RING_SIZE 256
+
+// Reports read from LittleFS per refill when playing a macro
+#define MACRO_BLOCK_REPORTS 32
+
+// Job states
+#define JOB_QUEUED  0
+#define JOB_RUNNING 1
+#define JOB_DONE    2
+
+// Keystroke job structure
+typedef struct {
+  uint32_t id;
+  uint8_t state;
+  size_t position;   // Reports handed to core1
+  size_t total;      // Reports to hand over, with repeats unrolled
+  size_t step;       // Next program step; jumps back while a repeat plays
+  uint32_t firstSeq; // Ring sequence number of the first report
+  bool streaming;    // Reports are pushed by the uploader, not taken from program
+  KeystrokeProgram program;
+  File source;       // Macro reports that follow program, read a block at a time
+} KeystrokeJob;
+
+// Function declarations
+uint32_t enqueueKeystrokeJob(KeystrokeProgram& program);
+uint32_t enqueueMacroJob(KeystrokeProgram& prefix, File& source, uint32_t reportCount);
+uint32_t beginStreamingJob();
+void pushStreamingReports(uint32_t id, const KeystrokeProgram& reports);
+void endStreamingJob(uint32_t id);
+const KeystrokeJob* findKeystrokeJob(uint32_t id);
+size_t keystrokeJobSent(const KeystrokeJob* job);
+const char* keystrokeJobStateName(uint8_t state);
+bool isHidIdle();
+void serviceKeystrokeQueue();
+void serviceHidPlayback();
+
+// Implementation
+KeystrokeJob keystrokeJobs[KEYSTROKE_QUEUE_SIZE];
+uint32_t nextKeystrokeJobId = 1;
+uint32_t activeKeystrokeJobId = 1;
+
+SpscRing<HidReport, HID_REPORT_RING_SIZE> hidReportRing;
+uint32_t hidReportsQueued = 0;                // Written by core0 only
+std::atomic<uint32_t> hidReportsEmitted{0};   // Written by core1 only
+
+// Compile buffer for the request or live frame being handled on core0; recycled
+// after each one, so its capacity is reused instead of allocated per request
+KeystrokeProgram requestReports;
+
+// Current block of the macro being fed (only the active job reads its source)
+HidReport macroBlock[MACRO_BLOCK_REPORTS];
+size_t macroBlockIndex = 0;
+size_t macroBlockLength = 0;
+
+// HID_OP_REPEAT bodies the active job is inside, innermost last
+typedef struct {
+  size_t start;
+  size_t end;
+  uint16_t remaining;  // Passes still to play after the current one
+} RepeatFrame;
+
+RepeatFrame repeatFrames[KEYSTROKE_REPEAT_DEPTH];
+uint8_t repeatDepth = 0;
+
+// Copies the program into the job's own buffer and empties it, so callers can
+// keep reusing one buffer; returns the job id, or 0 if the queue is full
+uint32_t enqueueKeystrokeJob(KeystrokeProgram& program) {
+  KeystrokeJob& job = keystrokeJobs[nextKeystrokeJobId % KEYSTROKE_QUEUE_SIZE];
+  if (job.id != 0 && job.state != JOB_DONE) {
+    return 0;
+  }
+
+  job.id = nextKeystrokeJobId++;
+  job.state = JOB_QUEUED;
+  job.position = 0;
+  job.total = countPlayedReports(program.data(), program.size());
+  job.step = 0;
+  job.firstSeq = 0;
+  job.streaming = false;
+  job.source = File();
+  job.program.assign(program.begin(), program.end());
+  program.clear();
+  return job.id;
+}
+
+// Plays prefix, then reportCount reports from source (positioned at the first);
+// takes over the file and empties prefix. Returns 0 if the queue is full.
+uint32_t enqueueMacroJob(KeystrokeProgram& prefix, File& source, uint32_t reportCount) {
+  uint32_t id = enqueueKeystrokeJob(prefix);
+  if (id != 0) {
+    KeystrokeJob& job = keystrokeJobs[id % KEYSTROKE_QUEUE_SIZE];
+    job.source = source;
+    job.total += reportCount;
+  }
+  source = File();
+  return id;
+}
+
+// A job whose reports arrive while it runs; returns 0 if the queue is full
+uint32_t beginStreamingJob() {
+  KeystrokeProgram empty;
+  uint32_t id = enqueueKeystrokeJob(empty);
+  if (id != 0) {
+    keystrokeJobs[id % KEYSTROKE_QUEUE_SIZE].streaming = true;
+  }
+  return id;
+}
+
+// Core0: blocks until earlier jobs have been handed over and the ring has room
+// for every report. The caller stops reading its input meanwhile, which holds
+// the sender back through TCP flow control.
+void pushStreamingReports(uint32_t id, const KeystrokeProgram& reports) {
+  KeystrokeJob& job = keystrokeJobs[id % KEYSTROKE_QUEUE_SIZE];
+  size_t next = 0;
+
+  while (next < reports.size()) {
+    serviceKeystrokeQueue();
+    if (job.state == JOB_RUNNING) {
+      while (next < reports.size() && hidReportRing.push(reports[next])) {
+        next++;
+        job.position++;
+        job.total++;
+        hidReportsQueued++;
+      }
+    }
+    if (next < reports.size()) {
+      yield();
+    }
+  }
+}
+
+void endStreamingJob(uint32_t id) {
+  keystrokeJobs[id % KEYSTROKE_QUEUE_SIZE].streaming = false;
+}
+
+const KeystrokeJob* findKeystrokeJob(uint32_t id) {
+  const KeystrokeJob& job = keystrokeJobs[id % KEYSTROKE_QUEUE_SIZE];
+  return (id != 0 && job.id == id) ? &job : nullptr;
+}
+
+// Reports of this job that core1 has actually sent to the host
+size_t keystrokeJobSent(const KeystrokeJob* job) {
+  if (job->state == JOB_QUEUED) return 0;
+  if (job->state == JOB_DONE) return job->total;
+
+  uint32_t sent = hidReportsEmitted.load(std::memory_order_acquire) - job->firstSeq;
+  return sent < job->position ? sent : job->position;
+}
+
+const char* keystrokeJobStateName(uint8_t state) {
+  switch (state) {
+    case JOB_QUEUED:  return "queued";
+    case JOB_RUNNING: return "running";
+    default:          return "done";
+  }
+}
+
+// No job waiting and every queued report sent; flash writes are safe
+bool isHidIdle() {
+  return activeKeystrokeJobId == nextKeystrokeJobId &&
+         hidReportsEmitted.load(std::memory_order_acquire) == hidReportsQueued;
+}
+
+// Past the end of a repeated body: go round again or leave it
+void closeRepeatFrames(KeystrokeJob& job) {
+  while (repeatDepth > 0 && job.step >= repeatFrames[repeatDepth - 1].end) {
+    RepeatFrame& frame = repeatFrames[repeatDepth - 1];
+    if (frame.remaining > 0) {
+      frame.remaining--;
+      job.step = frame.start;
+      return;
+    }
+    repeatDepth--;
+  }
+}
+
+// Steps over a HID_OP_REPEAT; its body then plays as many times as it says.
+// Past KEYSTROKE_REPEAT_DEPTH the body plays once, as countPlayedReports()
+// counts it; batches never nest that deep.
+void enterRepeat(KeystrokeJob& job, const HidReport& report) {
+  uint16_t times = report.keycode[0] | (report.keycode[1] << 8);
+  size_t length = repeatBodyLength(report, job.program.size() - job.step - 1);
+  job.step++;
+
+  if (times == 0 || length == 0) {
+    job.step += length;
+    closeRepeatFrames(job);
+  } else if (times > 1 && repeatDepth < KEYSTROKE_REPEAT_DEPTH) {
+    repeatFrames[repeatDepth++] = {job.step, job.step + length, (uint16_t)(times - 1)};
+  }
+}
+
+bool readMacroBlock(KeystrokeJob& job) {
+  size_t remaining = job.total - job.position;
+  size_t count = remaining < MACRO_BLOCK_REPORTS ? remaining : MACRO_BLOCK_REPORTS;
+  macroBlockIndex = 0;
+  macroBlockLength = job.source ? job.source.read((uint8_t*)macroBlock, count * sizeof(HidReport)) / sizeof(HidReport) : 0;
+  return macroBlockLength > 0;
+}
+
+// Core0: move reports from the active job into the ring while there is room
+void serviceKeystrokeQueue() {
+  uint32_t emitted = hidReportsEmitted.load(std::memory_order_acquire);
+
+  // Retire jobs whose last report has left core1
+  for (KeystrokeJob& job : keystrokeJobs) {
+    if (job.state == JOB_RUNNING && !job.streaming && job.position == job.total &&
+        emitted - job.firstSeq >= job.total) {
+      job.state = JOB_DONE;
+    }
+  }
+
+  while (activeKeystrokeJobId != nextKeystrokeJobId) {
+    KeystrokeJob& job = keystrokeJobs[activeKeystrokeJobId % KEYSTROKE_QUEUE_SIZE];
+    if (job.state == JOB_QUEUED) {
+      job.state = JOB_RUNNING;
+      job.firstSeq = hidReportsQueued;
+    }
+
+    while (job.position < job.total) {
+      const HidReport* report;
+      bool fromSource = job.step >= job.program.size();
+      if (!fromSource) {
+        report = &job.program[job.step];
+        if (report->opcode == HID_OP_REPEAT) {
+          enterRepeat(job, *report);
+          continue;
+        }
+      } else if (macroBlockIndex < macroBlockLength || readMacroBlock(job)) {
+        report = &macroBlock[macroBlockIndex];
+      } else {
+        job.total = job.position; // Macro file ended early
+        break;
+      }
+
+      if (!hidReportRing.push(*report)) {
+        break;
+      }
+      if (fromSource) {
+        macroBlockIndex++;
+      } else {
+        job.step++;
+        closeRepeatFrames(job);
+      }
+      job.position++;
+      hidReportsQueued++;
+    }
+
+    if (job.position < job.total || job.streaming) {
+      return; // Ring full or upload still arriving, continue on the next loop()
+    }
+
+    recycleKeystrokeProgram(job.program);
+    job.source.close();
+    macroBlockIndex = macroBlockLength = 0;
+    repeatDepth = 0;
+    activeKeystrokeJobId++;
+  }
+}
+
+// Core1: emit queued reports; blocking here never stalls the network side
+void serviceHidPlayback() {
+  HidReport report;
+  if (!hidReportRing.pop(report)) {
+    return;
+  }
+
+  executeHidReport(report);
+  hidReportsEmitted.store(hidReportsEmitted.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+#endif
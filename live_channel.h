@@ -0,0 +1,463 @@
+#ifndef LIVE_CHANNEL_H
+#define LIVE_CHANNEL_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <bearssl/bearssl.h>
+#include "config_manager.h"
+#include "keystroke_queue.h"
+#include "keystroke_batch.h"
+#include "metrics.h"
+#include "security_manager.h"
+#include "slack_notifier.h"
+#include "audit_log.h"
+
+// Persistent WebSocket channel for live typing. The browser sends one small
+// binary frame per key-down/key-up; each becomes a single report pushed
+// straight into the HID ring, and is acknowledged once core1 has sent it.
+// A text frame holds a batch (see keystroke_batch.h), queued as a job, so
+// scripts can send batch after batch over one connection.
+// One session at a time, opened with a single-use token from /live/token.
+#define LIVE_CHANNEL_PORT         81
+#define LIVE_TOKEN_TTL_MS         30000
+#define LIVE_HANDSHAKE_TIMEOUT_MS 2000
+#define LIVE_REQUEST_SIZE         512
+#define LIVE_FRAME_SIZE           1024  // Largest payload accepted, i.e. the largest batch
+#define LIVE_PENDING_ACKS         16
+
+// Key event frame: op, HID usage, sequence number (little-endian)
+#define LIVE_KEY_DOWN    1
+#define LIVE_KEY_UP      2
+#define LIVE_RELEASE_ALL 3
+#define LIVE_EVENT_SIZE  4
+
+// Ack frame: sequence number (little-endian), status
+#define LIVE_ACK_SENT    0
+#define LIVE_ACK_BUSY    1  // A keystroke job is playing, or the ring is full
+#define LIVE_ACK_INVALID 2
+
+// Session states
+#define LIVE_IDLE      0
+#define LIVE_HANDSHAKE 1
+#define LIVE_OPEN      2
+
+// Pending acknowledgement structure
+typedef struct {
+  uint16_t seq;
+  uint8_t status;
+  uint32_t reportSeq;   // Ring sequence number the report must reach
+  uint32_t receivedUs;
+} LiveAck;
+
+// Function declarations
+void initializeLiveChannel();
+void serviceLiveChannel();
+void issueLiveToken(char* token, size_t size);
+bool isLiveChannelOpen();
+
+// Implementation
+uint32_t liveEventsReceived = 0;
+
+WiFiServer liveServer(LIVE_CHANNEL_PORT);
+WiFiClient liveClient;
+uint8_t liveState = LIVE_IDLE;
+uint32_t liveAcceptedMs = 0;
+
+char liveRequest[LIVE_REQUEST_SIZE];
+size_t liveRequestLength = 0;
+uint8_t liveFrame[LIVE_FRAME_SIZE + 8];  // Payload plus the largest header accepted
+size_t liveFrameLength = 0;
+
+char liveToken[33];
+uint32_t liveTokenIssuedMs = 0;
+
+uint8_t liveModifier = 0;
+uint8_t liveKeys[6];
+
+LiveAck liveAcks[LIVE_PENDING_ACKS];
+uint8_t liveAckHead = 0;
+uint8_t liveAckCount = 0;
+
+void initializeLiveChannel() {
+  liveServer.begin();
+  liveServer.setNoDelay(true);
+}
+
+bool isLiveChannelOpen() {
+  return liveState == LIVE_OPEN;
+}
+
+// Replaces any earlier unused token
+void issueLiveToken(char* token, size_t size) {
+  for (int i = 0; i < 4; i++) {
+    snprintf(liveToken + i * 8, 9, "%08lx", (unsigned long)rp2040.hwrand32());
+  }
+  liveTokenIssuedMs = millis();
+  snprintf(token, size, "%s", liveToken);
+}
+
+// Single use; compared in constant time
+bool consumeLiveToken(const char* token, size_t length) {
+  if (liveToken[0] == '\0' || millis() - liveTokenIssuedMs >= LIVE_TOKEN_TTL_MS || length != 32) {
+    return false;
+  }
+  uint8_t difference = 0;
+  for (size_t i = 0; i < 32; i++) {
+    difference |= token[i] ^ liveToken[i];
+  }
+  liveToken[0] = '\0';
+  return difference == 0;
+}
+
+void encodeBase64(const uint8_t* data, size_t length, char* out) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t chunk = data[i] << 16;
+    if (i + 1 < length) chunk |= data[i + 1] << 8;
+    if (i + 2 < length) chunk |= data[i + 2];
+    *out++ = alphabet[(chunk >> 18) & 0x3F];
+    *out++ = alphabet[(chunk >> 12) & 0x3F];
+    *out++ = i + 1 < length ? alphabet[(chunk >> 6) & 0x3F] : '=';
+    *out++ = i + 2 < length ? alphabet[chunk & 0x3F] : '=';
+  }
+  *out = '\0';
+}
+
+// Value of a request header (name matched case-insensitively), trimmed
+bool findLiveHeader(const char* name, const char*& value, size_t& length) {
+  size_t nameLength = strlen(name);
+  const char* line = strstr(liveRequest, "\r\n");
+  while (line && line[2] != '\r') {
+    line += 2;
+    if (strncasecmp(line, name, nameLength) == 0 && line[nameLength] == ':') {
+      value = line + nameLength + 1;
+      while (*value == ' ') value++;
+      const char* end = strstr(value, "\r\n");
+      length = end - value;
+      while (length > 0 && value[length - 1] == ' ') length--;
+      return true;
+    }
+    line = strstr(line, "\r\n");
+  }
+  return false;
+}
+
+void sendLiveFrame(uint8_t opcode, const uint8_t* payload, size_t length) {
+  uint8_t header[2] = {(uint8_t)(0x80 | opcode), (uint8_t)length};
+  liveClient.write(header, sizeof(header));
+  if (length > 0) {
+    liveClient.write(payload, length);
+  }
+}
+
+void sendLiveAck(uint16_t seq, uint8_t status) {
+  uint8_t ack[3] = {(uint8_t)(seq & 0xFF), (uint8_t)(seq >> 8), status};
+  sendLiveFrame(0x2, ack, sizeof(ack));
+}
+
+// Let go of anything the session still holds so no key stays down on the host
+void releaseLiveKeys() {
+  if (liveModifier == 0 && liveKeys[0] == 0) {
+    return;
+  }
+  liveModifier = 0;
+  memset(liveKeys, 0, sizeof(liveKeys));
+  if (activeKeystrokeJobId == nextKeystrokeJobId) {
+    HidReport release = {0, HID_OP_REPORT, {0}};
+    if (hidReportRing.push(release)) hidReportsQueued++;
+  }
+}
+
+void closeLiveChannel() {
+  if (liveState == LIVE_OPEN) {
+    releaseLiveKeys();
+  }
+  liveClient.stop();
+  liveState = LIVE_IDLE;
+  liveAckCount = 0;
+}
+
+void rejectLiveHandshake(const char* status) {
+  liveClient.printf("HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+  closeLiveChannel();
+}
+
+void completeLiveHandshake() {
+  // Request line: GET /?token=<hex> HTTP/1.1
+  const char* token = strstr(liveRequest, "token=");
+  const char* lineEnd = strstr(liveRequest, "\r\n");
+  const char* key;
+  size_t keyLength;
+
+  if (strncmp(liveRequest, "GET ", 4) != 0 || !token || token > lineEnd) {
+    rejectLiveHandshake("400 Bad Request");
+    return;
+  }
+  token += 6;
+  if (!consumeLiveToken(token, strcspn(token, "& "))) {
+    rejectLiveHandshake("403 Forbidden");
+    return;
+  }
+  if (!findLiveHeader("Sec-WebSocket-Key", key, keyLength) || keyLength == 0 || keyLength > 64) {
+    rejectLiveHandshake("400 Bad Request");
+    return;
+  }
+
+  // Sec-WebSocket-Accept = base64(SHA-1(key + GUID))
+  static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  uint8_t digest[br_sha1_SIZE];
+  char accept[32];
+  br_sha1_context sha1;
+  br_sha1_init(&sha1);
+  br_sha1_update(&sha1, key, keyLength);
+  br_sha1_update(&sha1, guid, sizeof(guid) - 1);
+  br_sha1_out(&sha1, digest);
+  encodeBase64(digest, sizeof(digest), accept);
+
+  liveClient.printf("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                    "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+  liveState = LIVE_OPEN;
+  liveFrameLength = 0;
+  liveModifier = 0;
+  memset(liveKeys, 0, sizeof(liveKeys));
+
+  // Live keys follow the person typing, not a typing rate
+  if (activeKeystrokeJobId == nextKeystrokeJobId) {
+    HidReport rate = {0, HID_OP_RATE, {(uint8_t)(TYPING_RATE_FAST_US & 0xFF), (uint8_t)(TYPING_RATE_FAST_US >> 8)}};
+    if (hidReportRing.push(rate)) hidReportsQueued++;
+  }
+
+  logAudit(AUDIT_KIND_LIVE_SESSION, AUDIT_ACCEPTED, liveClient.remoteIP(), 0, 0, 0, 0);
+  queueSlackEvent(SLACK_EVENT_LIVE_SESSION, liveClient.remoteIP(), "");
+}
+
+// Text frame: compile and queue a batch, reply with the job or the error
+void handleLiveBatch(const char* body, size_t length) {
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  options.coalesceReleases = deviceConfig.coalesceReleases;
+  options.layout = deviceConfig.layout;
+
+  KeystrokeProgram& program = requestReports;
+  BatchSummary summary;
+  char reply[125];  // Largest payload with a 7-bit length
+  uint32_t jobId = 0;
+  uint64_t digest = fnv1a64(body, length);
+
+  if (compileKeystrokeBatch(body, length, program, options, deviceConfig.typingRateUs, summary)) {
+    releaseLiveKeys();
+    uint32_t reports = program.size();
+    jobId = enqueueKeystrokeJob(program);
+    logAudit(AUDIT_KIND_LIVE_BATCH, jobId ? AUDIT_ACCEPTED : AUDIT_QUEUE_FULL, liveClient.remoteIP(), jobId, reports, length, digest);
+    if (jobId == 0) {
+      snprintf(summary.error, sizeof(summary.error), "keystroke queue full");
+    }
+  } else {
+    logAudit(AUDIT_KIND_LIVE_BATCH, AUDIT_REJECTED, liveClient.remoteIP(), 0, 0, length, digest);
+  }
+  recycleKeystrokeProgram(program);
+
+  if (jobId == 0) {
+    size_t replyLength = 10;
+    memcpy(reply, "{\"error\":\"", replyLength);
+    appendJsonEscaped(reply, sizeof(reply) - 2, replyLength, summary.error);
+    memcpy(reply + replyLength, "\"}", 2);
+    sendLiveFrame(0x1, (const uint8_t*)reply, replyLength + 2);
+    return;
+  }
+
+  int replyLength = snprintf(reply, sizeof(reply), "{\"job\":%lu,\"steps\":%u,\"estimated_ms\":%lu}",
+    (unsigned long)jobId, (unsigned)summary.steps, (unsigned long)summary.estimatedMs);
+  sendLiveFrame(0x1, (const uint8_t*)reply, replyLength);
+
+  char steps[64];
+  char detail[SLACK_DETAIL_SIZE];
+  formatBatchSummary(summary, steps, sizeof(steps));
+  snprintf(detail, sizeof(detail), " as job %lu - live batch of %.60s", (unsigned long)jobId, steps);
+  queueSlackEvent(SLACK_EVENT_KEYSTROKES, liveClient.remoteIP(), detail);
+}
+
+void handleLiveKeyEvent(const uint8_t* event) {
+  uint8_t op = event[0];
+  uint8_t usage = event[1];
+  uint16_t seq = event[2] | (event[3] << 8);
+  liveEventsReceived++;
+
+  if (liveAckCount == LIVE_PENDING_ACKS || activeKeystrokeJobId != nextKeystrokeJobId) {
+    sendLiveAck(seq, LIVE_ACK_BUSY);
+    return;
+  }
+
+  // Modifier usages (0xE0-0xE7) map onto the modifier bits
+  if (op == LIVE_RELEASE_ALL) {
+    liveModifier = 0;
+    memset(liveKeys, 0, sizeof(liveKeys));
+  } else if ((op == LIVE_KEY_DOWN || op == LIVE_KEY_UP) && usage >= HID_KEY_CONTROL_LEFT && usage <= HID_KEY_GUI_RIGHT) {
+    uint8_t bit = 1 << (usage - HID_KEY_CONTROL_LEFT);
+    liveModifier = op == LIVE_KEY_DOWN ? (liveModifier | bit) : (liveModifier & ~bit);
+  } else if (op == LIVE_KEY_DOWN && usage != 0) {
+    int i = 0;
+    while (i < 6 && liveKeys[i] != 0 && liveKeys[i] != usage) i++;
+    if (i < 6) liveKeys[i] = usage; // A seventh key is ignored, like on a boot keyboard
+  } else if (op == LIVE_KEY_UP && usage != 0) {
+    int j = 0;
+    for (int i = 0; i < 6; i++) {
+      if (liveKeys[i] != usage) liveKeys[j++] = liveKeys[i];
+    }
+    while (j < 6) liveKeys[j++] = 0;
+  } else {
+    sendLiveAck(seq, LIVE_ACK_INVALID);
+    return;
+  }
+
+  HidReport report = {liveModifier, HID_OP_REPORT, {0}};
+  memcpy(report.keycode, liveKeys, sizeof(report.keycode));
+  if (!hidReportRing.push(report)) {
+    sendLiveAck(seq, LIVE_ACK_BUSY);
+    return;
+  }
+  hidReportsQueued++;
+
+  LiveAck& ack = liveAcks[(liveAckHead + liveAckCount++) % LIVE_PENDING_ACKS];
+  ack.seq = seq;
+  ack.status = LIVE_ACK_SENT;
+  ack.reportSeq = hidReportsQueued;
+  ack.receivedUs = micros();
+}
+
+// Returns false once the connection should be closed
+bool handleLiveFrame() {
+  while (liveFrameLength >= 2) {
+    uint8_t opcode = liveFrame[0] & 0x0F;
+    bool final = liveFrame[0] & 0x80;
+    bool masked = liveFrame[1] & 0x80;
+    size_t length = liveFrame[1] & 0x7F;
+    size_t headerLength = 6;
+
+    // 16-bit extended length for batches. A 64-bit length is always over
+    // LIVE_FRAME_SIZE, so the frame is refused before its length bytes could
+    // be read as payload.
+    if (length == 127) {
+      uint8_t code[2] = {0x03, 0xF1}; // 1009: message too big
+      sendLiveFrame(0x8, code, sizeof(code));
+      return false;
+    }
+    if (length == 126) {
+      if (liveFrameLength < 4) {
+        return true;
+      }
+      length = (liveFrame[2] << 8) | liveFrame[3];
+      headerLength = 8;
+    }
+
+    // Browsers always mask; unfragmented frames up to LIVE_FRAME_SIZE only,
+    // and control frames are limited to 125 bytes
+    if (!masked || !final || length > LIVE_FRAME_SIZE || ((opcode & 0x8) && length > 125)) {
+      uint8_t code[2] = {0x03, 0xEA}; // 1002: protocol error
+      sendLiveFrame(0x8, code, sizeof(code));
+      return false;
+    }
+    if (liveFrameLength < headerLength + length) {
+      return true; // Wait for the rest
+    }
+
+    uint8_t* mask = liveFrame + headerLength - 4;
+    uint8_t* payload = liveFrame + headerLength;
+    for (size_t i = 0; i < length; i++) {
+      payload[i] ^= mask[i & 3];
+    }
+
+    switch (opcode) {
+      case 0x2: // Binary: one or more key events
+        for (size_t i = 0; i + LIVE_EVENT_SIZE <= length; i += LIVE_EVENT_SIZE) {
+          handleLiveKeyEvent(payload + i);
+        }
+        break;
+      case 0x1: // Text: a batch
+        handleLiveBatch((const char*)payload, length);
+        break;
+      case 0x8: // Close
+        sendLiveFrame(0x8, payload, length < 2 ? length : 2);
+        return false;
+      case 0x9: // Ping
+        sendLiveFrame(0xA, payload, length);
+        break;
+      default:  // Pong frames are ignored
+        break;
+    }
+
+    size_t used = headerLength + length;
+    memmove(liveFrame, liveFrame + used, liveFrameLength - used);
+    liveFrameLength -= used;
+  }
+  return true;
+}
+
+// Acknowledge events whose report core1 has sent
+void serviceLiveAcks() {
+  uint32_t emitted = hidReportsEmitted.load(std::memory_order_acquire);
+  while (liveAckCount > 0) {
+    LiveAck& ack = liveAcks[liveAckHead];
+    if ((int32_t)(emitted - ack.reportSeq) < 0) {
+      break;
+    }
+
+    recordMetric(liveLatency, micros() - ack.receivedUs);
+    sendLiveAck(ack.seq, ack.status);
+    liveAckHead = (liveAckHead + 1) % LIVE_PENDING_ACKS;
+    liveAckCount--;
+  }
+}
+
+// Called from loop(); never blocks on the client
+void serviceLiveChannel() {
+  WiFiClient incoming = liveServer.accept();
+  if (incoming) {
+    if (liveState != LIVE_IDLE || isClientBlocked(incoming.remoteIP())) {
+      incoming.print("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+      incoming.stop();
+    } else {
+      liveClient = incoming;
+      liveClient.setNoDelay(true);
+      liveState = LIVE_HANDSHAKE;
+      liveAcceptedMs = millis();
+      liveRequestLength = 0;
+    }
+  }
+
+  if (liveState == LIVE_IDLE) {
+    return;
+  }
+  if (!liveClient.connected()) {
+    closeLiveChannel();
+    return;
+  }
+
+  if (liveState == LIVE_HANDSHAKE) {
+    while (liveClient.available() && liveRequestLength < sizeof(liveRequest) - 1) {
+      liveRequest[liveRequestLength++] = liveClient.read();
+    }
+    liveRequest[liveRequestLength] = '\0';
+
+    if (strstr(liveRequest, "\r\n\r\n")) {
+      completeLiveHandshake();
+    } else if (liveRequestLength == sizeof(liveRequest) - 1) {
+      rejectLiveHandshake("431 Request Header Fields Too Large");
+    } else if (millis() - liveAcceptedMs >= LIVE_HANDSHAKE_TIMEOUT_MS) {
+      rejectLiveHandshake("408 Request Timeout");
+    }
+    return;
+  }
+
+  while (liveClient.available() && liveFrameLength < sizeof(liveFrame)) {
+    int received = liveClient.read(liveFrame + liveFrameLength, sizeof(liveFrame) - liveFrameLength);
+    if (received <= 0) break;
+    liveFrameLength += received;
+  }
+  if (!handleLiveFrame()) {
+    closeLiveChannel();
+    return;
+  }
+  serviceLiveAcks();
+}
+
+#endif
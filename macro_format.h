@@ -0,0 +1,86 @@
+#ifndef MACRO_FORMAT_H
+#define MACRO_FORMAT_H
+
+// Binary macro file format, shared by the device and tools/macro_compiler.cpp.
+// A file is a MacroHeader followed by reportCount 8-byte HidReports, all
+// little-endian. The typing rate is kept in the header rather than in the
+// report stream so playback can override it.
+#include "keystroke_compiler.h"
+
+#define MACRO_MAGIC     0x4D444948UL // "HIDM"
+#define MACRO_VERSION   1
+#define MACRO_NAME_MAX  24
+#define MACRO_DIR       "/macros"
+#define MACRO_EXTENSION ".hid"
+
+// Macro file header
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t layout;        // LAYOUT_* the macro was compiled for
+  uint16_t intervalUs;   // Typing rate unless playback overrides it
+  uint32_t reportCount;
+  uint32_t estimatedMs;  // Playback time at intervalUs
+  uint64_t digest;       // FNV-1a 64 of the report bytes
+} MacroHeader;
+
+static_assert(sizeof(MacroHeader) == 24, "MacroHeader must match the file layout");
+static_assert(sizeof(HidReport) == 8, "HidReport must match the file layout");
+
+// Header totals kept up to date while reports are appended
+typedef struct {
+  MacroHeader header;
+  uint16_t intervalUs;   // Rate in effect for the estimate
+  uint64_t durationUs;
+  bool hasRepeat;        // A HID_OP_REPEAT was added; playback from a file would not follow it
+} MacroBuilder;
+
+// Function declarations
+bool isValidMacroName(const char* name);
+bool isValidMacroHeader(const MacroHeader& header);
+void beginMacro(MacroBuilder& builder, uint8_t layout, uint16_t intervalUs);
+void addMacroReports(MacroBuilder& builder, const HidReport* reports, size_t count);
+const MacroHeader& finishMacro(MacroBuilder& builder);
+
+// Implementation
+
+// Names become file names: letters, digits, '-' and '_' only
+bool isValidMacroName(const char* name) {
+  size_t length = 0;
+  for (; name[length]; length++) {
+    char c = name[length];
+    if (!isalnum((unsigned char)c) && c != '-' && c != '_') return false;
+  }
+  return length > 0 && length <= MACRO_NAME_MAX;
+}
+
+bool isValidMacroHeader(const MacroHeader& header) {
+  return header.magic == MACRO_MAGIC && header.version == MACRO_VERSION &&
+         header.layout < LAYOUT_COUNT && header.intervalUs != 0;
+}
+
+void beginMacro(MacroBuilder& builder, uint8_t layout, uint16_t intervalUs) {
+  memset(&builder, 0, sizeof(builder));
+  builder.header.magic = MACRO_MAGIC;
+  builder.header.version = MACRO_VERSION;
+  builder.header.layout = layout;
+  builder.header.intervalUs = intervalUs;
+  builder.header.digest = FNV1A64_OFFSET;
+  builder.intervalUs = intervalUs;
+}
+
+void addMacroReports(MacroBuilder& builder, const HidReport* reports, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    builder.durationUs += hidReportDurationUs(reports[i], builder.intervalUs);
+    builder.hasRepeat = builder.hasRepeat || reports[i].opcode == HID_OP_REPEAT;
+  }
+  builder.header.reportCount += count;
+  builder.header.digest = fnv1a64(reports, count * sizeof(HidReport), builder.header.digest);
+}
+
+const MacroHeader& finishMacro(MacroBuilder& builder) {
+  builder.header.estimatedMs = (uint32_t)((builder.durationUs + 999) / 1000);
+  return builder.header;
+}
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef MACRO_STORE_H
+#define MACRO_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "macro_format.h"
+
+// Longest macro file path: MACRO_DIR "/" name MACRO_EXTENSION
+#define MACRO_PATH_SIZE 48
+
+// Macro upload being written to LittleFS
+typedef struct {
+  File file;
+  MacroBuilder builder;
+  bool binary;                           // Precompiled upload: header, then reports
+  bool headerDone;
+  bool failed;
+  MacroHeader uploadedHeader;            // Binary uploads, checked once complete
+  uint8_t partial[sizeof(MacroHeader)];  // Header or report split between blocks
+  size_t partialLength;
+  char name[MACRO_NAME_MAX + 1];
+} MacroWriter;
+
+// Function declarations
+void macroPath(char* path, size_t size, const char* name, const char* extension = MACRO_EXTENSION);
+bool beginMacroFile(MacroWriter& writer, const char* name, uint8_t layout, uint16_t intervalUs, bool binary);
+bool writeMacroReports(MacroWriter& writer, const HidReport* reports, size_t count);
+bool writeMacroBytes(MacroWriter& writer, const uint8_t* data, size_t length);
+bool finishMacroFile(MacroWriter& writer);
+void abortMacroFile(MacroWriter& writer);
+bool openMacro(const char* name, File& file, MacroHeader& header);
+bool removeMacro(const char* name);
+
+// Implementation
+void macroPath(char* path, size_t size, const char* name, const char* extension) {
+  snprintf(path, size, MACRO_DIR "/%s%s", name, extension);
+}
+
+// Written under a temporary name and renamed once complete, so a failed
+// upload never replaces a working macro
+bool beginMacroFile(MacroWriter& writer, const char* name, uint8_t layout, uint16_t intervalUs, bool binary) {
+  writer.binary = binary;
+  writer.headerDone = !binary;
+  writer.failed = false;
+  writer.partialLength = 0;
+  strncpy(writer.name, name, sizeof(writer.name) - 1);
+  writer.name[sizeof(writer.name) - 1] = '\0';
+  beginMacro(writer.builder, layout, intervalUs);
+
+  char path[MACRO_PATH_SIZE];
+  macroPath(path, sizeof(path), writer.name, ".tmp");
+  LittleFS.mkdir(MACRO_DIR);
+  writer.file = LittleFS.open(path, "w");
+  if (!writer.file) {
+    writer.failed = true;
+    return false;
+  }
+
+  // Placeholder, rewritten by finishMacroFile()
+  const MacroHeader& header = writer.builder.header;
+  if (writer.file.write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+    abortMacroFile(writer);
+  }
+  return !writer.failed;
+}
+
+bool writeMacroReports(MacroWriter& writer, const HidReport* reports, size_t count) {
+  if (writer.failed) {
+    return false;
+  }
+
+  size_t bytes = count * sizeof(HidReport);
+  if (writer.file.write((const uint8_t*)reports, bytes) != bytes) {
+    abortMacroFile(writer); // Filesystem full
+    return false;
+  }
+  addMacroReports(writer.builder, reports, count);
+  return true;
+}
+
+// A complete header or report from a precompiled upload
+void writeMacroRecord(MacroWriter& writer, const uint8_t* record) {
+  if (writer.headerDone) {
+    writeMacroReports(writer, (const HidReport*)record, 1);
+    return;
+  }
+
+  memcpy(&writer.uploadedHeader, record, sizeof(MacroHeader));
+  writer.headerDone = true;
+  if (!isValidMacroHeader(writer.uploadedHeader)) {
+    abortMacroFile(writer);
+    return;
+  }
+  // Layout and rate come from the compiled file
+  beginMacro(writer.builder, writer.uploadedHeader.layout, writer.uploadedHeader.intervalUs);
+}
+
+// Precompiled upload, in blocks of any size
+bool writeMacroBytes(MacroWriter& writer, const uint8_t* data, size_t length) {
+  while (length > 0 && !writer.failed) {
+    size_t needed = writer.headerDone ? sizeof(HidReport) : sizeof(MacroHeader);
+
+    // Header or report that does not fit in (the rest of) this block
+    if (writer.partialLength > 0 || length < needed) {
+      size_t take = needed - writer.partialLength;
+      if (take > length) take = length;
+      memcpy(writer.partial + writer.partialLength, data, take);
+      writer.partialLength += take;
+      data += take;
+      length -= take;
+      if (writer.partialLength == needed) {
+        writer.partialLength = 0;
+        writeMacroRecord(writer, writer.partial);
+      }
+      continue;
+    }
+
+    if (!writer.headerDone) {
+      writeMacroRecord(writer, data);
+      data += sizeof(MacroHeader);
+      length -= sizeof(MacroHeader);
+      continue;
+    }
+
+    size_t count = length / sizeof(HidReport);
+    writeMacroReports(writer, (const HidReport*)data, count);
+    data += count * sizeof(HidReport);
+    length -= count * sizeof(HidReport);
+  }
+  return !writer.failed;
+}
+
+bool finishMacroFile(MacroWriter& writer) {
+  if (writer.failed) {
+    return false;
+  }
+
+  // Files are played report by report, so a repeat would play its body once
+  // and its count would not be in reportCount or estimatedMs
+  if (writer.builder.hasRepeat) {
+    abortMacroFile(writer);
+    return false;
+  }
+
+  // A precompiled file must arrive whole and unchanged
+  if (writer.binary) {
+    const MacroHeader& expected = writer.uploadedHeader;
+    const MacroHeader& received = writer.builder.header;
+    if (!writer.headerDone || writer.partialLength != 0 ||
+        expected.reportCount != received.reportCount || expected.digest != received.digest) {
+      abortMacroFile(writer);
+      return false;
+    }
+  }
+
+  const MacroHeader& header = finishMacro(writer.builder);
+  bool written = writer.file.seek(0) &&
+                 writer.file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+  writer.file.close();
+
+  char tempPath[MACRO_PATH_SIZE];
+  char path[MACRO_PATH_SIZE];
+  macroPath(tempPath, sizeof(tempPath), writer.name, ".tmp");
+  macroPath(path, sizeof(path), writer.name);
+  if (!written) {
+    LittleFS.remove(tempPath);
+    writer.failed = true;
+    return false;
+  }
+
+  LittleFS.remove(path);
+  return LittleFS.rename(tempPath, path);
+}
+
+void abortMacroFile(MacroWriter& writer) {
+  char path[MACRO_PATH_SIZE];
+  macroPath(path, sizeof(path), writer.name, ".tmp");
+  writer.file.close();
+  LittleFS.remove(path);
+  writer.failed = true;
+}
+
+// Leaves the file positioned at the first report
+bool openMacro(const char* name, File& file, MacroHeader& header) {
+  char path[MACRO_PATH_SIZE];
+  if (!isValidMacroName(name)) {
+    return false;
+  }
+  macroPath(path, sizeof(path), name);
+  if (!LittleFS.exists(path)) {
+    return false;
+  }
+
+  file = LittleFS.open(path, "r");
+  if (!file) {
+    return false;
+  }
+  if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || !isValidMacroHeader(header) ||
+      file.size() != sizeof(header) + (size_t)header.reportCount * sizeof(HidReport)) {
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+bool removeMacro(const char* name) {
+  char path[MACRO_PATH_SIZE];
+  if (!isValidMacroName(name)) {
+    return false;
+  }
+  macroPath(path, sizeof(path), name);
+  return LittleFS.exists(path) && LittleFS.remove(path);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <malloc.h>
+
+// Always-on instrumentation, exported as Prometheus text by /metrics.
+// Histograms use fixed power-of-4 buckets in microseconds, so recording is a
+// count-leading-zeros and three adds. Each histogram or counter has a single
+// writer (core0, or core1 for HID playback), so no locks are needed; a reader
+// on the other core may see a sample half recorded, never a corrupted one.
+#define METRIC_BUCKETS      11    // 16 us, 64 us, ... 4.19 s, then +Inf
+#define METRIC_FIRST_BOUND  16
+
+// Routes timed by the web server
+#define ROUTE_PAGE         0
+#define ROUTE_SEND         1
+#define ROUTE_SEND_RAW     2
+#define ROUTE_JOB_STATUS   3
+#define ROUTE_MACRO_LIST   4
+#define ROUTE_MACRO_UPLOAD 5
+#define ROUTE_MACRO_PLAY   6
+#define ROUTE_MACRO_DELETE 7
+#define ROUTE_LIVE_PAGE    8
+#define ROUTE_LIVE_TOKEN   9
+#define ROUTE_STATUS       10
+#define ROUTE_METRICS      11
+#define ROUTE_LOGIN        12
+#define ROUTE_BATCH        13
+#define ROUTE_AUDIT        14
+#define ROUTE_COUNT        15
+
+// Latency histogram structure
+typedef struct {
+  uint32_t counts[METRIC_BUCKETS];  // Per bucket, not cumulative
+  uint32_t count;
+  uint64_t sumUs;
+} MetricHistogram;
+
+// Function declarations
+void recordMetric(MetricHistogram& histogram, uint32_t valueUs);
+uint32_t metricBucketBound(int bucket);
+size_t formatMetricHistogram(char* out, size_t size, const char* name, const char* labels, const MetricHistogram& histogram);
+size_t heapLargestFreeBlock();
+
+// Implementation
+const char* const ROUTE_NAMES[ROUTE_COUNT] = {
+  "page", "POST /send", "POST /send/raw", "GET /jobs/{}", "GET /macros", "PUT /macro/{}",
+  "POST /macro/{}", "DELETE /macro/{}", "GET /live", "GET /live/token", "GET /status", "GET /metrics",
+  "POST /login", "POST /batch", "GET /audit"
+};
+
+MetricHistogram routeLatency[ROUTE_COUNT];
+MetricHistogram authLatency;
+MetricHistogram hidWaitLatency;     // Core1: host collecting the previous report
+MetricHistogram liveLatency;        // Live key event to report sent
+MetricHistogram slackLatency;
+MetricHistogram loopLatency;
+uint32_t slackPostFailures = 0;
+
+// Smallest bucket whose bound holds the value: 16 * 4^k >= valueUs
+void recordMetric(MetricHistogram& histogram, uint32_t valueUs) {
+  int bucket = 0;
+  if (valueUs > METRIC_FIRST_BOUND) {
+    bucket = (32 - __builtin_clz(valueUs - 1) - 3) / 2;
+    if (bucket >= METRIC_BUCKETS) bucket = METRIC_BUCKETS - 1;
+  }
+  histogram.counts[bucket]++;
+  histogram.count++;
+  histogram.sumUs += valueUs;
+}
+
+// Upper bound of a bucket in microseconds; 0 for +Inf
+uint32_t metricBucketBound(int bucket) {
+  return bucket < METRIC_BUCKETS - 1 ? (uint32_t)METRIC_FIRST_BOUND << (2 * bucket) : 0;
+}
+
+// labels is empty or e.g. "route=\"GET /\"" (without braces)
+size_t formatMetricHistogram(char* out, size_t size, const char* name, const char* labels, const MetricHistogram& histogram) {
+  const char* separator = labels[0] ? "," : "";
+  size_t length = 0;
+  uint32_t cumulative = 0;
+
+  for (int i = 0; i < METRIC_BUCKETS && length < size; i++) {
+    char bound[12];
+    if (i < METRIC_BUCKETS - 1) {
+      snprintf(bound, sizeof(bound), "%lu", (unsigned long)metricBucketBound(i));
+    } else {
+      snprintf(bound, sizeof(bound), "+Inf");
+    }
+    cumulative += histogram.counts[i];
+    length += snprintf(out + length, size - length, "%s_bucket{%s%sle=\"%s\"} %lu\n",
+      name, labels, separator, bound, (unsigned long)cumulative);
+  }
+  if (length < size) {
+    const char* open = labels[0] ? "{" : "";
+    const char* close = labels[0] ? "}" : "";
+    length += snprintf(out + length, size - length, "%s_sum%s%s%s %llu\n%s_count%s%s%s %lu\n",
+      name, open, labels, close, (unsigned long long)histogram.sumUs,
+      name, open, labels, close, (unsigned long)histogram.count);
+  }
+  return length < size ? length : size - 1;
+}
+
+// newlib does not report the largest free chunk. The never-used space above
+// the heap arena plus the releasable top chunk is contiguous, so it is a lower
+// bound on the largest allocation that can still succeed.
+size_t heapLargestFreeBlock() {
+  struct mallinfo info = mallinfo();
+  return rp2040.getTotalHeap() - info.arena + info.keepcost;
+}
+
+#endif
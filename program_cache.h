@@ -0,0 +1,268 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+// Cache of compiled keystroke programs, keyed by a hash of the input and the
+// options it was compiled with, so sequences that are sent again and again
+// skip the compiler. Memory is set once from program_cache_kb: an index of
+// entries and one arena that holds every cached program back to back. Like
+// the client table, lookups scan a fixed window of the index; when the arena
+// is full the least recently used programs are evicted and the rest are
+// moved down to close the gaps. A program is only kept the second time it
+// misses, so one-off input does not push out the sequences that repeat.
+// The input is kept after its program and compared before a hit is used, so a
+// hash collision compiles the input instead of typing another one's keys.
+// Core0 only. No Arduino dependencies.
+#include <algorithm>
+#include "keystroke_compiler.h"
+
+// One index entry per this many bytes of program_cache_kb
+#define PROGRAM_CACHE_BYTES_PER_ENTRY 128
+#define PROGRAM_CACHE_MIN_ENTRIES     8
+#define PROGRAM_CACHE_PROBE_WINDOW    8
+#define PROGRAM_CACHE_DEFAULT_KB      16
+#define PROGRAM_CACHE_MAX_KB          64
+
+// Programs longer than this share of the arena are compiled every time, so
+// one long paste does not flush everything else
+#define PROGRAM_CACHE_MAX_SHARE 4
+
+// Cache entry structure
+typedef struct {
+  uint64_t key;          // programCacheKey() of the input
+  uint32_t lastUsed;     // Tick of the last store or hit; 0 marks a free slot
+  uint16_t offset;       // First report in the arena
+  uint16_t count;
+  uint16_t inputLength;  // Input bytes stored after the reports
+} ProgramCacheEntry;
+
+// Global cache state
+extern uint32_t programCacheHits;
+extern uint32_t programCacheMisses;
+extern uint32_t programCacheEvictions;
+extern uint32_t programCacheEntries;
+extern uint32_t programCacheReports;
+
+// Function declarations
+void initializeProgramCache(uint16_t kb);
+uint64_t programCacheKey(const char* input, size_t length, const KeystrokeOptions& options);
+bool lookupCachedProgram(uint64_t key, const char* input, size_t length, KeystrokeProgram& program);
+void storeCachedProgram(uint64_t key, const char* input, size_t length, const HidReport* reports, size_t count);
+void compileCachedKeystrokeSequence(const char* input, size_t length, KeystrokeProgram& program,
+                                    const KeystrokeOptions& options = DEFAULT_KEYSTROKE_OPTIONS);
+
+// Implementation
+std::vector<ProgramCacheEntry> programCacheIndex;
+std::vector<HidReport> programCacheArena;
+std::vector<uint16_t> programCacheOrder;  // Scratch for compaction, sized with the index
+std::vector<uint32_t> programCacheMissed; // Upper key half of the last miss per slot
+uint32_t programCacheTick = 0;
+uint32_t programCacheEnd = 0;             // First free report after the last program
+
+uint32_t programCacheHits = 0;
+uint32_t programCacheMisses = 0;
+uint32_t programCacheEvictions = 0;
+uint32_t programCacheEntries = 0;
+uint32_t programCacheReports = 0;         // Arena slots held by programs and their input, not counting gaps
+
+// Sizes the index and the arena once; 0 KB turns the cache off. Calling it
+// again with the same size keeps what is cached.
+void initializeProgramCache(uint16_t kb) {
+  size_t bytes = (size_t)(kb < PROGRAM_CACHE_MAX_KB ? kb : PROGRAM_CACHE_MAX_KB) * 1024;
+  size_t entries = 0;
+  size_t reports = 0;
+  if (bytes > 0) {
+    entries = PROGRAM_CACHE_MIN_ENTRIES;
+    while (entries * 2 <= bytes / PROGRAM_CACHE_BYTES_PER_ENTRY) entries *= 2;
+    reports = (bytes - entries * (sizeof(ProgramCacheEntry) + sizeof(uint16_t) + sizeof(uint32_t))) / sizeof(HidReport);
+  }
+  if (entries == programCacheIndex.size() && reports == programCacheArena.size()) {
+    return;
+  }
+
+  std::vector<ProgramCacheEntry>(entries, ProgramCacheEntry{0, 0, 0, 0, 0}).swap(programCacheIndex);
+  std::vector<HidReport>(reports).swap(programCacheArena);
+  std::vector<uint16_t>(entries).swap(programCacheOrder);
+  std::vector<uint32_t>(entries).swap(programCacheMissed);
+  programCacheTick = 0;
+  programCacheEnd = 0;
+  programCacheEntries = 0;
+  programCacheReports = 0;
+}
+
+// The options are part of the key: the same text compiles differently per layout
+uint64_t programCacheKey(const char* input, size_t length, const KeystrokeOptions& options) {
+  uint8_t suffix[6] = {options.layout, options.coalesceReleases, (uint8_t)length, (uint8_t)(length >> 8),
+                       (uint8_t)(length >> 16), (uint8_t)(length >> 24)};
+  return fnv1a64(suffix, sizeof(suffix), fnv1a64(input, length));
+}
+
+uint32_t programCacheSlotIndex(uint64_t key) {
+  return (uint32_t)key & (programCacheIndex.size() - 1);
+}
+
+// Arena slots for a program of count reports and its input
+uint32_t programCacheSpan(size_t count, size_t length) {
+  return count + (length + sizeof(HidReport) - 1) / sizeof(HidReport);
+}
+
+uint32_t programCacheSpan(const ProgramCacheEntry& entry) {
+  return programCacheSpan(entry.count, entry.inputLength);
+}
+
+// True if the input stored with entry is the given one
+bool isCachedInput(const ProgramCacheEntry& entry, const char* input, size_t length) {
+  return entry.inputLength == length && memcmp(&programCacheArena[entry.offset + entry.count], input, length) == 0;
+}
+
+// Ticks start at 1 so 0 can mark free slots; on wrap every entry is dropped
+uint32_t nextProgramCacheTick() {
+  if (++programCacheTick == 0) {
+    for (ProgramCacheEntry& entry : programCacheIndex) entry.lastUsed = 0;
+    programCacheEnd = 0;
+    programCacheEntries = 0;
+    programCacheReports = 0;
+    programCacheTick = 1;
+  }
+  return programCacheTick;
+}
+
+void evictProgramCacheEntry(ProgramCacheEntry& entry) {
+  entry.lastUsed = 0;
+  programCacheEntries--;
+  programCacheReports -= programCacheSpan(entry);
+  programCacheEvictions++;
+}
+
+// Moves every program to the start of the arena, in arena order
+void compactProgramCache() {
+  size_t live = 0;
+  for (size_t i = 0; i < programCacheIndex.size(); i++) {
+    if (programCacheIndex[i].lastUsed != 0) programCacheOrder[live++] = i;
+  }
+  std::sort(programCacheOrder.begin(), programCacheOrder.begin() + live, [](uint16_t a, uint16_t b) {
+    return programCacheIndex[a].offset < programCacheIndex[b].offset;
+  });
+
+  uint32_t end = 0;
+  for (size_t i = 0; i < live; i++) {
+    ProgramCacheEntry& entry = programCacheIndex[programCacheOrder[i]];
+    uint32_t span = programCacheSpan(entry);
+    if (entry.offset != end) {
+      memmove(&programCacheArena[end], &programCacheArena[entry.offset], span * sizeof(HidReport));
+      entry.offset = end;
+    }
+    end += span;
+  }
+  programCacheEnd = end;
+}
+
+// Evicts the least recently used programs until at most target reports are
+// held, then closes the gaps. Trimming well below full means the arena is
+// compacted once per quarter of its size written, not on every store.
+void trimProgramCache(uint32_t target) {
+  size_t live = 0;
+  for (size_t i = 0; i < programCacheIndex.size(); i++) {
+    if (programCacheIndex[i].lastUsed != 0) programCacheOrder[live++] = i;
+  }
+  std::sort(programCacheOrder.begin(), programCacheOrder.begin() + live, [](uint16_t a, uint16_t b) {
+    return programCacheIndex[a].lastUsed < programCacheIndex[b].lastUsed;
+  });
+  for (size_t i = 0; i < live && programCacheReports > target; i++) {
+    evictProgramCacheEntry(programCacheIndex[programCacheOrder[i]]);
+  }
+  compactProgramCache();
+}
+
+// Appends the cached reports for input, whose key is key, to program; false on a miss
+bool lookupCachedProgram(uint64_t key, const char* input, size_t length, KeystrokeProgram& program) {
+  if (programCacheIndex.empty()) {
+    return false;
+  }
+
+  uint32_t index = programCacheSlotIndex(key);
+  for (uint32_t i = 0; i < PROGRAM_CACHE_PROBE_WINDOW; i++) {
+    ProgramCacheEntry& entry = programCacheIndex[(index + i) & (programCacheIndex.size() - 1)];
+    if (entry.lastUsed != 0 && entry.key == key && isCachedInput(entry, input, length)) {
+      uint32_t tick = nextProgramCacheTick();
+      if (entry.lastUsed == 0) {
+        break; // Dropped by the tick wrapping
+      }
+      entry.lastUsed = tick;
+      const HidReport* reports = &programCacheArena[entry.offset];
+      program.insert(program.end(), reports, reports + entry.count);
+      programCacheHits++;
+      return true;
+    }
+  }
+  programCacheMisses++;
+  return false;
+}
+
+// Keeps a copy of count reports and their input under key, evicting the least
+// recently used programs when the arena is full. Programs too long to be worth
+// caching are skipped.
+void storeCachedProgram(uint64_t key, const char* input, size_t length, const HidReport* reports, size_t count) {
+  size_t capacity = programCacheArena.size();
+  uint32_t span = programCacheSpan(count, length);
+  if (count == 0 || length > UINT16_MAX || span > capacity / PROGRAM_CACHE_MAX_SHARE) {
+    return;
+  }
+
+  // Room in the window first, so the arena evictions below cannot take the slot
+  uint32_t index = programCacheSlotIndex(key);
+  ProgramCacheEntry* slot = nullptr;
+  for (uint32_t i = 0; i < PROGRAM_CACHE_PROBE_WINDOW; i++) {
+    ProgramCacheEntry& entry = programCacheIndex[(index + i) & (programCacheIndex.size() - 1)];
+    if (entry.lastUsed == 0) {
+      slot = &entry;
+      break;
+    }
+    if (!slot || entry.lastUsed < slot->lastUsed) {
+      slot = &entry;
+    }
+  }
+  if (slot->lastUsed != 0) {
+    evictProgramCacheEntry(*slot);
+  }
+
+  if (programCacheEnd + span > capacity) {
+    trimProgramCache(capacity - capacity / PROGRAM_CACHE_MAX_SHARE - span);
+  }
+
+  uint32_t tick = nextProgramCacheTick();
+  memcpy(&programCacheArena[programCacheEnd], reports, count * sizeof(HidReport));
+  memcpy(&programCacheArena[programCacheEnd + count], input, length);
+  slot->key = key;
+  slot->lastUsed = tick;
+  slot->offset = programCacheEnd;
+  slot->count = count;
+  slot->inputLength = length;
+  programCacheEnd += span;
+  programCacheEntries++;
+  programCacheReports += span;
+}
+
+// compileKeystrokeSequence() through the cache; a miss is stored if the same
+// key was the last one to miss in its slot
+void compileCachedKeystrokeSequence(const char* input, size_t length, KeystrokeProgram& program,
+                                    const KeystrokeOptions& options) {
+  if (programCacheIndex.empty()) {
+    compileKeystrokeSequence(input, length, program, options);
+    return;
+  }
+
+  uint64_t key = programCacheKey(input, length, options);
+  if (lookupCachedProgram(key, input, length, program)) {
+    return;
+  }
+  size_t start = program.size();
+  compileKeystrokeSequence(input, length, program, options);
+  uint32_t& missed = programCacheMissed[programCacheSlotIndex(key)];
+  if (missed == (uint32_t)(key >> 32)) {
+    storeCachedProgram(key, input, length, program.data() + start, program.size() - start);
+  } else {
+    missed = key >> 32;
+  }
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef REPORT_RING_H
+#define REPORT_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// One core calls push(), the other calls pop(); no other locking is needed.
+// Kept free of Arduino dependencies so it also builds on the host.
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  // Producer side
+  bool push(const T& item) {
+    uint32_t head = headIndex.load(std::memory_order_relaxed);
+    if (head - tailIndex.load(std::memory_order_acquire) >= Capacity) {
+      return false; // Full
+    }
+    items[head & (Capacity - 1)] = item;
+    headIndex.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t space() const {
+    return Capacity - size();
+  }
+
+  // Consumer side
+  bool pop(T& item) {
+    uint32_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (headIndex.load(std::memory_order_acquire) == tail) {
+      return false; // Empty
+    }
+    item = items[tail & (Capacity - 1)];
+    tailIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side; a snapshot that may be stale by the time it is used
+  size_t size() const {
+    uint32_t tail = tailIndex.load(std::memory_order_acquire);
+    return headIndex.load(std::memory_order_acquire) - tail;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+ private:
+  T items[Capacity];
+  std::atomic<uint32_t> headIndex{0}; // Written by the producer only
+  std::atomic<uint32_t> tailIndex{0}; // Written by the consumer only
+};
+
+#endif
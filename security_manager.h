@@ -2,76 +2,187 @@
 #define SECURITY_MANAGER_H
 
 #include <Arduino.h>
-#include <map>
+#include "config_manager.h"
 
 // Security configuration constants
 #define MAX_FAILED_ATTEMPTS 3
 #define BLOCK_DURATION_MS (60 * 60 * 1000) // 60 minutes in milliseconds
 
+// Client tracking table: open addressing over a fixed number of slots. Lookups
+// scan a fixed window, so empty slots need no tombstones and every check
+// touches the same number of entries however many clients have been seen.
+#define CLIENT_TABLE_BITS 6
+#define CLIENT_TABLE_SIZE (1 << CLIENT_TABLE_BITS)
+#define CLIENT_PROBE_WINDOW 8
+
+// Client record kinds
+#define CLIENT_SLOT_EMPTY   0
+#define CLIENT_SLOT_ADDRESS 1
+#define CLIENT_SLOT_SUBNET  2 // Blocked /24, used when block_subnet=1
+
+// Client record structure
+typedef struct {
+  uint32_t key;        // IPv4 address in host order, or its /24 prefix
+  uint8_t kind;
+  uint8_t failedAttempts;
+  bool blocked;
+  uint32_t lastSeen;   // millis() of the last failure, or of the block
+} ClientRecord;
+
 // Global security state
-extern std::map<String, int> clientFailedAttempts;
-extern std::map<String, unsigned long> blockedClientIPs;
+extern ClientRecord clientRecords[CLIENT_TABLE_SIZE];
+extern uint32_t clientRecordsEvicted;
 
 // Function declarations
-bool isClientBlocked(const String& clientIP);
-void recordFailedAttempt(const String& clientIP);
-void blockClient(const String& clientIP);
-void clearFailedAttempts(const String& clientIP);
+bool isClientBlocked(const IPAddress& clientIP);
+void recordFailedAttempt(const IPAddress& clientIP);
+void blockClient(const IPAddress& clientIP);
+void clearFailedAttempts(const IPAddress& clientIP);
+int getFailedAttemptCount(const IPAddress& clientIP);
 void unblockExpiredIPs();
+int countBlockedClients();
 
 // Implementation
-std::map<String, int> clientFailedAttempts;
-std::map<String, unsigned long> blockedClientIPs;
+ClientRecord clientRecords[CLIENT_TABLE_SIZE];
+uint32_t clientRecordsEvicted = 0;
+
+uint32_t clientAddress(const IPAddress& clientIP) {
+  return (uint32_t)clientIP[0] << 24 | (uint32_t)clientIP[1] << 16 | (uint32_t)clientIP[2] << 8 | clientIP[3];
+}
+
+// Fibonacci hashing; neighbouring addresses land in different windows
+uint32_t clientSlotIndex(uint32_t key) {
+  return (uint32_t)(key * 2654435761u) >> (32 - CLIENT_TABLE_BITS);
+}
+
+// Blocks last BLOCK_DURATION_MS; failure counts are forgotten after the same idle time
+bool isExpiredClientRecord(const ClientRecord& record, uint32_t now) {
+  return record.kind != CLIENT_SLOT_EMPTY && now - record.lastSeen >= BLOCK_DURATION_MS;
+}
 
-bool isClientBlocked(const String& clientIP) {
-  if (!blockedClientIPs.count(clientIP)) {
-    return false;
+// Returns the live record for key, or nullptr; expired records in the window are cleared
+ClientRecord* findClientRecord(uint32_t key, uint8_t kind, uint32_t now) {
+  uint32_t index = clientSlotIndex(key);
+  ClientRecord* found = nullptr;
+
+  for (uint32_t i = 0; i < CLIENT_PROBE_WINDOW; i++) {
+    ClientRecord& record = clientRecords[(index + i) & (CLIENT_TABLE_SIZE - 1)];
+    if (isExpiredClientRecord(record, now)) {
+      record.kind = CLIENT_SLOT_EMPTY;
+    } else if (record.kind == kind && record.key == key) {
+      found = &record;
+    }
   }
-  
-  unsigned long currentTime = millis();
-  unsigned long blockTime = blockedClientIPs[clientIP];
-  
-  // Check if block has expired
-  if (currentTime - blockTime >= BLOCK_DURATION_MS) {
-    blockedClientIPs.erase(clientIP);
-    return false;
+  return found;
+}
+
+// Takes a free slot in the window, else evicts the least recently seen record,
+// sparing blocked clients while unblocked ones remain
+ClientRecord* insertClientRecord(uint32_t key, uint8_t kind, uint32_t now) {
+  uint32_t index = clientSlotIndex(key);
+  ClientRecord* victim = nullptr;
+
+  for (uint32_t i = 0; i < CLIENT_PROBE_WINDOW; i++) {
+    ClientRecord& record = clientRecords[(index + i) & (CLIENT_TABLE_SIZE - 1)];
+    if (record.kind == CLIENT_SLOT_EMPTY) {
+      victim = &record;
+      break;
+    }
+    if (!victim || (victim->blocked && !record.blocked) ||
+        (victim->blocked == record.blocked && now - record.lastSeen > now - victim->lastSeen)) {
+      victim = &record;
+    }
   }
-  
-  return true;
+
+  if (victim->kind != CLIENT_SLOT_EMPTY) {
+    clientRecordsEvicted++;
+  }
+  victim->key = key;
+  victim->kind = kind;
+  victim->failedAttempts = 0;
+  victim->blocked = false;
+  victim->lastSeen = now;
+  return victim;
+}
+
+bool isClientBlocked(const IPAddress& clientIP) {
+  uint32_t now = millis();
+  uint32_t address = clientAddress(clientIP);
+
+  const ClientRecord* record = findClientRecord(address, CLIENT_SLOT_ADDRESS, now);
+  if (record && record->blocked) {
+    return true;
+  }
+
+  // Subnet records only exist while blocked
+  return deviceConfig.blockSubnet && findClientRecord(address & 0xFFFFFF00, CLIENT_SLOT_SUBNET, now);
 }
 
-void recordFailedAttempt(const String& clientIP) {
-  if (clientFailedAttempts.count(clientIP)) {
-    clientFailedAttempts[clientIP]++;
-  } else {
-    clientFailedAttempts[clientIP] = 0;
+void recordFailedAttempt(const IPAddress& clientIP) {
+  uint32_t now = millis();
+  uint32_t address = clientAddress(clientIP);
+
+  ClientRecord* record = findClientRecord(address, CLIENT_SLOT_ADDRESS, now);
+  if (!record) {
+    record = insertClientRecord(address, CLIENT_SLOT_ADDRESS, now);
   }
+  if (record->failedAttempts < UINT8_MAX) record->failedAttempts++;
+  record->lastSeen = now;
 }
 
-void blockClient(const String& clientIP) {
-  blockedClientIPs[clientIP] = millis();
-  clientFailedAttempts.erase(clientIP); // Reset count after blocking
+void blockClient(const IPAddress& clientIP) {
+  uint32_t now = millis();
+  uint32_t address = clientAddress(clientIP);
+  uint32_t key = address;
+  uint8_t kind = CLIENT_SLOT_ADDRESS;
+
+  if (deviceConfig.blockSubnet) {
+    key = address & 0xFFFFFF00;
+    kind = CLIENT_SLOT_SUBNET;
+    clearFailedAttempts(clientIP);
+  }
+
+  ClientRecord* record = findClientRecord(key, kind, now);
+  if (!record) {
+    record = insertClientRecord(key, kind, now);
+  }
+  record->blocked = true;
+  record->failedAttempts = 0; // Reset count after blocking
+  record->lastSeen = now;
 }
 
-void clearFailedAttempts(const String& clientIP) {
-  clientFailedAttempts.erase(clientIP);
+void clearFailedAttempts(const IPAddress& clientIP) {
+  ClientRecord* record = findClientRecord(clientAddress(clientIP), CLIENT_SLOT_ADDRESS, millis());
+  if (record && !record->blocked) {
+    record->kind = CLIENT_SLOT_EMPTY;
+  }
 }
 
-int getFailedAttemptCount(const String& clientIP) {
-  return clientFailedAttempts.count(clientIP) ? clientFailedAttempts[clientIP] : 0;
+int getFailedAttemptCount(const IPAddress& clientIP) {
+  const ClientRecord* record = findClientRecord(clientAddress(clientIP), CLIENT_SLOT_ADDRESS, millis());
+  return record ? record->failedAttempts : 0;
 }
 
+// Lookups already expire records in their window; this sweeps the rest
 void unblockExpiredIPs() {
-  unsigned long currentTime = millis();
-  
-  auto it = blockedClientIPs.begin();
-  while (it != blockedClientIPs.end()) {
-    if (currentTime - it->second >= BLOCK_DURATION_MS) {
-      it = blockedClientIPs.erase(it);
-    } else {
-      ++it;
+  uint32_t now = millis();
+  for (ClientRecord& record : clientRecords) {
+    if (isExpiredClientRecord(record, now)) {
+      record.kind = CLIENT_SLOT_EMPTY;
+    }
+  }
+}
+
+// Addresses and subnets currently blocked
+int countBlockedClients() {
+  uint32_t now = millis();
+  int blocked = 0;
+  for (const ClientRecord& record : clientRecords) {
+    if (record.kind != CLIENT_SLOT_EMPTY && record.blocked && !isExpiredClientRecord(record, now)) {
+      blocked++;
     }
   }
+  return blocked;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -2,56 +2,313 @@
 #define SLACK_NOTIFIER_H
 
 #include <Arduino.h>
+#include <WiFi.h>
 #include <WiFiClientSecure.h>
+#include "config_manager.h"
+#include "metrics.h"
 
 //#define DEBUG
 
+// Events waiting for the next post; once full, further events are only counted
+#define SLACK_OUTBOX_SIZE 16
+
+// At most one webhook post per interval; repeats of an event within it are coalesced
+#define SLACK_POST_INTERVAL_MS 30000
+
+#define SLACK_DETAIL_SIZE 96
+#define SLACK_PAYLOAD_SIZE 2048
+#define SLACK_RESPONSE_TIMEOUT_MS 2000
+
+// Event types
+#define SLACK_EVENT_TEXT         0
+#define SLACK_EVENT_AUTH_PROMPT  1
+#define SLACK_EVENT_AUTH_FAILED  2
+#define SLACK_EVENT_AUTH_BLOCKED 3
+#define SLACK_EVENT_AUTH_SUCCESS 4
+#define SLACK_EVENT_KEYSTROKES   5
+#define SLACK_EVENT_MACRO_STORED 6
+#define SLACK_EVENT_LIVE_SESSION 7
+
+// Slack event structure
+typedef struct {
+  uint8_t type;
+  uint8_t ip[4];
+  uint16_t count;    // Occurrences coalesced into this event
+  uint32_t firstMs;
+  uint32_t lastMs;
+  char detail[SLACK_DETAIL_SIZE];
+} SlackEvent;
+
 // Function declarations
-void sendSlackNotification(const String& message, const char* webhookPath);
+void queueSlackEvent(uint8_t type, const IPAddress& ip, const char* detail);
+void queueSlackMessage(const char* text);
+void serviceSlackNotifier();
 
 // Implementation
-void sendSlackNotification(const String& message, const char* webhookPath) {
-  const char* slackHost = "hooks.slack.com";
-  const int slackPort = 443;
+SlackEvent slackOutbox[SLACK_OUTBOX_SIZE];
+uint8_t slackOutboxCount = 0;
+uint32_t slackEventsDropped = 0;
+uint32_t slackEventsDroppedReported = 0;
+uint32_t lastSlackPostMs = 0;
+bool slackPostAttempted = false;
 
-  WiFiClientSecure client;
-  client.setInsecure(); // Skip SSL certificate verification
+// One connection is kept open between posts; TLS sessions are resumed on reconnect
+WiFiClient slackPlainClient;
+WiFiClientSecure slackTlsClient;
+BearSSL::Session slackTlsSession;
 
-  // Connect to Slack
-  if (!client.connect(slackHost, slackPort)) {
-    #ifdef DEBUG
-      Serial.println("Failed to connect to Slack");
-    #endif
+// Auth events from the same client and page are counted rather than repeated
+bool isCoalescedSlackEvent(uint8_t type) {
+  return type >= SLACK_EVENT_AUTH_PROMPT && type <= SLACK_EVENT_AUTH_SUCCESS;
+}
+
+// Message prefix; the client address follows
+const char* slackEventLabel(uint8_t type) {
+  switch (type) {
+    case SLACK_EVENT_AUTH_PROMPT:  return "Authentication prompt shown for IP: ";
+    case SLACK_EVENT_AUTH_FAILED:  return "Authentication failed for IP: ";
+    case SLACK_EVENT_AUTH_BLOCKED: return "Failed authentication attempt threshold reached for IP: ";
+    case SLACK_EVENT_AUTH_SUCCESS: return "Successful authentication for IP: ";
+    case SLACK_EVENT_KEYSTROKES:   return "Keystrokes queued by IP: ";
+    case SLACK_EVENT_MACRO_STORED: return "Macro stored by IP: ";
+    case SLACK_EVENT_LIVE_SESSION: return "Live typing session opened by IP: ";
+    default:                       return "";
+  }
+}
+
+void queueSlackEvent(uint8_t type, const IPAddress& ip, const char* detail) {
+  if (deviceConfig.slackWebhook[0] == '\0') {
+    return;
+  }
+
+  uint32_t now = millis();
+  if (isCoalescedSlackEvent(type)) {
+    for (uint8_t i = 0; i < slackOutboxCount; i++) {
+      SlackEvent& event = slackOutbox[i];
+      if (event.type == type && event.ip[0] == ip[0] && event.ip[1] == ip[1] &&
+          event.ip[2] == ip[2] && event.ip[3] == ip[3] && strcmp(event.detail, detail) == 0) {
+        if (event.count < UINT16_MAX) event.count++;
+        event.lastMs = now;
+        return;
+      }
+    }
+  }
+
+  if (slackOutboxCount == SLACK_OUTBOX_SIZE) {
+    slackEventsDropped++;
     return;
   }
 
-  // Compose Slack message payload
-  String payload = "{\"text\": \"" + message + "\"}";
+  SlackEvent& event = slackOutbox[slackOutboxCount++];
+  event.type = type;
+  for (int i = 0; i < 4; i++) event.ip[i] = ip[i];
+  event.count = 1;
+  event.firstMs = now;
+  event.lastMs = now;
+  strncpy(event.detail, detail, sizeof(event.detail) - 1);
+  event.detail[sizeof(event.detail) - 1] = '\0';
+}
+
+void queueSlackMessage(const char* text) {
+  queueSlackEvent(SLACK_EVENT_TEXT, IPAddress(0, 0, 0, 0), text);
+}
+
+// Append text as the inside of a JSON string; false if it does not fit
+bool appendJsonEscaped(char* out, size_t size, size_t& length, const char* text) {
+  size_t pos = length;
+  for (; *text; text++) {
+    unsigned char c = *text;
+    char escaped[8];
+    size_t n = 2;
+    escaped[0] = '\\';
+    switch (c) {
+      case '"':  escaped[1] = '"'; break;
+      case '\\': escaped[1] = '\\'; break;
+      case '\n': escaped[1] = 'n'; break;
+      case '\r': escaped[1] = 'r'; break;
+      case '\t': escaped[1] = 't'; break;
+      default:
+        if (c < 0x20) {
+          n = snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        } else {
+          escaped[0] = c < 0x80 ? c : '?'; // Keystroke data is ASCII; keep the payload valid UTF-8
+          n = 1;
+        }
+    }
+    if (pos + n >= size) {
+      return false;
+    }
+    memcpy(out + pos, escaped, n);
+    pos += n;
+  }
+  out[pos] = '\0';
+  length = pos;
+  return true;
+}
 
-  // Send POST request
-  client.printf("POST %s HTTP/1.1\r\n", webhookPath);
-  client.printf("Host: %s\r\n", slackHost);
-  client.println("Content-Type: application/json");
-  client.printf("Content-Length: %d\r\n", payload.length());
-  client.println("Connection: close\r\n");
-  client.println(payload);
+void formatSlackEvent(const SlackEvent& event, char* line, size_t size) {
+  if (event.type == SLACK_EVENT_TEXT) {
+    snprintf(line, size, "%s", event.detail);
+    return;
+  }
+
+  int length = snprintf(line, size, "%s%u.%u.%u.%u%s", slackEventLabel(event.type),
+    event.ip[0], event.ip[1], event.ip[2], event.ip[3], event.detail);
+  if (event.count > 1 && length > 0 && (size_t)length < size) {
+    snprintf(line + length, size - length, " (%u times in %lu s)",
+      event.count, (unsigned long)((event.lastMs - event.firstMs + 999) / 1000));
+  }
+}
+
+// Reads the status line and headers, then skips the body so the connection can be reused.
+// Returns the HTTP status, or 0 if no response arrived.
+int readSlackResponse(WiFiClient& client) {
+  char line[128];
+  size_t length = client.readBytesUntil('\n', line, sizeof(line) - 1);
+  line[length] = '\0';
+  if (length < 12 || strncmp(line, "HTTP/1.", 7) != 0) {
+    client.stop();
+    return 0;
+  }
+  int status = atoi(line + 9);
+
+  long contentLength = -1;
+  bool keepAlive = true;
+  while (true) {
+    length = client.readBytesUntil('\n', line, sizeof(line) - 1);
+    line[length] = '\0';
+    if (length > 0 && line[length - 1] == '\r') line[--length] = '\0';
+    if (length == 0) break;
 
-  // Read response headers
-  while (client.connected()) {
-    String line = client.readStringUntil('\n');
-    if (line == "\r") break;
     #ifdef DEBUG
       Serial.println(line);
     #endif
+    if (strncasecmp(line, "Content-Length:", 15) == 0) {
+      contentLength = strtol(line + 15, nullptr, 10);
+    } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close")) {
+      keepAlive = false;
+    }
+  }
+
+  // Without a length (e.g. chunked) the end of the body is unknown; start fresh next time
+  if (contentLength < 0) {
+    keepAlive = false;
+  }
+  while (keepAlive && contentLength > 0) {
+    size_t chunk = contentLength < (long)sizeof(line) ? contentLength : sizeof(line);
+    size_t received = client.readBytes(line, chunk);
+    if (received == 0) {
+      keepAlive = false;
+    }
+    contentLength -= received;
+  }
+
+  if (!keepAlive) {
+    client.stop();
+  }
+  return status;
+}
+
+// Returns the HTTP status, or 0 if the webhook could not be reached
+int postSlackPayload(const char* payload, size_t length) {
+  WiFiClient& client = deviceConfig.slackTls ? slackTlsClient : slackPlainClient;
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = client.connected();
+    if (!reused) {
+      client.stop();
+      if (deviceConfig.slackTls) {
+        slackTlsClient.setInsecure(); // Skip SSL certificate verification
+        slackTlsClient.setSession(&slackTlsSession);
+      }
+      if (!client.connect(deviceConfig.slackHost, deviceConfig.slackPort)) {
+        #ifdef DEBUG
+          Serial.println("Failed to connect to Slack");
+        #endif
+        return 0;
+      }
+    }
+
+    client.setTimeout(SLACK_RESPONSE_TIMEOUT_MS);
+    client.printf("POST %s HTTP/1.1\r\n", deviceConfig.slackWebhook);
+    client.printf("Host: %s\r\n", deviceConfig.slackHost);
+    client.print("Content-Type: application/json\r\n");
+    client.printf("Content-Length: %u\r\n", (unsigned)length);
+    client.print("Connection: keep-alive\r\n\r\n");
+    client.write((const uint8_t*)payload, length);
+
+    int status = readSlackResponse(client);
+    if (status != 0 || !reused) {
+      return status;
+    }
+    // The server closed the idle connection; reconnect once
+  }
+  return 0;
+}
+
+// Called from loop(): posts everything queued since the last post as one message
+void serviceSlackNotifier() {
+  static char payload[SLACK_PAYLOAD_SIZE];
+
+  if (slackOutboxCount == 0 && slackEventsDropped == slackEventsDroppedReported) {
+    return;
+  }
+  if (slackPostAttempted && millis() - lastSlackPostMs < SLACK_POST_INTERVAL_MS) {
+    return;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+
+  const char prefix[] = "{\"text\":\"";
+  const char suffix[] = "\"}";
+  size_t length = sizeof(prefix) - 1;
+  size_t limit = sizeof(payload) - (sizeof(suffix) - 1);
+  memcpy(payload, prefix, length);
+
+  // Events that do not fit stay queued for the next post
+  char line[SLACK_DETAIL_SIZE + 128];
+  uint8_t included = 0;
+  while (included < slackOutboxCount) {
+    size_t mark = length;
+    formatSlackEvent(slackOutbox[included], line, sizeof(line));
+    if ((included > 0 && !appendJsonEscaped(payload, limit, length, "\n")) ||
+        !appendJsonEscaped(payload, limit, length, line)) {
+      length = mark;
+      break;
+    }
+    included++;
+  }
+
+  uint32_t dropped = slackEventsDropped;
+  if (dropped != slackEventsDroppedReported) {
+    snprintf(line, sizeof(line), "%s(%lu notifications dropped, outbox full)", included ? "\n" : "",
+      (unsigned long)(dropped - slackEventsDroppedReported));
+    appendJsonEscaped(payload, limit, length, line);
+  }
+  memcpy(payload + length, suffix, sizeof(suffix));
+  length += sizeof(suffix) - 1;
+
+  lastSlackPostMs = millis();
+  slackPostAttempted = true;
+  uint32_t started = micros();
+  int status = postSlackPayload(payload, length);
+  recordMetric(slackLatency, micros() - started);
+  if (status < 200 || status > 299) {
+    slackPostFailures++;
+  }
+  if (status == 0) {
+    return; // Unreachable; retry on the next interval
   }
 
   #ifdef DEBUG
-    String response = client.readString();
-    Serial.println("Slack response:");
-    Serial.println(response);
+    Serial.printf("Slack response: %d\n", status);
   #endif
 
-  client.stop();
+  // Delivered, or rejected by the server; either way resending will not help
+  memmove(slackOutbox, slackOutbox + included, (slackOutboxCount - included) * sizeof(SlackEvent));
+  slackOutboxCount -= included;
+  slackEventsDroppedReported = dropped;
 }
 
-#endif
\ No newline at end of file
+#endif
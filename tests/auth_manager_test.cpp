@@ -0,0 +1,140 @@
+// Digest checks in auth_manager.h: each nonce takes only increasing nc values,
+// a request cannot be sent twice, and the nonce table stays bounded however
+// many nonces are used
+#include <string>
+#include "../auth_manager.h"
+#include "test_check.h"
+
+static const char* USERNAME = "admin";
+static const char* PASSWORD = "correct horse";
+static const char* REALM = "Test Realm";
+static const char* PAGE = "/keys";
+static const IPAddress CLIENT(192, 168, 1, 20);
+
+static std::string md5Text(const std::string& text) {
+  char out[33];
+  MD5Builder md5;
+  md5.begin();
+  md5.add(text.c_str());
+  md5.calculate();
+  md5.getChars(out);
+  return out;
+}
+
+// Nonce from a fresh challenge
+static std::string freshNonce() {
+  char challenge[128];
+  formatDigestChallenge(challenge, sizeof(challenge), false);
+  const char* start = strstr(challenge, "nonce=\"") + 7;
+  return std::string(start, DIGEST_NONCE_SIZE - 1);
+}
+
+// Authorization header for the page; an empty nc leaves out qop, as RFC 2069 clients do
+static std::string digestHeader(const std::string& nonce, const std::string& nc, const char* password = PASSWORD) {
+  std::string ha1 = md5Text(std::string(USERNAME) + ":" + REALM + ":" + password);
+  std::string ha2 = md5Text(std::string("GET:") + PAGE);
+  std::string header = std::string("Digest username=\"") + USERNAME + "\", realm=\"" + REALM + "\", nonce=\"" + nonce +
+                       "\", uri=\"" + PAGE + "\", ";
+  if (nc.empty()) {
+    return header + "response=\"" + md5Text(ha1 + ":" + nonce + ":" + ha2) + "\"";
+  }
+  std::string response = md5Text(ha1 + ":" + nonce + ":" + nc + ":0a4f113b:auth:" + ha2);
+  return header + "qop=auth, nc=" + nc + ", cnonce=\"0a4f113b\", response=\"" + response + "\"";
+}
+
+static uint8_t authenticate(const std::string& header) {
+  return authenticateRequest(header.c_str(), "GET", PAGE, CLIENT);
+}
+
+static int liveRecords() {
+  int live = 0;
+  for (const NonceRecord& record : nonceRecords) {
+    if (record.highestCount != 0 && millis() - record.issued < DIGEST_NONCE_TTL_MS) live++;
+  }
+  return live;
+}
+
+static void testNonceCounts() {
+  // Issued in the same millisecond as initializeAuth()
+  std::string nonce = freshNonce();
+  advanceHostClock(1000);
+  CHECK(authenticate(digestHeader(nonce, "00000001")) == AUTH_OK);
+  CHECK(authenticate(digestHeader(nonce, "00000001")) == AUTH_STALE);
+  CHECK(authenticate(digestHeader(nonce, "00000002")) == AUTH_OK);
+  CHECK(authenticate(digestHeader(nonce, "00000001")) == AUTH_STALE);
+
+  // Skipping ahead is allowed, going back to a skipped value is not
+  CHECK(authenticate(digestHeader(nonce, "0000000A")) == AUTH_OK);
+  CHECK(authenticate(digestHeader(nonce, "00000005")) == AUTH_STALE);
+
+  // A wrong response does not move the count on
+  CHECK(authenticate(digestHeader(nonce, "ffffffff", "wrong")) == AUTH_FAILED);
+  CHECK(authenticate(digestHeader(nonce, "0000000b")) == AUTH_OK);
+
+  CHECK(authenticate(digestHeader(nonce, "00000000")) == AUTH_FAILED);
+  CHECK(authenticate(digestHeader(nonce, "0000000c0")) == AUTH_FAILED);
+  CHECK(authenticate(digestHeader(nonce, "0000000x")) == AUTH_FAILED);
+
+  // Without qop a nonce is good for one request
+  std::string other = freshNonce();
+  advanceHostClock(1000);
+  CHECK(authenticate(digestHeader(other, "")) == AUTH_OK);
+  CHECK(authenticate(digestHeader(other, "")) == AUTH_STALE);
+
+  // An expired nonce is stale whatever its count
+  std::string old = freshNonce();
+  advanceHostClock(DIGEST_NONCE_TTL_MS * 1000ULL);
+  CHECK(authenticate(digestHeader(old, "00000001")) == AUTH_STALE);
+}
+
+// Many nonces in use: none may be replayed, the table does not grow, and the
+// nonce in use keeps working
+static void testTableBound() {
+  std::string nonces[NONCE_TABLE_SIZE * 8];
+  uint32_t evictedBefore = nonceRecordsEvicted;
+  for (std::string& nonce : nonces) {
+    nonce = freshNonce();
+    CHECK(authenticate(digestHeader(nonce, "00000001")) == AUTH_OK);
+    advanceHostClock(1000);
+  }
+  CHECK(liveRecords() <= NONCE_TABLE_SIZE);
+  CHECK(nonceRecordsEvicted > evictedBefore);
+
+  uint32_t replayed = 0;
+  for (const std::string& nonce : nonces) {
+    if (authenticate(digestHeader(nonce, "00000001")) != AUTH_STALE) replayed++;
+  }
+  CHECK(replayed == 0);
+  CHECK(authenticate(digestHeader(nonces[NONCE_TABLE_SIZE * 8 - 1], "00000002")) == AUTH_OK);
+
+  // Records expire with their nonces, and new nonces are taken again
+  advanceHostClock(DIGEST_NONCE_TTL_MS * 1000ULL);
+  std::string nonce = freshNonce();
+  advanceHostClock(1000);
+  CHECK(authenticate(digestHeader(nonce, "00000001")) == AUTH_OK);
+  CHECK(liveRecords() == 1);
+}
+
+// Weeks without a login leave the floor far behind; nonces issued then still
+// work. The host's millis() does not wrap at 32 bits, so this stays below 49 days.
+static void testLongIdle() {
+  for (int i = 0; i < 2; i++) {
+    advanceHostClock(20ULL * 24 * 60 * 60 * 1000 * 1000);
+    std::string nonce = freshNonce();
+    advanceHostClock(1000);
+    CHECK(authenticate(digestHeader(nonce, "00000001")) == AUTH_OK);
+    CHECK(authenticate(digestHeader(nonce, "00000001")) == AUTH_STALE);
+  }
+}
+
+int main() {
+  hostClockUs = 1000000;
+  snprintf(deviceConfig.username, sizeof(deviceConfig.username), "%s", USERNAME);
+  snprintf(deviceConfig.userpass, sizeof(deviceConfig.userpass), "%s", PASSWORD);
+  initializeAuth(REALM);
+
+  testNonceCounts();
+  testTableBound();
+  testLongIdle();
+  return finishChecks("auth_manager_test");
+}
@@ -0,0 +1,133 @@
+// Compiled output of keystroke_compiler.h, checked byte for byte
+#include <initializer_list>
+#include "../keystroke_compiler.h"
+#include "test_check.h"
+
+#define LSHIFT KEYBOARD_MODIFIER_LEFTSHIFT
+#define RELEASE_ALL {0, HID_OP_REPORT, {0}}
+
+static void printProgram(const char* label, const HidReport* reports, size_t count) {
+  fprintf(stderr, "  %s:\n", label);
+  for (size_t i = 0; i < count; i++) {
+    const HidReport& r = reports[i];
+    fprintf(stderr, "    {0x%02x, %u, {0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x}}\n", r.modifier, r.opcode,
+      r.keycode[0], r.keycode[1], r.keycode[2], r.keycode[3], r.keycode[4], r.keycode[5]);
+  }
+}
+
+static bool compilesTo(const char* input, std::initializer_list<HidReport> expected,
+                       const KeystrokeOptions& options = DEFAULT_KEYSTROKE_OPTIONS) {
+  KeystrokeProgram program;
+  compileKeystrokeSequence(input, strlen(input), program, options);
+  bool same = program.size() == expected.size() &&
+              memcmp(program.data(), expected.begin(), expected.size() * sizeof(HidReport)) == 0;
+  if (!same) {
+    fprintf(stderr, "'%s' compiled to something else\n", input);
+    printProgram("expected", expected.begin(), expected.size());
+    printProgram("compiled", program.data(), program.size());
+  }
+  return same;
+}
+
+static void testText() {
+  KeystrokeOptions separate = DEFAULT_KEYSTROKE_OPTIONS;
+  separate.coalesceReleases = false;
+  CHECK(compilesTo("Hi", {
+    {LSHIFT, HID_OP_REPORT, {HID_KEY_H}}, RELEASE_ALL,
+    {0, HID_OP_REPORT, {HID_KEY_I}}, RELEASE_ALL,
+  }, separate));
+
+  // Spaces between words are typed, repeated letters get a release between them
+  CHECK(compilesTo("Hello World", {
+    {LSHIFT, HID_OP_REPORT, {HID_KEY_H}}, RELEASE_ALL,
+    {0, HID_OP_REPORT, {HID_KEY_E}},
+    {0, HID_OP_REPORT, {HID_KEY_L}}, RELEASE_ALL,
+    {0, HID_OP_REPORT, {HID_KEY_L}},
+    {0, HID_OP_REPORT, {HID_KEY_O}},
+    {0, HID_OP_REPORT, {HID_KEY_SPACE}}, RELEASE_ALL,
+    {LSHIFT, HID_OP_REPORT, {HID_KEY_W}}, RELEASE_ALL,
+    {0, HID_OP_REPORT, {HID_KEY_O}},
+    {0, HID_OP_REPORT, {HID_KEY_R}},
+    {0, HID_OP_REPORT, {HID_KEY_L}},
+    {0, HID_OP_REPORT, {HID_KEY_D}}, RELEASE_ALL,
+  }));
+
+  CHECK(compilesTo("x  y", {
+    {0, HID_OP_REPORT, {HID_KEY_X}},
+    {0, HID_OP_REPORT, {HID_KEY_SPACE}}, RELEASE_ALL,
+    {0, HID_OP_REPORT, {HID_KEY_SPACE}},
+    {0, HID_OP_REPORT, {HID_KEY_Y}}, RELEASE_ALL,
+  }));
+
+  CHECK(compilesTo("", {}));
+  CHECK(compilesTo("   ", {}));
+
+  KeystrokeOptions uk = DEFAULT_KEYSTROKE_OPTIONS;
+  uk.layout = LAYOUT_UK;
+  CHECK(compilesTo("@\"", {
+    {LSHIFT, HID_OP_REPORT, {HID_KEY_APOSTROPHE}},
+    {LSHIFT, HID_OP_REPORT, {HID_KEY_2}}, RELEASE_ALL,
+  }, uk));
+}
+
+static void testKeys() {
+  // Key names end a run of text, so the space before them is not typed
+  CHECK(compilesTo("aa b ENTER", {
+    {0, HID_OP_REPORT, {HID_KEY_A}}, RELEASE_ALL,
+    {0, HID_OP_REPORT, {HID_KEY_A}},
+    {0, HID_OP_REPORT, {HID_KEY_SPACE}},
+    {0, HID_OP_REPORT, {HID_KEY_B}},
+    {0, HID_OP_REPORT, {HID_KEY_ENTER}}, RELEASE_ALL,
+  }));
+
+  CHECK(compilesTo("CTRL+ALT+DEL", {
+    {KEYBOARD_MODIFIER_LEFTCTRL | KEYBOARD_MODIFIER_LEFTALT, HID_OP_REPORT, {HID_KEY_DELETE}}, RELEASE_ALL,
+  }));
+
+  // Keys beyond the report's six go in a HID_OP_KEYS step first
+  CHECK(compilesTo("CTRL+a+b+c+d+e+f+g", {
+    {KEYBOARD_MODIFIER_LEFTCTRL, HID_OP_KEYS, {HID_KEY_G}},
+    {KEYBOARD_MODIFIER_LEFTCTRL, HID_OP_REPORT, {HID_KEY_A, HID_KEY_B, HID_KEY_C, HID_KEY_D, HID_KEY_E, HID_KEY_F}},
+    RELEASE_ALL,
+  }));
+
+  CHECK(compilesTo("VOLUP", {
+    {0, HID_OP_MEDIA, {HID_USAGE_CONSUMER_VOLUME_INCREMENT & 0xFF, HID_USAGE_CONSUMER_VOLUME_INCREMENT >> 8}},
+    {0, HID_OP_MEDIA, {0}},
+  }));
+}
+
+static void testTiming() {
+  KeystrokeProgram program;
+  appendTypingRate(program, 1000);
+  CHECK(program.size() == 1 && program[0].opcode == HID_OP_RATE && program[0].keycode[0] == 0xE8 &&
+        program[0].keycode[1] == 0x03);
+
+  // Three reports 1 ms apart plus a 5 ms pause
+  compileKeystrokeSequence("ab", 2, program);
+  program.push_back({0, HID_OP_DELAY, {5, 0}});
+  CHECK(program.size() == 5);
+  CHECK(estimateKeystrokeProgramMs(program, TYPING_RATE_SAFE_US) == 8);
+
+  CHECK(parseTypingRate("fast", 0) == TYPING_RATE_FAST_US);
+  CHECK(parseTypingRate("SAFE", 0) == TYPING_RATE_SAFE_US);
+  CHECK(parseTypingRate("1500", 0) == 1500);
+  CHECK(parseTypingRate("70000", 7) == 7);
+  CHECK(parseTypingRate("12ms", 7) == 7);
+  CHECK(parseTypingRate("", 7) == 7);
+}
+
+static void testFingerprint() {
+  CHECK(fnv1a64("", 0) == FNV1A64_OFFSET);
+  CHECK(fnv1a64("a", 1) == 0xaf63dc4c8601ec8cULL);
+  CHECK(fnv1a64("foobar", 6) == 0x85944171f73967e8ULL);
+  CHECK(fnv1a64("bar", 3, fnv1a64("foo", 3)) == fnv1a64("foobar", 6));
+}
+
+int main() {
+  testText();
+  testKeys();
+  testTiming();
+  testFingerprint();
+  return finishChecks("compiler_test");
+}
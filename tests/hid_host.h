@@ -0,0 +1,122 @@
+#ifndef TEST_HID_HOST_H
+#define TEST_HID_HOST_H
+
+// Simulated host for the tests: reads a compiled program the way an OS with
+// the given layout reads the reports, and returns the text it would type.
+// Only a key that was not down in the previous report counts as a press, so
+// a missing release shows up as a lost character. Dead keys print once the
+// next key comes, ENTER and TAB as \n and \t, any other key as {xx} and a
+// key pressed with CTRL, ALT or GUI as [mm+xx] (both in hex). Media keys
+// come out as <xxxx>.
+#include <string>
+#include "../keystroke_compiler.h"
+
+// Modifiers that still type text: shift and AltGr
+#define HID_HOST_TEXT_MODIFIERS (KEYBOARD_MODIFIER_LEFTSHIFT | KEYBOARD_MODIFIER_RIGHTSHIFT | KEYBOARD_MODIFIER_RIGHTALT)
+
+// Function declarations
+std::string decodeHidProgram(const HidReport* reports, size_t count, uint8_t layout);
+std::string decodeHidProgram(const KeystrokeProgram& program, uint8_t layout);
+
+// Implementation
+// Character a key press types on the layout, or 0
+inline char hidHostCharacter(uint8_t layout, uint8_t modifier, uint8_t keycode) {
+  if (modifier & KEYBOARD_MODIFIER_RIGHTSHIFT) {
+    modifier = (modifier & ~KEYBOARD_MODIFIER_RIGHTSHIFT) | KEYBOARD_MODIFIER_LEFTSHIFT;
+  }
+  for (int c = 0x20; c < 0x7F; c++) {
+    HidKey hk = convertAsciiToHid((char)c, layout);
+    if (hk.keycode == keycode && hk.modifier == modifier) return (char)c;
+  }
+  return 0;
+}
+
+inline void hidHostPress(std::string& text, char& deadKey, uint8_t layout, uint8_t modifier, uint8_t keycode) {
+  char buffer[16];
+  char character = 0;
+  if ((modifier & ~HID_HOST_TEXT_MODIFIERS) == 0) {
+    character = hidHostCharacter(layout, modifier, keycode);
+    if (keycode == HID_KEY_ENTER && modifier == 0) character = '\n';
+    if (keycode == HID_KEY_TAB && modifier == 0) character = '\t';
+  }
+
+  // A dead key combines with the next one; these layouts only ever follow it with a space
+  if (deadKey != 0) {
+    text += deadKey;
+    deadKey = 0;
+    if (character == ' ') return;
+  }
+
+  if (character != 0 && isDeadKey(character, layout)) {
+    deadKey = character;
+  } else if (character != 0) {
+    text += character;
+  } else if (modifier == 0) {
+    snprintf(buffer, sizeof(buffer), "{%02x}", keycode);
+    text += buffer;
+  } else {
+    snprintf(buffer, sizeof(buffer), "[%02x+%02x]", modifier, keycode);
+    text += buffer;
+  }
+}
+
+inline bool hidHostHeld(const uint8_t* keys, size_t count, uint8_t keycode) {
+  for (size_t i = 0; i < count; i++) {
+    if (keys[i] == keycode) return true;
+  }
+  return false;
+}
+
+std::string decodeHidProgram(const HidReport* reports, size_t count, uint8_t layout) {
+  std::string text;
+  char deadKey = 0;
+  uint8_t held[6 + KEYSTROKE_CHORD_KEYS] = {0};
+  size_t heldCount = 0;
+  uint8_t extra[KEYSTROKE_CHORD_KEYS] = {0};
+  size_t extraCount = 0;
+  char buffer[16];
+
+  for (size_t i = 0; i < count; i++) {
+    const HidReport& report = reports[i];
+    uint16_t argument = report.keycode[0] | (report.keycode[1] << 8);
+
+    if (report.opcode == HID_OP_KEYS) {
+      for (int k = 0; k < 6 && report.keycode[k] && extraCount < sizeof(extra); k++) {
+        extra[extraCount++] = report.keycode[k];
+      }
+      continue;
+    }
+    if (report.opcode == HID_OP_MEDIA) {
+      if (argument != 0) {
+        snprintf(buffer, sizeof(buffer), "<%04x>", argument);
+        text += buffer;
+      }
+      continue;
+    }
+    if (report.opcode != HID_OP_REPORT) {
+      continue;
+    }
+
+    uint8_t keys[6 + KEYSTROKE_CHORD_KEYS];
+    size_t keyCount = 0;
+    for (int k = 0; k < 6 && report.keycode[k]; k++) keys[keyCount++] = report.keycode[k];
+    for (size_t k = 0; k < extraCount; k++) keys[keyCount++] = extra[k];
+    extraCount = 0;
+
+    for (size_t k = 0; k < keyCount; k++) {
+      if (!hidHostHeld(held, heldCount, keys[k]) && !hidHostHeld(keys, k, keys[k])) {
+        hidHostPress(text, deadKey, layout, report.modifier, keys[k]);
+      }
+    }
+    memcpy(held, keys, keyCount);
+    heldCount = keyCount;
+  }
+  if (deadKey != 0) text += deadKey;
+  return text;
+}
+
+std::string decodeHidProgram(const KeystrokeProgram& program, uint8_t layout) {
+  return decodeHidProgram(program.data(), program.size(), layout);
+}
+
+#endif
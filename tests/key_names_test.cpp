@@ -0,0 +1,127 @@
+// Key name lookups in keystroke_compiler.h: every table entry is found by its
+// name, names are length-bounded rather than NUL-terminated, and prefixes,
+// extensions and other near misses are not found
+#include <string>
+#include "../keystroke_compiler.h"
+#include "test_check.h"
+
+// Linear scan of the table, the reference for the binary search
+template <typename T, size_t N>
+static const T* scanNamedKey(const T (&table)[N], const char* name, size_t length) {
+  for (const T& entry : table) {
+    if (strlen(entry.name) == length && memcmp(entry.name, name, length) == 0) return &entry;
+  }
+  return nullptr;
+}
+
+// Looks the name up with more text after it, as it sits inside a chord
+static bool findsModifier(const std::string& name, uint8_t& modifier) {
+  std::string buffer = name + "+X";
+  return lookupModifierKey(buffer.data(), name.size(), modifier);
+}
+
+static bool findsSpecial(const std::string& name, HidKey& key, uint8_t layout = LAYOUT_US) {
+  std::string buffer = name + "+X";
+  return lookupSpecialKey(buffer.data(), name.size(), key, layout);
+}
+
+static bool findsMedia(const std::string& name, uint16_t& usage) {
+  std::string buffer = name + "+X";
+  return lookupMediaKey(buffer.data(), name.size(), usage);
+}
+
+static void testEveryEntry() {
+  for (const NamedModifier& entry : MODIFIER_KEYS) {
+    uint8_t modifier = 0;
+    CHECK(findsModifier(entry.name, modifier) && modifier == entry.modifier);
+  }
+  for (const NamedKey& entry : SPECIAL_KEYS) {
+    HidKey key = {0, 0};
+    CHECK(findsSpecial(entry.name, key));
+    if (entry.key.keycode != 0) {
+      CHECK(key.keycode == entry.key.keycode && key.modifier == entry.key.modifier);
+    }
+  }
+  for (const NamedMediaKey& entry : MEDIA_KEYS) {
+    uint16_t usage = 0;
+    CHECK(findsMedia(entry.name, usage) && usage == entry.usage);
+  }
+}
+
+// Layout characters resolve through the active layout
+static void testLayoutKeys() {
+  HidKey key = {0, 0};
+  CHECK(findsSpecial("PLUS", key, LAYOUT_US));
+  CHECK(key.keycode == HID_KEY_EQUAL && key.modifier == KEYBOARD_MODIFIER_LEFTSHIFT);
+  CHECK(findsSpecial("PLUS", key, LAYOUT_DE));
+  CHECK(key.keycode == HID_KEY_BRACKET_RIGHT && key.modifier == 0);
+}
+
+// Chopping or extending a name must only find another entry with that exact name
+static void testNearMisses() {
+  for (const NamedKey& entry : SPECIAL_KEYS) {
+    std::string name = entry.name;
+    HidKey key = {0, 0};
+    std::string shorter = name.substr(0, name.size() - 1);
+    CHECK(findsSpecial(shorter, key) == (scanNamedKey(SPECIAL_KEYS, shorter.data(), shorter.size()) != nullptr));
+    std::string longer = name + "A";
+    CHECK(findsSpecial(longer, key) == (scanNamedKey(SPECIAL_KEYS, longer.data(), longer.size()) != nullptr));
+
+    std::string lower = name;
+    for (char& c : lower) c = tolower((unsigned char)c);
+    if (lower != name) CHECK(!findsSpecial(lower, key));
+  }
+
+  HidKey key = {0, 0};
+  uint8_t modifier = 0;
+  uint16_t usage = 0;
+  CHECK(!findsSpecial("", key));
+  CHECK(!findsModifier("", modifier));
+  CHECK(!findsMedia("", usage));
+  CHECK(!findsSpecial("F25", key));
+  CHECK(!findsSpecial("ENTERX", key));
+  CHECK(!findsModifier("CTR", modifier));
+  CHECK(!findsMedia("VOL", usage));
+  CHECK(!findsSpecial("\xff", key));
+}
+
+// Every string of up to three characters from the names' alphabet, and the
+// names with one character changed, agree with a linear scan
+static void testAgainstScan() {
+  const char alphabet[] = "ACDEFHKLMNOPRSTUVW0123456789.,=+";
+  const size_t letters = sizeof(alphabet) - 1;
+  uint32_t mismatches = 0;
+
+  for (size_t length = 1; length <= 3; length++) {
+    size_t combinations = 1;
+    for (size_t i = 0; i < length; i++) combinations *= letters;
+    for (size_t n = 0; n < combinations; n++) {
+      char name[3];
+      for (size_t i = 0, rest = n; i < length; i++, rest /= letters) name[i] = alphabet[rest % letters];
+      HidKey key;
+      if (lookupSpecialKey(name, length, key) != (scanNamedKey(SPECIAL_KEYS, name, length) != nullptr)) mismatches++;
+    }
+  }
+
+  for (const NamedKey& entry : SPECIAL_KEYS) {
+    std::string name = entry.name;
+    for (size_t i = 0; i < name.size(); i++) {
+      for (size_t j = 0; j < letters; j++) {
+        std::string changed = name;
+        changed[i] = alphabet[j];
+        HidKey key;
+        bool found = lookupSpecialKey(changed.data(), changed.size(), key);
+        if (found != (scanNamedKey(SPECIAL_KEYS, changed.data(), changed.size()) != nullptr)) mismatches++;
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+int main() {
+  testEveryEntry();
+  testLayoutKeys();
+  testNearMisses();
+  testAgainstScan();
+  return finishChecks("key_names_test");
+}
@@ -0,0 +1,105 @@
+// Report pacing and report choice in keyboard_handler.h, played against the
+// mock USB device in tools/host/ on its virtual clock
+#include "../keyboard_handler.h"
+#include "test_check.h"
+
+// Plays the program and returns the reports the host received
+static const std::vector<HostHidReport>& play(const char* input, uint16_t rateUs) {
+  KeystrokeProgram program;
+  appendTypingRate(program, rateUs);
+  compileKeystrokeSequence(input, strlen(input), program);
+  hostHidReports.clear();
+  playKeystrokeProgram(program);
+  // Let the last transfer complete so the next run starts idle
+  advanceHostClock(HID_REPORT_TIMEOUT_US);
+  return hostHidReports;
+}
+
+static uint64_t shortestGapUs(const std::vector<HostHidReport>& reports) {
+  uint64_t shortest = UINT64_MAX;
+  for (size_t i = 1; i < reports.size(); i++) {
+    uint64_t gap = reports[i].sentUs - reports[i - 1].sentUs;
+    if (gap < shortest) shortest = gap;
+  }
+  return shortest;
+}
+
+static void testTypingRate() {
+  const std::vector<HostHidReport>& reports = play("hello world", 2000);
+  CHECK(reports.size() == 13);
+  CHECK(shortestGapUs(reports) >= 2000);
+  CHECK(shortestGapUs(reports) < 2000 + hostHidPollUs);
+}
+
+// Faster than the host polls: each report waits for the previous one to be collected
+static void testCompletionPacing() {
+  const std::vector<HostHidReport>& reports = play("hello world", 200);
+  CHECK(reports.size() == 13);
+  CHECK(shortestGapUs(reports) >= 200);
+  // Never two reports in one poll interval
+  for (size_t i = 1; i < reports.size(); i++) {
+    uint64_t collectedUs = (reports[i - 1].sentUs / hostHidPollUs + 1) * hostHidPollUs;
+    CHECK(reports[i].sentUs >= collectedUs);
+  }
+}
+
+// A completion callback that never comes only holds playback up to the timeout
+static void testCompletionTimeout() {
+  hostClockHook = nullptr;
+  hidReportInFlight.store(false);
+  const std::vector<HostHidReport>& reports = play("ab", TYPING_RATE_FAST_US);
+  hostClockHook = completeHostHidReports;
+  hidReportInFlight.store(false);
+
+  CHECK(reports.size() == 3);
+  CHECK(shortestGapUs(reports) >= HID_REPORT_TIMEOUT_US);
+  CHECK(shortestGapUs(reports) < HID_REPORT_TIMEOUT_US + 100);
+}
+
+static void testDelay() {
+  KeystrokeProgram program = {{0, HID_OP_DELAY, {20, 0}}};
+  uint64_t startUs = hostClockUs;
+  playKeystrokeProgram(program);
+  CHECK(hostClockUs - startUs >= 20000);
+}
+
+// Chords beyond six keys use the bitmap in report protocol and are cut to six
+// keys in boot protocol; switching reports empties the other one
+static void testChordReports() {
+  const std::vector<HostHidReport>& reports = play("a CTRL+a+b+c+d+e+f+g", TYPING_RATE_FAST_US);
+  CHECK(reports.size() == 5);
+  if (reports.size() == 5) {
+    CHECK(reports[0].reportId == HID_REPORT_ID_KEYBOARD && reports[0].data[2] == HID_KEY_A);
+    CHECK(reports[1].reportId == HID_REPORT_ID_KEYBOARD && reports[1].data[2] == 0);
+    CHECK(reports[2].reportId == HID_REPORT_ID_NKRO && reports[2].length == NKRO_REPORT_SIZE);
+    CHECK(reports[2].data[HID_KEY_G / 8] & (1 << (HID_KEY_G % 8)));
+    CHECK(reports[2].data[HID_KEY_CONTROL_LEFT / 8] & (1 << (HID_KEY_CONTROL_LEFT % 8)));
+    CHECK(reports[3].reportId == HID_REPORT_ID_KEYBOARD && reports[3].data[2] == 0);
+    CHECK(reports[4].reportId == HID_REPORT_ID_NKRO && reports[4].data[HID_KEY_G / 8] == 0);
+  }
+
+  hostHidProtocol = HID_PROTOCOL_BOOT;
+  const std::vector<HostHidReport>& boot = play("CTRL+a+b+c+d+e+f+g VOLUP", TYPING_RATE_FAST_US);
+  hostHidProtocol = HID_PROTOCOL_REPORT;
+  CHECK(boot.size() == 2);
+  if (boot.size() == 2) {
+    CHECK(boot[0].reportId == 0 && boot[0].length == 8);
+    CHECK(boot[0].data[0] == KEYBOARD_MODIFIER_LEFTCTRL && boot[0].data[7] == HID_KEY_F);
+    CHECK(boot[1].reportId == 0 && boot[1].data[0] == 0 && boot[1].data[2] == 0);
+  }
+}
+
+int main() {
+  hostClockUs = 1000000;
+  hostSpinUs = 1;
+  hostClockHook = completeHostHidReports;
+  hostHidRecording = true;
+  initializeKeyboard();
+
+  testTypingRate();
+  testCompletionPacing();
+  testCompletionTimeout();
+  testDelay();
+  testChordReports();
+  return finishChecks("keyboard_handler_test");
+}
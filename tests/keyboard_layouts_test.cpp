@@ -0,0 +1,121 @@
+// Layout tables in keyboard_layouts.h. Spot checks against the keys printed
+// on US, UK and German keyboards, then every printable character compiled on
+// its own and read back by the simulated host in hid_host.h.
+#include "hid_host.h"
+#include "test_check.h"
+
+#define PLAIN 0
+#define SHIFT KEYBOARD_MODIFIER_LEFTSHIFT
+#define ALTGR KEYBOARD_MODIFIER_RIGHTALT
+
+typedef struct {
+  uint8_t layout;
+  char character;
+  uint8_t modifier;
+  uint8_t keycode;
+} LayoutKey;
+
+// Written from the physical layouts, not from the tables
+const LayoutKey KNOWN_KEYS[] = {
+  {LAYOUT_US, 'a', PLAIN, HID_KEY_A},           {LAYOUT_US, 'Z', SHIFT, HID_KEY_Z},
+  {LAYOUT_US, '@', SHIFT, HID_KEY_2},           {LAYOUT_US, '"', SHIFT, HID_KEY_APOSTROPHE},
+  {LAYOUT_US, '#', SHIFT, HID_KEY_3},           {LAYOUT_US, '\\', PLAIN, HID_KEY_BACKSLASH},
+  {LAYOUT_US, '|', SHIFT, HID_KEY_BACKSLASH},   {LAYOUT_US, '~', SHIFT, HID_KEY_GRAVE},
+  {LAYOUT_US, '_', SHIFT, HID_KEY_MINUS},       {LAYOUT_US, '?', SHIFT, HID_KEY_SLASH},
+  {LAYOUT_US, ' ', PLAIN, HID_KEY_SPACE},
+
+  {LAYOUT_UK, '"', SHIFT, HID_KEY_2},           {LAYOUT_UK, '@', SHIFT, HID_KEY_APOSTROPHE},
+  {LAYOUT_UK, '\'', PLAIN, HID_KEY_APOSTROPHE}, {LAYOUT_UK, '#', PLAIN, HID_KEY_EUROPE_1},
+  {LAYOUT_UK, '~', SHIFT, HID_KEY_EUROPE_1},    {LAYOUT_UK, '\\', PLAIN, HID_KEY_EUROPE_2},
+  {LAYOUT_UK, '|', SHIFT, HID_KEY_EUROPE_2},    {LAYOUT_UK, '`', PLAIN, HID_KEY_GRAVE},
+  {LAYOUT_UK, '$', SHIFT, HID_KEY_4},           {LAYOUT_UK, 'q', PLAIN, HID_KEY_Q},
+
+  {LAYOUT_DE, 'z', PLAIN, HID_KEY_Y},           {LAYOUT_DE, 'y', PLAIN, HID_KEY_Z},
+  {LAYOUT_DE, 'Z', SHIFT, HID_KEY_Y},           {LAYOUT_DE, '@', ALTGR, HID_KEY_Q},
+  {LAYOUT_DE, '^', PLAIN, HID_KEY_GRAVE},       {LAYOUT_DE, '`', SHIFT, HID_KEY_EQUAL},
+  {LAYOUT_DE, '"', SHIFT, HID_KEY_2},           {LAYOUT_DE, '&', SHIFT, HID_KEY_6},
+  {LAYOUT_DE, '/', SHIFT, HID_KEY_7},           {LAYOUT_DE, '(', SHIFT, HID_KEY_8},
+  {LAYOUT_DE, '=', SHIFT, HID_KEY_0},           {LAYOUT_DE, '?', SHIFT, HID_KEY_MINUS},
+  {LAYOUT_DE, '+', PLAIN, HID_KEY_BRACKET_RIGHT}, {LAYOUT_DE, '*', SHIFT, HID_KEY_BRACKET_RIGHT},
+  {LAYOUT_DE, '~', ALTGR, HID_KEY_BRACKET_RIGHT}, {LAYOUT_DE, '#', PLAIN, HID_KEY_EUROPE_1},
+  {LAYOUT_DE, '\'', SHIFT, HID_KEY_EUROPE_1},   {LAYOUT_DE, '-', PLAIN, HID_KEY_SLASH},
+  {LAYOUT_DE, '_', SHIFT, HID_KEY_SLASH},       {LAYOUT_DE, ';', SHIFT, HID_KEY_COMMA},
+  {LAYOUT_DE, ':', SHIFT, HID_KEY_PERIOD},      {LAYOUT_DE, '<', PLAIN, HID_KEY_EUROPE_2},
+  {LAYOUT_DE, '>', SHIFT, HID_KEY_EUROPE_2},    {LAYOUT_DE, '|', ALTGR, HID_KEY_EUROPE_2},
+  {LAYOUT_DE, '{', ALTGR, HID_KEY_7},           {LAYOUT_DE, '[', ALTGR, HID_KEY_8},
+  {LAYOUT_DE, ']', ALTGR, HID_KEY_9},           {LAYOUT_DE, '}', ALTGR, HID_KEY_0},
+  {LAYOUT_DE, '\\', ALTGR, HID_KEY_MINUS},
+};
+
+static void testKnownKeys() {
+  for (const LayoutKey& known : KNOWN_KEYS) {
+    HidKey key = convertAsciiToHid(known.character, known.layout);
+    if (!CHECK(key.modifier == known.modifier && key.keycode == known.keycode)) {
+      fprintf(stderr, "  layout %u '%c' is %02x+%02x, expected %02x+%02x\n", known.layout, known.character,
+        key.modifier, key.keycode, known.modifier, known.keycode);
+    }
+  }
+}
+
+static void testDeadKeys() {
+  for (int c = 0x20; c < 0x7F; c++) {
+    bool dead = c == '^' || c == '`';
+    CHECK(isDeadKey((char)c, LAYOUT_US) == false);
+    CHECK(isDeadKey((char)c, LAYOUT_UK) == false);
+    CHECK(isDeadKey((char)c, LAYOUT_DE) == dead);
+  }
+
+  // A dead key is followed by a space so it prints as itself
+  KeystrokeProgram program;
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  options.layout = LAYOUT_DE;
+  compileKeystrokeSequence("^", 1, program, options);
+  CHECK(program.size() == 3);
+  if (program.size() == 3) {
+    CHECK(program[0].modifier == 0 && program[0].keycode[0] == HID_KEY_GRAVE);
+    CHECK(program[1].modifier == 0 && program[1].keycode[0] == HID_KEY_SPACE);
+    CHECK(program[2].modifier == 0 && program[2].keycode[0] == 0);
+  }
+}
+
+// Each character alone and between two letters, on every layout
+static void testRoundTrips() {
+  for (uint8_t layout = 0; layout < LAYOUT_COUNT; layout++) {
+    for (bool coalesce : {true, false}) {
+      KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+      options.layout = layout;
+      options.coalesceReleases = coalesce;
+      for (int c = 0x21; c < 0x7F; c++) {
+        // Between letters a '+' makes a chord, so it only goes alone
+        std::string texts[] = {std::string(1, (char)c), std::string("a") + (char)c + "Z"};
+        for (const std::string& text : texts) {
+          if (c == '+' && text.size() > 1) continue;
+          KeystrokeProgram program;
+          compileKeystrokeSequence(text.data(), text.size(), program, options);
+          std::string typed = decodeHidProgram(program, layout);
+          if (!CHECK(typed == text)) {
+            fprintf(stderr, "  layout %u: '%s' read back as '%s'\n", layout, text.c_str(), typed.c_str());
+          }
+        }
+      }
+    }
+  }
+}
+
+static void testLayoutNames() {
+  CHECK(parseKeyboardLayout("us", LAYOUT_DE) == LAYOUT_US);
+  CHECK(parseKeyboardLayout("UK", LAYOUT_US) == LAYOUT_UK);
+  CHECK(parseKeyboardLayout("gb", LAYOUT_US) == LAYOUT_UK);
+  CHECK(parseKeyboardLayout("De", LAYOUT_US) == LAYOUT_DE);
+  CHECK(parseKeyboardLayout("fr", LAYOUT_UK) == LAYOUT_UK);
+  CHECK(parseKeyboardLayout("", LAYOUT_DE) == LAYOUT_DE);
+  CHECK(parseKeyboardLayout(nullptr, LAYOUT_DE) == LAYOUT_DE);
+}
+
+int main() {
+  testKnownKeys();
+  testDeadKeys();
+  testRoundTrips();
+  testLayoutNames();
+  return finishChecks("keyboard_layouts_test");
+}
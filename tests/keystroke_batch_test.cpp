@@ -0,0 +1,182 @@
+// Batch steps in keystroke_batch.h: HOLD and RELEASE of keys that need a
+// modifier, and repeats whose counts multiply past what a job can play. The
+// job feeder in keystroke_queue.h plays the programs against the mock USB
+// device, so the reports counted up front can be compared with those played.
+#include "../keystroke_queue.h"
+#include "../keystroke_batch.h"
+#include "hid_host.h"
+#include "test_check.h"
+
+static bool compileBatch(const char* body, KeystrokeProgram& program, uint8_t layout = LAYOUT_US) {
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  options.layout = layout;
+  BatchSummary summary;
+  program.clear();
+  bool compiled = compileKeystrokeBatch(body, strlen(body), program, options, TYPING_RATE_FAST_US, summary);
+  if (!compiled) {
+    fprintf(stderr, "  batch error: %s\n", summary.error);
+  }
+  return compiled;
+}
+
+// Keyboard reports of the program, without rate and delay steps
+static std::vector<HidReport> keyboardReports(const KeystrokeProgram& program) {
+  std::vector<HidReport> reports;
+  for (const HidReport& report : program) {
+    if (report.opcode == HID_OP_REPORT) reports.push_back(report);
+  }
+  return reports;
+}
+
+static bool isEmptyReport(const HidReport& report) {
+  static const uint8_t none[6] = {0};
+  return report.modifier == 0 && memcmp(report.keycode, none, sizeof(none)) == 0;
+}
+
+// The n-th keyboard report the batch compiles to
+static HidReport reportOf(const char* body, size_t index, uint8_t layout = LAYOUT_US) {
+  KeystrokeProgram program;
+  HidReport report = {0xFF, 0xFF, {0}};
+  if (compileBatch(body, program, layout)) {
+    std::vector<HidReport> reports = keyboardReports(program);
+    if (index < reports.size()) report = reports[index];
+  }
+  return report;
+}
+
+static void testHoldShiftedKey() {
+  KeystrokeProgram program;
+
+  // HOLD A holds the key and the SHIFT it needs; RELEASE A lets go of both
+  CHECK(compileBatch("HOLD A\nRELEASE A", program));
+  std::vector<HidReport> reports = keyboardReports(program);
+  CHECK(reports.size() == 2);
+  if (reports.size() == 2) {
+    CHECK(reports[0].modifier == KEYBOARD_MODIFIER_LEFTSHIFT && reports[0].keycode[0] == HID_KEY_A);
+    CHECK(isEmptyReport(reports[1]));
+  }
+
+  // '@' is AltGr+Q on DE
+  CHECK(compileBatch("HOLD @\nRELEASE @", program, LAYOUT_DE));
+  reports = keyboardReports(program);
+  CHECK(reports.size() == 2);
+  if (reports.size() == 2) {
+    CHECK(reports[0].modifier == KEYBOARD_MODIFIER_RIGHTALT && reports[0].keycode[0] == HID_KEY_Q);
+    CHECK(isEmptyReport(reports[1]));
+  }
+
+  // Text typed in between sees the held keys, nothing is left down afterwards
+  CHECK(compileBatch("HOLD A\nTEXT x\nRELEASE A\nTEXT y", program));
+  reports = keyboardReports(program);
+  CHECK(!reports.empty() && isEmptyReport(reports.back()));
+  CHECK(decodeHidProgram(program, LAYOUT_US) == "AXy");
+
+  // A modifier held by name outlasts the key that also needed it, and the other way round
+  HidReport report = reportOf("HOLD SHIFT\nHOLD A\nRELEASE A", 2);
+  CHECK(report.modifier == KEYBOARD_MODIFIER_LEFTSHIFT && report.keycode[0] == 0);
+  report = reportOf("HOLD A\nHOLD SHIFT\nRELEASE SHIFT", 2);
+  CHECK(report.modifier == KEYBOARD_MODIFIER_LEFTSHIFT && report.keycode[0] == HID_KEY_A);
+  report = reportOf("HOLD A b\nRELEASE A", 1);
+  CHECK(report.modifier == 0 && report.keycode[0] == HID_KEY_B && report.keycode[1] == 0);
+  report = reportOf("HOLD CTRL A\nRELEASE", 1);
+  CHECK(isEmptyReport(report));
+}
+
+// REPEAT n around body, n levels deep, written straight into a program
+static void nestRepeats(KeystrokeProgram& program, uint16_t times, int levels, size_t bodyReports) {
+  program.clear();
+  for (int level = 0; level < levels; level++) {
+    size_t length = (levels - level - 1) + bodyReports;
+    program.push_back({0, HID_OP_REPEAT, {(uint8_t)times, (uint8_t)(times >> 8), (uint8_t)length, (uint8_t)(length >> 8)}});
+  }
+  for (size_t i = 0; i < bodyReports; i++) {
+    program.push_back({0, HID_OP_REPORT, {(uint8_t)(i % 2 ? 0 : HID_KEY_A)}});
+  }
+}
+
+static void testSaturation() {
+  KeystrokeProgram program;
+
+  // 65535^4 * 8 does not fit in 64 bits
+  nestRepeats(program, BATCH_MAX_REPEAT, KEYSTROKE_REPEAT_DEPTH, 8);
+  CHECK(countPlayedReports(program.data(), program.size()) == UINT64_MAX);
+  CHECK(estimateKeystrokeProgramMs(program, TYPING_RATE_SAFE_US) == UINT32_MAX);
+
+  nestRepeats(program, 3, KEYSTROKE_REPEAT_DEPTH, 2);
+  CHECK(countPlayedReports(program.data(), program.size()) == 81 * 2);
+
+  // The same worst case written as a batch is refused rather than wrapped
+  const char* nested =
+    "REPEAT 65535 {\nREPEAT 65535 {\nREPEAT 65535 {\nREPEAT 65535 {\nKEYS a b c d e f g h\n}\n}\n}\n}";
+  BatchSummary summary;
+  CHECK(!compileKeystrokeBatch(nested, strlen(nested), program, DEFAULT_KEYSTROKE_OPTIONS,
+    TYPING_RATE_FAST_US, summary));
+  CHECK(strstr(summary.error, "plays more than") != nullptr);
+  CHECK(program.empty());
+
+  CHECK(compileBatch("REPEAT 500 {\nREPEAT 1000 {\nKEYS a\n}\n}", program));
+  CHECK(countPlayedReports(program.data(), program.size()) == 1 + 500 * 1000 * 2);
+}
+
+// Plays a job and returns the reports core1 played
+static uint32_t playJob(KeystrokeProgram& program, size_t& counted) {
+  uint32_t playedBefore = hidReportsEmitted.load();
+  uint32_t id = enqueueKeystrokeJob(program);
+  const KeystrokeJob* job = findKeystrokeJob(id);
+  counted = job->total;
+  while (job->state != JOB_DONE) {
+    serviceKeystrokeQueue();
+    serviceHidPlayback();
+  }
+  return hidReportsEmitted.load() - playedBefore;
+}
+
+// Counting and playing agree, including past the depth the feeder follows
+static void testCountMatchesPlayback() {
+  KeystrokeProgram program;
+  for (int levels = 1; levels <= KEYSTROKE_REPEAT_DEPTH + 2; levels++) {
+    nestRepeats(program, 2, levels, 2);
+    uint64_t expected = 2ULL << (levels < KEYSTROKE_REPEAT_DEPTH ? levels : KEYSTROKE_REPEAT_DEPTH);
+    CHECK(countPlayedReports(program.data(), program.size()) == expected);
+    size_t counted = 0;
+    CHECK(playJob(program, counted) == expected);
+    CHECK(counted == expected);
+  }
+
+  CHECK(compileBatch("REPEAT 3 {\nKEYS a\nREPEAT 2 KEYS b\n}\nTEXT done", program));
+  uint64_t expected = countPlayedReports(program.data(), program.size());
+  size_t counted = 0;
+  CHECK(playJob(program, counted) == expected);
+}
+
+// Stored macros are refused when they hold a repeat, whatever its count
+static void testMacroRepeat() {
+  KeystrokeProgram program;
+  MacroBuilder builder;
+
+  compileKeystrokeSequence("ab", 2, program);
+  beginMacro(builder, LAYOUT_US, TYPING_RATE_FAST_US);
+  addMacroReports(builder, program.data(), program.size());
+  CHECK(!builder.hasRepeat);
+
+  // One report at a time, as an upload may split them
+  for (uint16_t times : {0, 1, 2}) {
+    nestRepeats(program, times, 1, 2);
+    beginMacro(builder, LAYOUT_US, TYPING_RATE_FAST_US);
+    for (const HidReport& report : program) addMacroReports(builder, &report, 1);
+    CHECK(builder.hasRepeat);
+  }
+}
+
+int main() {
+  hostClockUs = 1000000;
+  hostSpinUs = 1;
+  hostClockHook = completeHostHidReports;
+  initializeKeyboard();
+
+  testHoldShiftedKey();
+  testSaturation();
+  testCountMatchesPlayback();
+  testMacroRepeat();
+  return finishChecks("keystroke_batch_test");
+}
@@ -0,0 +1,147 @@
+// Streaming compiler and deferred releases in keystroke_compiler.h. Input fed
+// in chunks of every size must compile to the same reports as in one piece,
+// whichever side of the KEYSTROKE_TOKEN_WINDOW boundary a token ends on, and
+// the simulated host in hid_host.h must read back the text that was typed,
+// with releases coalesced or not.
+#include "hid_host.h"
+#include "test_check.h"
+
+static KeystrokeOptions optionsFor(uint8_t layout, bool coalesce) {
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  options.layout = layout;
+  options.coalesceReleases = coalesce;
+  return options;
+}
+
+static void compileInChunks(const std::string& input, size_t chunk, KeystrokeProgram& program,
+                            const KeystrokeOptions& options) {
+  KeystrokeStream stream;
+  beginKeystrokeStream(stream, program, options);
+  for (size_t pos = 0; pos < input.size(); pos += chunk) {
+    size_t length = input.size() - pos < chunk ? input.size() - pos : chunk;
+    feedKeystrokeStream(stream, input.data() + pos, length);
+  }
+  endKeystrokeStream(stream);
+}
+
+static bool endsReleased(const KeystrokeProgram& program) {
+  for (size_t i = program.size(); i-- > 0;) {
+    if (program[i].opcode == HID_OP_REPORT) {
+      return program[i].modifier == 0 && program[i].keycode[0] == 0;
+    }
+  }
+  return true;
+}
+
+// Every chunk size up to past twice the window gives the one-piece program
+static bool streamsLikeOnePiece(const std::string& input, const KeystrokeOptions& options) {
+  KeystrokeProgram whole;
+  KeystrokeProgram chunked;
+  compileKeystrokeSequence(input.data(), input.size(), whole, options);
+  for (size_t chunk = 1; chunk <= 2 * KEYSTROKE_TOKEN_WINDOW + 3; chunk++) {
+    chunked.clear();
+    compileInChunks(input, chunk, chunked, options);
+    if (chunked.size() != whole.size() ||
+        memcmp(chunked.data(), whole.data(), whole.size() * sizeof(HidReport)) != 0) {
+      fprintf(stderr, "chunks of %zu differ for '%s'\n", chunk, input.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+static void testWindowBoundaries() {
+  std::vector<std::string> inputs;
+  const size_t lengths[] = {1, KEYSTROKE_TOKEN_WINDOW - 1, KEYSTROKE_TOKEN_WINDOW, KEYSTROKE_TOKEN_WINDOW + 1,
+                            2 * KEYSTROKE_TOKEN_WINDOW, 2 * KEYSTROKE_TOKEN_WINDOW + 1};
+  for (size_t length : lengths) {
+    std::string word;
+    for (size_t i = 0; i < length; i++) word += "abcdefghij+"[i % 11];
+    inputs.push_back(word);
+    inputs.push_back(word + " ENTER");
+    inputs.push_back("x " + word + "  y");
+    inputs.push_back(std::string(length, ' ') + "CTRL+ALT+DEL " + word);
+    inputs.push_back(std::string(length - 1, 'q') + " TAB " + std::string(length, 'Q'));
+  }
+  inputs.push_back("Hello World CTRL+ALT+T ENTER VOLUP ls -la\tENTER");
+
+  for (const std::string& input : inputs) {
+    for (bool coalesce : {true, false}) {
+      CHECK(streamsLikeOnePiece(input, optionsFor(LAYOUT_US, coalesce)));
+    }
+  }
+}
+
+// Tokens that outgrow the window are typed, even when they look like chords
+static void testLongTokens() {
+  for (size_t length : {KEYSTROKE_TOKEN_WINDOW - 1, KEYSTROKE_TOKEN_WINDOW, KEYSTROKE_TOKEN_WINDOW + 1,
+                        3 * KEYSTROKE_TOKEN_WINDOW + 5}) {
+    std::string word;
+    for (size_t i = 0; i < length; i++) word += "a+"[i % 2];
+    KeystrokeProgram program;
+    compileKeystrokeSequence(word.data(), word.size(), program);
+    std::string typed = decodeHidProgram(program, LAYOUT_US);
+    if (length <= KEYSTROKE_TOKEN_WINDOW) {
+      CHECK(typed == "a");  // A chord of repeated A
+    } else {
+      CHECK(typed == word);
+    }
+  }
+}
+
+static void testHostReadsText() {
+  std::string printable;
+  for (int c = 0x21; c < 0x7F; c++) printable += (char)c;
+  const std::string texts[] = {
+    "Hello World", "aaa bbb  ccc", "aAaA AbBa", "Mississippi", "llama ll", printable,
+    "The quick brown fox jumps over the lazy dog 0123456789",
+  };
+
+  for (uint8_t layout = 0; layout < LAYOUT_COUNT; layout++) {
+    for (bool coalesce : {true, false}) {
+      KeystrokeOptions options = optionsFor(layout, coalesce);
+      for (const std::string& text : texts) {
+        KeystrokeProgram program;
+        compileKeystrokeSequence(text.data(), text.size(), program, options);
+        std::string typed = decodeHidProgram(program, layout);
+        if (!CHECK(typed == text)) {
+          fprintf(stderr, "  layout %u coalesce %d: '%s' read back as '%s'\n", layout, coalesce, text.c_str(),
+            typed.c_str());
+        }
+        CHECK(endsReleased(program));
+      }
+    }
+  }
+}
+
+static void testHostReadsKeys() {
+  for (bool coalesce : {true, false}) {
+    KeystrokeOptions options = optionsFor(LAYOUT_US, coalesce);
+    KeystrokeProgram program;
+    const char* input = "ls ENTER a TAB b CTRL+c F5 MUTE x";
+    compileKeystrokeSequence(input, strlen(input), program, options);
+    CHECK(decodeHidProgram(program, LAYOUT_US) == "ls\na\tb[01+06]{3e}<00e2>x");
+    CHECK(endsReleased(program));
+  }
+}
+
+// Coalescing only drops releases: fewer reports, same text
+static void testCoalescingSavesReports() {
+  const char* input = "the quick brown fox jumps over the lazy dog";
+  KeystrokeProgram coalesced;
+  KeystrokeProgram separate;
+  compileKeystrokeSequence(input, strlen(input), coalesced, optionsFor(LAYOUT_US, true));
+  compileKeystrokeSequence(input, strlen(input), separate, optionsFor(LAYOUT_US, false));
+  CHECK(separate.size() == 2 * strlen(input));
+  CHECK(coalesced.size() < separate.size() * 3 / 4);
+  CHECK(decodeHidProgram(coalesced, LAYOUT_US) == decodeHidProgram(separate, LAYOUT_US));
+}
+
+int main() {
+  testWindowBoundaries();
+  testLongTokens();
+  testHostReadsText();
+  testHostReadsKeys();
+  testCoalescingSavesReports();
+  return finishChecks("keystroke_stream_test");
+}
@@ -0,0 +1,232 @@
+// Live typing channel in live_channel.h, with connections handed to it through
+// the WiFiServer stand-in: the WebSocket handshake, single-use tokens, frame
+// parsing (split frames, extended lengths, refused 64-bit lengths) and the
+// release of held keys when the connection drops. Frames are built the way
+// tools/live_latency.py and the /live page send them.
+#include <string>
+#include "../live_channel.h"
+#include "test_check.h"
+
+static const IPAddress CLIENT(192, 168, 1, 20);
+
+// RFC 6455's example key and the accept value it must produce
+static const char* KEY = "dGhlIHNhbXBsZSBub25jZQ==";
+static const char* ACCEPT = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+
+// Core1 stand-in: keeps the reports that leave the ring
+static KeystrokeProgram played;
+
+static void playHidReports() {
+  HidReport report;
+  while (hidReportRing.pop(report)) {
+    played.push_back(report);
+    hidReportsEmitted++;
+  }
+}
+
+static std::shared_ptr<HostSocket> connectLive() {
+  std::shared_ptr<HostSocket> socket = std::make_shared<HostSocket>(HostSocket{"", 0, "", true});
+  liveServer.hostPending.push_back(WiFiClient(socket, CLIENT));
+  return socket;
+}
+
+// Sends bytes, then runs what loop() would, and returns what the device sent back
+static std::string exchange(const std::shared_ptr<HostSocket>& socket, const std::string& bytes) {
+  socket->toDevice += bytes;
+  serviceLiveChannel();
+  playHidReports();
+  serviceLiveChannel();
+  std::string reply = socket->fromDevice;
+  socket->fromDevice.clear();
+  return reply;
+}
+
+static std::string handshakeRequest(const std::string& token, const char* key = KEY) {
+  std::string request = "GET /?token=" + token + " HTTP/1.1\r\nHost: device\r\nUpgrade: websocket\r\n"
+                        "Connection: Upgrade\r\nSec-WebSocket-Version: 13\r\n";
+  if (key) request += std::string("Sec-WebSocket-Key: ") + key + "\r\n";
+  return request + "\r\n";
+}
+
+static std::string freshToken() {
+  char token[33];
+  issueLiveToken(token, sizeof(token));
+  return token;
+}
+
+// Masked client frame with a 7- or 16-bit length
+static std::string clientFrame(uint8_t opcode, const std::string& payload, bool masked = true) {
+  static const uint8_t mask[4] = {0x37, 0xFA, 0x21, 0x3D};
+  std::string frame(1, (char)(0x80 | opcode));
+  uint8_t maskBit = masked ? 0x80 : 0;
+  if (payload.size() < 126) {
+    frame += (char)(maskBit | payload.size());
+  } else {
+    frame += (char)(maskBit | 126);
+    frame += (char)(payload.size() >> 8);
+    frame += (char)(payload.size() & 0xFF);
+  }
+  if (!masked) return frame + payload;
+  frame.append((const char*)mask, 4);
+  for (size_t i = 0; i < payload.size(); i++) frame += (char)(payload[i] ^ mask[i & 3]);
+  return frame;
+}
+
+static std::string keyEvent(uint8_t op, uint8_t usage, uint16_t seq) {
+  return std::string({(char)op, (char)usage, (char)(seq & 0xFF), (char)(seq >> 8)});
+}
+
+static std::string ackFrame(uint16_t seq, uint8_t status) {
+  return std::string({(char)0x82, 3, (char)(seq & 0xFF), (char)(seq >> 8), (char)status});
+}
+
+static std::string closeFrame(uint16_t code) {
+  return std::string({(char)0x88, 2, (char)(code >> 8), (char)(code & 0xFF)});
+}
+
+static std::shared_ptr<HostSocket> openSession() {
+  std::shared_ptr<HostSocket> socket = connectLive();
+  std::string reply = exchange(socket, handshakeRequest(freshToken()));
+  CHECK(reply.rfind("HTTP/1.1 101 ", 0) == 0);
+  return socket;
+}
+
+static void closeSession(const std::shared_ptr<HostSocket>& socket) {
+  exchange(socket, clientFrame(0x8, std::string("\x03\xE8", 2)));
+  CHECK(!isLiveChannelOpen() && !socket->open);
+}
+
+static void testHandshake() {
+  std::shared_ptr<HostSocket> socket = connectLive();
+  std::string request = handshakeRequest(freshToken());
+
+  // The request may arrive in pieces
+  CHECK(exchange(socket, request.substr(0, 20)).empty());
+  CHECK(!isLiveChannelOpen());
+  played.clear();
+  std::string reply = exchange(socket, request.substr(20));
+  CHECK(reply.rfind("HTTP/1.1 101 Switching Protocols\r\n", 0) == 0);
+  CHECK(reply.find(std::string("Sec-WebSocket-Accept: ") + ACCEPT + "\r\n") != std::string::npos);
+  CHECK(isLiveChannelOpen());
+  CHECK(played.size() == 1 && played[0].opcode == HID_OP_RATE);
+
+  // One session at a time
+  std::shared_ptr<HostSocket> second = connectLive();
+  CHECK(exchange(second, handshakeRequest(freshToken())).rfind("HTTP/1.1 503 ", 0) == 0);
+  CHECK(!second->open && isLiveChannelOpen());
+
+  closeSession(socket);
+}
+
+static void expectRefused(const std::string& request, const char* status) {
+  std::shared_ptr<HostSocket> socket = connectLive();
+  CHECK(exchange(socket, request).rfind(std::string("HTTP/1.1 ") + status, 0) == 0);
+  CHECK(!socket->open && !isLiveChannelOpen());
+}
+
+static void testToken() {
+  std::string token = freshToken();
+  std::shared_ptr<HostSocket> socket = connectLive();
+  CHECK(exchange(socket, handshakeRequest(token)).rfind("HTTP/1.1 101 ", 0) == 0);
+  closeSession(socket);
+
+  // Used once already
+  expectRefused(handshakeRequest(token), "403");
+
+  // A wrong guess uses up the token too
+  token = freshToken();
+  expectRefused(handshakeRequest(std::string(32, '0')), "403");
+  expectRefused(handshakeRequest(token), "403");
+
+  token = freshToken();
+  advanceHostClock(LIVE_TOKEN_TTL_MS * 1000ULL);
+  expectRefused(handshakeRequest(token), "403");
+
+  expectRefused(handshakeRequest(freshToken().substr(0, 31)), "403");
+  expectRefused("GET / HTTP/1.1\r\nSec-WebSocket-Key: x\r\n\r\n", "400");
+  expectRefused(handshakeRequest(freshToken(), nullptr), "400");
+
+  // A request that never ends
+  socket = connectLive();
+  CHECK(exchange(socket, "GET /?token=").empty());
+  advanceHostClock(LIVE_HANDSHAKE_TIMEOUT_MS * 1000ULL);
+  CHECK(exchange(socket, "").rfind("HTTP/1.1 408 ", 0) == 0);
+}
+
+static void testFrames() {
+  std::shared_ptr<HostSocket> socket = openSession();
+
+  // Acknowledged once core1 has sent the report
+  played.clear();
+  CHECK(exchange(socket, clientFrame(0x2, keyEvent(LIVE_KEY_DOWN, HID_KEY_A, 7))) == ackFrame(7, LIVE_ACK_SENT));
+  CHECK(played.size() == 1 && played[0].keycode[0] == HID_KEY_A);
+
+  // One byte at a time, two events in one frame
+  std::string frame = clientFrame(0x2, keyEvent(LIVE_KEY_DOWN, HID_KEY_SHIFT_LEFT, 8) + keyEvent(LIVE_KEY_UP, HID_KEY_A, 9));
+  std::string reply;
+  for (char byte : frame) reply += exchange(socket, std::string(1, byte));
+  CHECK(reply == ackFrame(8, LIVE_ACK_SENT) + ackFrame(9, LIVE_ACK_SENT));
+  CHECK(played.size() == 3 && played[2].modifier == KEYBOARD_MODIFIER_LEFTSHIFT && played[2].keycode[0] == 0);
+
+  CHECK(exchange(socket, clientFrame(0x2, keyEvent(9, HID_KEY_A, 10))) == ackFrame(10, LIVE_ACK_INVALID));
+  CHECK(exchange(socket, clientFrame(0x9, "ping")) == std::string("\x8A\x04ping", 6));
+
+  // A batch longer than a 7-bit length
+  std::string batch = "TEXT " + std::string(200, 'x');
+  reply = exchange(socket, clientFrame(0x1, batch));
+  CHECK(reply.size() > 2 && (uint8_t)reply[0] == 0x81 && reply.find("{\"job\":") == 2);
+  reply = exchange(socket, clientFrame(0x1, "NOSUCHSTEP"));
+  CHECK(reply.find("{\"error\":") == 2);
+  while (activeKeystrokeJobId != nextKeystrokeJobId) {
+    serviceKeystrokeQueue();
+    playHidReports();
+  }
+
+  // Clients must mask
+  CHECK(exchange(socket, clientFrame(0x2, keyEvent(LIVE_KEY_DOWN, HID_KEY_B, 11), false)) == closeFrame(1002));
+  CHECK(!isLiveChannelOpen() && !socket->open);
+
+  // Longer than LIVE_FRAME_SIZE with a 16-bit length
+  socket = openSession();
+  CHECK(exchange(socket, clientFrame(0x1, std::string(LIVE_FRAME_SIZE + 1, 'x'))) == closeFrame(1002));
+  CHECK(!isLiveChannelOpen());
+
+  // A 64-bit length is refused before its length bytes are read, even when
+  // they would pass for a short frame holding a key event
+  socket = openSession();
+  played.clear();
+  std::string huge("\x82\xFF", 2);
+  huge += std::string(6, '\0') + std::string("\x00\x04", 2) + std::string(4, '\0') + keyEvent(LIVE_KEY_DOWN, HID_KEY_C, 12);
+  CHECK(exchange(socket, huge) == closeFrame(1009));
+  CHECK(played.empty() && !isLiveChannelOpen() && !socket->open);
+}
+
+// Keys still down when the connection drops are let go
+static void testReleaseOnDisconnect() {
+  std::shared_ptr<HostSocket> socket = openSession();
+  exchange(socket, clientFrame(0x2, keyEvent(LIVE_KEY_DOWN, HID_KEY_CONTROL_LEFT, 1) + keyEvent(LIVE_KEY_DOWN, HID_KEY_C, 2)));
+  played.clear();
+  socket->open = false;
+  exchange(socket, "");
+  CHECK(!isLiveChannelOpen());
+  CHECK(played.size() == 1 && played[0].opcode == HID_OP_REPORT && played[0].modifier == 0 && played[0].keycode[0] == 0);
+
+  // Nothing held, nothing sent
+  socket = openSession();
+  played.clear();
+  socket->open = false;
+  exchange(socket, "");
+  CHECK(played.empty());
+}
+
+int main() {
+  hostClockUs = 1000000;
+  deviceConfig.typingRateUs = TYPING_RATE_NORMAL_US;
+  initializeLiveChannel();
+
+  testHandshake();
+  testToken();
+  testFrames();
+  testReleaseOnDisconnect();
+  return finishChecks("live_channel_test");
+}
@@ -0,0 +1,98 @@
+// Program cache in program_cache.h: a key that matches but was stored for
+// other input is a miss, and the input stays with its program through
+// evictions and compaction
+#include <string>
+#include "../program_cache.h"
+#include "test_check.h"
+
+static bool sameReports(const KeystrokeProgram& a, const KeystrokeProgram& b) {
+  return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(HidReport)) == 0;
+}
+
+// Compiles text through the cache, as /send does
+static KeystrokeProgram cachedProgram(const std::string& text) {
+  KeystrokeProgram program;
+  compileCachedKeystrokeSequence(text.data(), text.size(), program);
+  return program;
+}
+
+static KeystrokeProgram freshProgram(const std::string& text) {
+  KeystrokeProgram program;
+  compileKeystrokeSequence(text.data(), text.size(), program);
+  return program;
+}
+
+// Two inputs given the same key, as a 64-bit collision would
+static void testCollision() {
+  initializeProgramCache(0);
+  initializeProgramCache(PROGRAM_CACHE_DEFAULT_KB);
+  std::string stored = "rm -rf build ENTER";
+  std::string other = "ls ENTER";
+  uint64_t key = programCacheKey(stored.data(), stored.size(), DEFAULT_KEYSTROKE_OPTIONS);
+  KeystrokeProgram program = freshProgram(stored);
+  storeCachedProgram(key, stored.data(), stored.size(), program.data(), program.size());
+  CHECK(programCacheEntries == 1);
+
+  KeystrokeProgram found;
+  CHECK(lookupCachedProgram(key, stored.data(), stored.size(), found) && sameReports(found, program));
+  found.clear();
+  CHECK(!lookupCachedProgram(key, other.data(), other.size(), found) && found.empty());
+
+  // Same length, one byte different
+  std::string near = stored;
+  near[3] = 'x';
+  CHECK(!lookupCachedProgram(key, near.data(), near.size(), found) && found.empty());
+
+  // A prefix of the stored input
+  CHECK(!lookupCachedProgram(key, stored.data(), 5, found) && found.empty());
+}
+
+// Hits after many stores, evictions and compactions still match a fresh compile
+static void testHitsMatchCompile() {
+  initializeProgramCache(0);
+  initializeProgramCache(4);
+  std::vector<std::string> texts;
+  for (int i = 0; i < 200; i++) {
+    std::string text = "text" + std::to_string(i * 7919) + (i % 3 ? " ENTER" : " CTRL+a TAB");
+    texts.push_back(text);
+  }
+
+  uint32_t mismatches = 0;
+  for (int round = 0; round < 4; round++) {
+    for (size_t i = 0; i < texts.size(); i += 1 + round) {
+      if (!sameReports(cachedProgram(texts[i]), freshProgram(texts[i]))) mismatches++;
+      if (!sameReports(cachedProgram(texts[i]), freshProgram(texts[i]))) mismatches++;
+    }
+  }
+  CHECK(mismatches == 0);
+  CHECK(programCacheHits > 0 && programCacheEvictions > 0);
+  CHECK(programCacheReports <= programCacheArena.size());
+
+  // Every entry holds its program and its input
+  uint32_t held = 0;
+  for (const ProgramCacheEntry& entry : programCacheIndex) {
+    if (entry.lastUsed != 0) held += programCacheSpan(entry);
+  }
+  CHECK(held == programCacheReports);
+}
+
+// The stored input counts towards the share one program may take
+static void testLongInput() {
+  initializeProgramCache(0);
+  initializeProgramCache(1);
+  size_t share = programCacheArena.size() / PROGRAM_CACHE_MAX_SHARE;
+  std::string text(share * sizeof(HidReport), ' ');
+  text += "a";
+  KeystrokeProgram program = freshProgram(text);
+  CHECK(program.size() < share);
+  uint64_t key = programCacheKey(text.data(), text.size(), DEFAULT_KEYSTROKE_OPTIONS);
+  storeCachedProgram(key, text.data(), text.size(), program.data(), program.size());
+  CHECK(programCacheEntries == 0);
+}
+
+int main() {
+  testCollision();
+  testHitsMatchCompile();
+  testLongInput();
+  return finishChecks("program_cache_test");
+}
@@ -0,0 +1,82 @@
+// SpscRing from report_ring.h, single-threaded and with the producer and
+// consumer on two threads as they are on the two RP2040 cores
+#include <thread>
+#include "../report_ring.h"
+#include "test_check.h"
+
+#define RING_SIZE 8
+#define THREADED_ITEMS 2000000
+
+typedef struct {
+  uint32_t sequence;
+  uint32_t check;  // Derived from sequence, so a torn copy shows up
+} RingItem;
+
+static RingItem makeItem(uint32_t sequence) {
+  return {sequence, sequence * 2654435761u};
+}
+
+static void testSingleThread() {
+  SpscRing<RingItem, RING_SIZE> ring;
+  RingItem item;
+  CHECK(ring.empty());
+  CHECK(!ring.pop(item));
+  CHECK(ring.space() == RING_SIZE);
+
+  for (uint32_t i = 0; i < RING_SIZE; i++) {
+    CHECK(ring.push(makeItem(i)));
+  }
+  CHECK(!ring.push(makeItem(RING_SIZE)));
+  CHECK(ring.size() == RING_SIZE && ring.space() == 0);
+
+  // Wrap round the buffer many times, one in and one out
+  uint32_t expected = 0;
+  for (uint32_t i = RING_SIZE; i < 1000; i++) {
+    CHECK(ring.pop(item) && item.sequence == expected++);
+    CHECK(ring.push(makeItem(i)));
+  }
+  while (ring.pop(item)) {
+    CHECK(item.sequence == expected++);
+  }
+  CHECK(expected == 1000 && ring.empty());
+}
+
+static void testTwoThreads() {
+  static SpscRing<RingItem, RING_SIZE> ring;
+  uint32_t received = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t torn = 0;
+
+  std::thread consumer([&]() {
+    RingItem item;
+    while (received < THREADED_ITEMS) {
+      if (!ring.pop(item)) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (item.sequence != received) outOfOrder++;
+      if (item.check != makeItem(item.sequence).check) torn++;
+      received++;
+    }
+  });
+
+  for (uint32_t sequence = 0; sequence < THREADED_ITEMS;) {
+    if (ring.push(makeItem(sequence))) {
+      sequence++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+
+  CHECK(received == THREADED_ITEMS);
+  CHECK(outOfOrder == 0);
+  CHECK(torn == 0);
+  CHECK(ring.empty());
+}
+
+int main() {
+  testSingleThread();
+  testTwoThreads();
+  return finishChecks("report_ring_test");
+}
@@ -0,0 +1,146 @@
+// Client table in security_manager.h: blocking rules, expiry, /24 blocks, and
+// a soak of 100k distinct addresses that must not allocate, grow the table or
+// push out a blocked client
+#include <new>
+#include "../security_manager.h"
+#include "test_check.h"
+
+#define SOAK_CLIENTS 100000
+
+static uint64_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+  void* block = malloc(size ? size : 1);
+  if (!block) throw std::bad_alloc();
+  heapAllocations++;
+  return block;
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+static void resetClients() {
+  memset(clientRecords, 0, sizeof(clientRecords));
+  clientRecordsEvicted = 0;
+  deviceConfig.blockSubnet = false;
+}
+
+static IPAddress addressOf(uint32_t address) {
+  return IPAddress(address >> 24, address >> 16, address >> 8, address);
+}
+
+static int usedSlots() {
+  int used = 0;
+  for (const ClientRecord& record : clientRecords) {
+    if (record.kind != CLIENT_SLOT_EMPTY) used++;
+  }
+  return used;
+}
+
+static void testBlocking() {
+  resetClients();
+  IPAddress client(192, 168, 1, 20);
+  for (int i = 0; i < MAX_FAILED_ATTEMPTS; i++) {
+    recordFailedAttempt(client);
+    advanceHostClock(1000);
+  }
+  CHECK(getFailedAttemptCount(client) == MAX_FAILED_ATTEMPTS);
+  CHECK(!isClientBlocked(client));
+
+  blockClient(client);
+  CHECK(isClientBlocked(client));
+  CHECK(getFailedAttemptCount(client) == 0);
+  CHECK(countBlockedClients() == 1);
+
+  // A good login does not lift a block
+  clearFailedAttempts(client);
+  CHECK(isClientBlocked(client));
+
+  advanceHostClock((BLOCK_DURATION_MS - 1) * 1000ULL);
+  CHECK(isClientBlocked(client));
+  advanceHostClock(1000);
+  CHECK(!isClientBlocked(client));
+  unblockExpiredIPs();
+  CHECK(countBlockedClients() == 0 && usedSlots() == 0);
+
+  // Failure counts are forgotten after the same idle time
+  recordFailedAttempt(client);
+  advanceHostClock(BLOCK_DURATION_MS * 1000ULL);
+  CHECK(getFailedAttemptCount(client) == 0);
+}
+
+static void testSubnetBlocking() {
+  resetClients();
+  deviceConfig.blockSubnet = true;
+  recordFailedAttempt(IPAddress(10, 0, 0, 5));
+  blockClient(IPAddress(10, 0, 0, 5));
+  CHECK(isClientBlocked(IPAddress(10, 0, 0, 5)));
+  CHECK(isClientBlocked(IPAddress(10, 0, 0, 77)));
+  CHECK(!isClientBlocked(IPAddress(10, 0, 1, 5)));
+  CHECK(getFailedAttemptCount(IPAddress(10, 0, 0, 5)) == 0);
+  CHECK(countBlockedClients() == 1);
+
+  deviceConfig.blockSubnet = false;
+  CHECK(!isClientBlocked(IPAddress(10, 0, 0, 77)));
+}
+
+// A window of blocked clients still takes a new record, at the oldest one's expense
+static void testFullWindow() {
+  resetClients();
+  uint32_t sameWindow[CLIENT_PROBE_WINDOW + 1];
+  uint32_t found = 0;
+  for (uint32_t address = 0x0A000001; found <= CLIENT_PROBE_WINDOW; address++) {
+    if (clientSlotIndex(address) == clientSlotIndex(0x0A000001)) sameWindow[found++] = address;
+  }
+  CHECK(clientSlotIndex(sameWindow[0]) < CLIENT_TABLE_SIZE);
+
+  for (uint32_t i = 0; i < CLIENT_PROBE_WINDOW; i++) {
+    blockClient(addressOf(sameWindow[i]));
+    advanceHostClock(1000);
+  }
+  recordFailedAttempt(addressOf(sameWindow[CLIENT_PROBE_WINDOW]));
+  CHECK(getFailedAttemptCount(addressOf(sameWindow[CLIENT_PROBE_WINDOW])) == 1);
+  CHECK(!isClientBlocked(addressOf(sameWindow[0])));
+  for (uint32_t i = 1; i < CLIENT_PROBE_WINDOW; i++) {
+    CHECK(isClientBlocked(addressOf(sameWindow[i])));
+  }
+  CHECK(clientRecordsEvicted == 1);
+}
+
+static void testSoak() {
+  resetClients();
+  IPAddress attacker(203, 0, 113, 9);
+  blockClient(attacker);
+
+  uint64_t allocationsBefore = heapAllocations;
+  uint32_t stillBlocked = 0;
+  uint32_t checks = 0;
+  for (uint32_t i = 0; i < SOAK_CLIENTS; i++) {
+    IPAddress client = addressOf(0x64400000 + i * 7919);
+    if (!isClientBlocked(client)) {
+      recordFailedAttempt(client);
+    }
+    if (i % 1000 == 0) {
+      checks++;
+      if (isClientBlocked(attacker)) stillBlocked++;
+    }
+    advanceHostClock(10000);
+  }
+
+  CHECK(heapAllocations == allocationsBefore);
+  CHECK(usedSlots() <= CLIENT_TABLE_SIZE);
+  CHECK(clientRecordsEvicted >= SOAK_CLIENTS - CLIENT_TABLE_SIZE);
+  CHECK(stillBlocked == checks);
+  CHECK(countBlockedClients() == 1);
+  printf("client table: %zu bytes, %u evictions over %u clients\n", sizeof(clientRecords),
+    clientRecordsEvicted, SOAK_CLIENTS);
+}
+
+int main() {
+  hostClockUs = 1000000;
+  testBlocking();
+  testSubnetBlocking();
+  testFullWindow();
+  testSoak();
+  return finishChecks("security_manager_test");
+}
@@ -0,0 +1,28 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+// Checks for the host tests in this directory, which tools/host_checks.sh
+// builds and runs. A failed CHECK prints where it failed and the test carries
+// on; main() returns finishChecks() so any failure sets the exit status.
+#include <stdio.h>
+
+inline int checksRun = 0;
+inline int checksFailed = 0;
+
+#define CHECK(condition) recordCheck((condition), #condition, __FILE__, __LINE__)
+
+inline bool recordCheck(bool passed, const char* text, const char* file, int line) {
+  checksRun++;
+  if (!passed) {
+    checksFailed++;
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, text);
+  }
+  return passed;
+}
+
+inline int finishChecks(const char* name) {
+  printf("%s: %d checks, %d failed\n", name, checksRun, checksFailed);
+  return checksFailed == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,203 @@
+// Raw-body routes in web_server_handler.h, served by the WebServer stand-in
+// with the body streamed to their raw handlers: one Digest request checks its
+// credentials once, so it is accepted and typed once, and a wrong password is
+// counted once. Stored macros play the same from /macro/<name> and from a
+// batch.
+#include <string>
+#include "../web_server_handler.h"
+#include "hid_host.h"
+#include "test_check.h"
+
+static const char* USERNAME = "admin";
+static const char* PASSWORD = "correct horse";
+static const IPAddress CLIENT(192, 168, 1, 20);
+
+static std::string nonce;
+static uint32_t nonceCount = 0;
+
+static std::string md5Text(const std::string& text) {
+  char out[33];
+  MD5Builder md5;
+  md5.begin();
+  md5.add(text.c_str());
+  md5.calculate();
+  md5.getChars(out);
+  return out;
+}
+
+static std::string digestHeader(const char* method, const std::string& uri, const char* password = PASSWORD) {
+  char nc[9];
+  snprintf(nc, sizeof(nc), "%08x", ++nonceCount);
+  std::string ha1 = md5Text(std::string(USERNAME) + ":" + AUTH_REALM + ":" + password);
+  std::string ha2 = md5Text(std::string(method) + ":" + uri);
+  std::string response = md5Text(ha1 + ":" + nonce + ":" + nc + ":0a4f113b:auth:" + ha2);
+  return std::string("Digest username=\"") + USERNAME + "\", realm=\"" + AUTH_REALM + "\", nonce=\"" + nonce +
+         "\", uri=\"" + uri + "\", qop=auth, nc=" + nc + ", cnonce=\"0a4f113b\", response=\"" + response + "\"";
+}
+
+// Core1 stand-in: keeps the reports that leave the ring
+static KeystrokeProgram played;
+
+static void playHidReports() {
+  HidReport report;
+  while (hidReportRing.pop(report)) {
+    played.push_back(report);
+    hidReportsEmitted++;
+  }
+}
+
+static void drainHidQueue() {
+  do {
+    serviceKeystrokeQueue();
+    playHidReports();
+  } while (!isHidIdle());
+  serviceKeystrokeQueue();  // Retires the job whose last report just left
+}
+
+static int serve(const HostRequest& request) {
+  hostClockUs += 20000;
+  int status = webServer.serve(request);
+  handleWebServerClient();
+  drainHidQueue();
+  return status;
+}
+
+// Takes the nonce from a challenge, as a browser does after a 401
+static void takeChallenge() {
+  const std::string& challenge = webServer.responseHeaders["WWW-Authenticate"];
+  nonce = challenge.substr(challenge.find("nonce=\"") + 7, DIGEST_NONCE_SIZE - 1);
+  nonceCount = 0;
+}
+
+static void testKeystrokeUpload() {
+  CHECK(serve({HTTP_POST, "/send/raw", CLIENT, {}, {{"plain", "hello"}}}) == 401);
+  takeChallenge();
+
+  // Longer than one raw block
+  std::string text(HTTP_RAW_BUFLEN * 2 + 100, 'a');
+  text += " ENTER";
+  played.clear();
+  CHECK(serve({HTTP_POST, "/send/raw", CLIENT, {{"Authorization", digestHeader("POST", "/send/raw")}},
+    {{"plain", text}}}) == 202);
+  CHECK(decodeHidProgram(played, LAYOUT_US) == std::string(HTTP_RAW_BUFLEN * 2 + 100, 'a') + "\n");
+
+  uint32_t jobId = strtoul(webServer.responseHeaders["Location"].c_str() + 6, nullptr, 10);
+  const KeystrokeJob* job = findKeystrokeJob(jobId);
+  CHECK(job && job->state == JOB_DONE && job->total == played.size());
+
+  // The same request again is a replay
+  nonceCount--;
+  played.clear();
+  CHECK(serve({HTTP_POST, "/send/raw", CLIENT, {{"Authorization", digestHeader("POST", "/send/raw")}},
+    {{"plain", "again"}}}) == 401);
+  CHECK(webServer.responseHeaders["WWW-Authenticate"].find("stale=true") != std::string::npos);
+  CHECK(played.empty());
+}
+
+static void testMacroUpload() {
+  takeChallenge();
+  CHECK(serve({HTTP_PUT, "/macro/greet", CLIENT, {{"Authorization", digestHeader("PUT", "/macro/greet")}},
+    {{"plain", "hi ENTER"}}}) == 201);
+  CHECK(hostFiles.count(MACRO_DIR "/greet" MACRO_EXTENSION) == 1);
+
+  played.clear();
+  CHECK(serve({HTTP_POST, "/macro/greet", CLIENT, {{"Authorization", digestHeader("POST", "/macro/greet")}}, {}}) == 202);
+  CHECK(decodeHidProgram(played, LAYOUT_US) == "hi\n");
+
+  CHECK(serve({HTTP_PUT, "/macro/other", CLIENT, {}, {{"plain", "x"}}}) == 401);
+  CHECK(hostFiles.count(MACRO_DIR "/other" MACRO_EXTENSION) == 0);
+}
+
+// Job from the last response's Location header
+static const KeystrokeJob* respondedJob() {
+  return findKeystrokeJob(strtoul(webServer.responseHeaders["Location"].c_str() + 6, nullptr, 10));
+}
+
+// Precompiled macro file around the reports, as tools/macro_compiler.cpp writes it
+static std::string macroFile(const KeystrokeProgram& reports) {
+  MacroBuilder builder;
+  beginMacro(builder, LAYOUT_US, TYPING_RATE_FAST_US);
+  addMacroReports(builder, reports.data(), reports.size());
+  const MacroHeader& header = finishMacro(builder);
+  return std::string((const char*)&header, sizeof(header)) +
+         std::string((const char*)reports.data(), reports.size() * sizeof(HidReport));
+}
+
+// A stored macro types the same from /macro/<name> as from a batch MACRO step,
+// and each job counts the reports it plays; a file with a repeat is refused on
+// upload and by the batch
+static void testMacroBothWays() {
+  KeystrokeProgram reports;
+  compileKeystrokeSequence("ls -la CTRL+c ENTER", 19, reports);
+  CHECK(serve({HTTP_PUT, "/macro/both", CLIENT,
+    {{"Authorization", digestHeader("PUT", "/macro/both")}, {"Content-Type", "application/octet-stream"}},
+    {{"plain", macroFile(reports)}}}) == 201);
+
+  played.clear();
+  CHECK(serve({HTTP_POST, "/macro/both", CLIENT, {{"Authorization", digestHeader("POST", "/macro/both")}}, {}}) == 202);
+  std::string direct = decodeHidProgram(played, LAYOUT_US);
+  CHECK(respondedJob() && respondedJob()->total == played.size());
+
+  played.clear();
+  CHECK(serve({HTTP_POST, "/batch", CLIENT, {{"Authorization", digestHeader("POST", "/batch")}},
+    {{"plain", "MACRO both"}}}) == 202);
+  CHECK(decodeHidProgram(played, LAYOUT_US) == direct);
+  CHECK(direct == "ls -la[01+06]\n");
+  CHECK(respondedJob() && respondedJob()->total == played.size());
+
+  // A repeat would play once from the file, even with a count of 0
+  for (uint8_t times : {0, 3}) {
+    KeystrokeProgram repeated = {{0, HID_OP_REPEAT, {times, 0, (uint8_t)reports.size(), 0}}};
+    repeated.insert(repeated.end(), reports.begin(), reports.end());
+    CHECK(serve({HTTP_PUT, "/macro/rep", CLIENT,
+      {{"Authorization", digestHeader("PUT", "/macro/rep")}, {"Content-Type", "application/octet-stream"}},
+      {{"plain", macroFile(repeated)}}}) == 400);
+    CHECK(hostFiles.count(MACRO_DIR "/rep" MACRO_EXTENSION) == 0);
+
+    hostFiles[MACRO_DIR "/rep" MACRO_EXTENSION] = std::make_shared<std::string>(macroFile(repeated));  // Stored before repeats were refused
+    played.clear();
+    CHECK(serve({HTTP_POST, "/batch", CLIENT, {{"Authorization", digestHeader("POST", "/batch")}},
+      {{"plain", "MACRO rep"}}}) == 400);
+    CHECK(played.empty());
+    hostFiles.erase(MACRO_DIR "/rep" MACRO_EXTENSION);
+  }
+}
+
+// Job polls are challenged like any other route
+static void testJobStatus() {
+  CHECK(serve({HTTP_GET, "/jobs/1", CLIENT, {}, {}}) == 401);
+  CHECK(webServer.responseHeaders.count("WWW-Authenticate") == 1);
+  takeChallenge();
+  CHECK(serve({HTTP_GET, "/jobs/1", CLIENT, {{"Authorization", digestHeader("GET", "/jobs/1")}}, {}}) == 200);
+}
+
+// Each rejected upload is one failed attempt, however many blocks its body has
+static void testWrongPassword() {
+  const IPAddress guesser(10, 0, 0, 9);
+  std::string body(HTTP_RAW_BUFLEN * 3, 'x');
+  for (int i = 0; i < MAX_FAILED_ATTEMPTS - 1; i++) {
+    CHECK(serve({HTTP_POST, "/send/raw", guesser, {{"Authorization", digestHeader("POST", "/send/raw", "guess")}},
+      {{"plain", body}}}) == 401);
+    CHECK(getFailedAttemptCount(guesser) == i + 1);
+  }
+  CHECK(serve({HTTP_PUT, "/macro/guess", guesser, {{"Authorization", digestHeader("PUT", "/macro/guess", "guess")}},
+    {{"plain", body}}}) == 403);
+  CHECK(isClientBlocked(guesser));
+}
+
+int main() {
+  snprintf(deviceConfig.username, sizeof(deviceConfig.username), "%s", USERNAME);
+  snprintf(deviceConfig.userpass, sizeof(deviceConfig.userpass), "%s", PASSWORD);
+  deviceConfig.typingRateUs = TYPING_RATE_NORMAL_US;
+  hostFilesEnabled = true;
+  hostClockUs = 1000000;
+  hostYieldHook = playHidReports;  // Uploads longer than the ring wait for core1
+  initializeWebServer();
+
+  testKeystrokeUpload();
+  testMacroUpload();
+  testMacroBothWays();
+  testJobStatus();
+  testWrongPassword();
+  return finishChecks("web_server_handler_test");
+}
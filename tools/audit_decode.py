@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Decode the keystroke audit log.
+
+    python3 tools/audit_decode.py --user admin --password secret 192.168.1.50
+    python3 tools/audit_decode.py audit.bin
+
+Reads GET /audit from a device, or a file saved from it, and prints one
+line per record. Blocks whose CRC does not match are reported and skipped.
+The layout is described in audit_log.h.
+"""
+import argparse
+import struct
+import sys
+import urllib.request
+import zlib
+
+MAGIC = 0x41444948
+BLOCK_SIZE = 256
+HEADER = struct.Struct("<IBBHIII12x")
+RECORD = struct.Struct("<IBB4sHIIIQ")
+
+KINDS = {1: "send", 2: "upload", 3: "batch", 4: "macro", 5: "live-batch", 6: "live-session"}
+OUTCOMES = {0: "accepted", 1: "queue-full", 2: "rejected"}
+
+
+def fetch(host, user, password):
+    url = "http://%s/audit" % host
+    passwords = urllib.request.HTTPPasswordMgrWithDefaultRealm()
+    passwords.add_password(None, url, user, password)
+    opener = urllib.request.build_opener(urllib.request.HTTPDigestAuthHandler(passwords))
+    with opener.open(url, timeout=10) as response:
+        return response.read()
+
+
+def decode(data, out):
+    seen = set()
+    bad = 0
+    for offset in range(0, len(data) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        block = data[offset:offset + BLOCK_SIZE]
+        magic, version, count, boot, sequence, dropped, crc = HEADER.unpack_from(block)
+        unsigned = block[:16] + b"\0\0\0\0" + block[20:]
+        if magic != MAGIC or zlib.crc32(unsigned) != crc:
+            bad += 1
+            print("block at offset %d: bad magic or CRC, skipped" % offset, file=sys.stderr)
+            continue
+        if sequence in seen:
+            continue  # A block still in RAM is sent again once written
+        seen.add(sequence)
+        if dropped:
+            print("# %d records dropped before block %d" % (dropped, sequence), file=out)
+        for i in range(min(count, 7)):
+            time_ms, kind, outcome, ip, _, job, reports, length, digest = RECORD.unpack_from(block, 32 + i * 32)
+            print("boot %-5d %10.3f s  %-15s %-12s %-10s job %-6d %6d reports %7d bytes  fnv1a64 %016x" % (
+                boot, time_ms / 1000.0, ".".join(str(b) for b in ip), KINDS.get(kind, "kind-%d" % kind),
+                OUTCOMES.get(outcome, "outcome-%d" % outcome), job, reports, length, digest), file=out)
+    return bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="device address, or a file saved from /audit")
+    parser.add_argument("--user")
+    parser.add_argument("--password")
+    args = parser.parse_args()
+
+    if args.user:
+        data = fetch(args.source, args.user, args.password or "")
+    else:
+        with open(args.source, "rb") as f:
+            data = f.read()
+    sys.exit(1 if decode(data, sys.stdout) else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,365 @@
+// Host load harness for the authentication and blocking path. Builds the
+// sketch's web server, auth_manager.h, security_manager.h and the Slack
+// notifier against the fakes in tools/host/ and a virtual clock, then replays
+// password-guessing traffic with valid users mixed in:
+//
+//   g++ -std=gnu++17 -O2 -I tools/host -I path/to/tinyusb/src tools/auth_load.cpp -lcrypto -o auth_load
+//   ./auth_load [--seed N] [--scale N]
+//
+// Behaviour checks run first and set the exit status. Each scenario then
+// reports host-side requests/s and cost per request (compare runs with each
+// other, not with the device), the client table's use and evictions, and the
+// Slack lines the traffic would have posted.
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+#include "../web_server_handler.h"
+
+static const char* USERNAME = "admin";
+static const char* PASSWORD = "correct horse";
+static const char* PAGE = "/keys";
+static const char* STATUS = "/status";
+
+// Totals for one scenario
+typedef struct {
+  uint32_t requests;
+  uint32_t byStatus[6];       // 2xx, 3xx, 401, 403, other 4xx, 5xx
+  std::vector<double> costUs; // Wall time inside the handler, per request
+  uint32_t probes;            // Requests sent by attackers
+  uint32_t slackEvents;       // queueSlackEvent() calls, before coalescing
+  uint32_t slackPosts;
+  uint32_t slackLines;
+  int peakRecords;
+  int peakBlocked;
+  uint32_t validLogins;
+  uint32_t validFailures;
+} RunStats;
+
+static RunStats stats;
+
+// Slack webhook stand-in: counts posts and the lines in each
+static std::string respondToSlack(const std::string& request) {
+  stats.slackPosts++;
+  size_t body = request.find("\r\n\r\n");
+  for (size_t at = body; (at = request.find("\\n", at + 1)) != std::string::npos;) stats.slackLines++;
+  stats.slackLines++;
+  return "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+}
+
+static uint32_t slackQueued() {
+  uint32_t total = slackEventsDropped;
+  for (uint8_t i = 0; i < slackOutboxCount; i++) total += slackOutbox[i].count;
+  return total;
+}
+
+static int liveClientRecords() {
+  int live = 0;
+  for (const ClientRecord& record : clientRecords) {
+    if (record.kind != CLIENT_SLOT_EMPTY && !isExpiredClientRecord(record, millis())) live++;
+  }
+  return live;
+}
+
+static void md5Text(const std::string& text, char* out) {
+  MD5Builder md5;
+  md5.begin();
+  md5.add(text.c_str());
+  md5.calculate();
+  md5.getChars(out);
+}
+
+// Requests sent with each nonce, as the browser counts them for nc
+static std::map<std::string, uint32_t> nonceCounts;
+
+// Authorization header a browser would send for this nonce
+static std::string digestHeader(const char* password, const char* method, const char* uri, const std::string& nonce) {
+  char ha1[33], ha2[33], response[33], nc[9];
+  snprintf(nc, sizeof(nc), "%08x", ++nonceCounts[nonce]);
+  md5Text(std::string(USERNAME) + ":" + AUTH_REALM + ":" + password, ha1);
+  md5Text(std::string(method) + ":" + uri, ha2);
+  md5Text(std::string(ha1) + ":" + nonce + ":" + nc + ":0a4f113b:auth:" + ha2, response);
+  return std::string("Digest username=\"") + USERNAME + "\", realm=\"" + AUTH_REALM + "\", nonce=\"" + nonce +
+         "\", uri=\"" + uri + "\", qop=auth, nc=" + nc + ", cnonce=\"0a4f113b\", response=\"" + response + "\"";
+}
+
+// Runs one request, timing the handler and counting what it queued for Slack
+static int serve(HTTPMethod method, const char* uri, const IPAddress& ip, const std::string& authorization,
+                 const char* keystroke = nullptr) {
+  HostRequest request = {method, uri, ip, {}, {}};
+  if (!authorization.empty()) request.headers["Authorization"] = authorization;
+  if (keystroke) request.args["keystroke"] = keystroke;
+
+  uint32_t queued = slackQueued();
+  auto started = std::chrono::steady_clock::now();
+  int status = webServer.serve(request);
+  stats.costUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count());
+  stats.slackEvents += slackQueued() - queued;
+
+  stats.requests++;
+  stats.byStatus[status / 100 == 2 ? 0 : status / 100 == 3 ? 1 : status == 401 ? 2 : status == 403 ? 3 : status / 100 == 4 ? 4 : 5]++;
+  stats.peakRecords = std::max(stats.peakRecords, liveClientRecords());
+  stats.peakBlocked = std::max(stats.peakBlocked, countBlockedClients());
+  return status;
+}
+
+// Nonce from the last 401, or empty
+static std::string challengeNonce() {
+  const std::string& challenge = webServer.responseHeaders["WWW-Authenticate"];
+  size_t start = challenge.find("nonce=\"");
+  return start == std::string::npos ? std::string() : challenge.substr(start + 7, DIGEST_NONCE_SIZE - 1);
+}
+
+// Core1 stand-in: hands queued reports straight back
+static void drainHidQueue() {
+  HidReport report;
+  do {
+    serviceKeystrokeQueue();
+    while (hidReportRing.pop(report)) hidReportsEmitted++;
+  } while (!isHidIdle());
+}
+
+static void resetDevice(bool blockSubnet) {
+  memset(clientRecords, 0, sizeof(clientRecords));
+  clientRecordsEvicted = 0;
+  slackOutboxCount = 0;
+  slackEventsDropped = slackEventsDroppedReported = 0;
+  slackPostAttempted = false;
+  deviceConfig.blockSubnet = blockSubnet;
+  stats = RunStats();
+}
+
+// A client as the scheduler sees it
+typedef struct {
+  IPAddress ip;
+  bool valid;            // Knows the password
+  const char* target;    // Route guessed against
+  uint32_t intervalMs;   // Between actions
+  uint32_t actionsLeft;
+  std::string nonce;
+  uint32_t nonceMs;
+} LoadClient;
+
+static HTTPMethod targetMethod(const char* target) {
+  return strcmp(target, STATUS) == 0 ? HTTP_GET : HTTP_POST;
+}
+
+// Valid users load the page, are challenged when the form posts to /send as a
+// browser is, then queue keystrokes and check the status on the same nonce.
+// Attackers reuse a nonce until it goes stale and send one wrong password per action.
+static void runClient(LoadClient& client) {
+  bool needNonce = client.nonce.empty() || millis() - client.nonceMs > DIGEST_NONCE_TTL_MS - 10000;
+  if (client.valid) {
+    serve(HTTP_GET, PAGE, client.ip, "");
+  }
+  if (client.valid || needNonce) {
+    if (!client.valid) stats.probes++;
+    serve(targetMethod(client.target), client.target, client.ip, "");
+    client.nonce = challengeNonce();
+    client.nonceMs = millis();
+  }
+  if (client.nonce.empty()) {
+    if (client.valid) stats.validFailures++;
+    return; // Blocked before a challenge was sent
+  }
+
+  if (client.valid) {
+    bool ok = serve(HTTP_POST, "/send", client.ip, digestHeader(PASSWORD, "POST", "/send", client.nonce), "hunter2 ENTER") == 202 &&
+              serve(HTTP_GET, STATUS, client.ip, digestHeader(PASSWORD, "GET", STATUS, client.nonce)) == 200;
+    ok ? stats.validLogins++ : stats.validFailures++;
+    drainHidQueue();
+    return;
+  }
+
+  char guess[24];
+  snprintf(guess, sizeof(guess), "guess%lu", (unsigned long)client.actionsLeft);
+  HTTPMethod method = targetMethod(client.target);
+  stats.probes++;
+  serve(method, client.target, client.ip, digestHeader(guess, httpMethodName(method), client.target, client.nonce));
+}
+
+typedef struct {
+  uint64_t atUs;
+  size_t client;
+} LoadEvent;
+
+static bool operator>(const LoadEvent& a, const LoadEvent& b) { return a.atUs > b.atUs; }
+
+// Plays every client's actions in virtual time order, posting to Slack as loop() would
+static void runScenario(const char* name, std::vector<LoadClient>& clients, std::mt19937& random) {
+  std::priority_queue<LoadEvent, std::vector<LoadEvent>, std::greater<LoadEvent>> events;
+  uint64_t startUs = hostClockUs;
+  for (size_t i = 0; i < clients.size(); i++) {
+    events.push({startUs + (uint64_t)(random() % (clients[i].intervalMs + 1)) * 1000, i});
+  }
+
+  while (!events.empty()) {
+    LoadEvent event = events.top();
+    events.pop();
+    hostClockUs = event.atUs;
+    LoadClient& client = clients[event.client];
+    runClient(client);
+    serviceSlackNotifier();
+    if (--client.actionsLeft > 0) {
+      uint32_t jitter = client.intervalMs / 10 + 1;
+      events.push({event.atUs + (uint64_t)(client.intervalMs - jitter / 2 + random() % jitter) * 1000, event.client});
+    }
+  }
+  hostClockUs += SLACK_POST_INTERVAL_MS * 1000ULL;
+  serviceSlackNotifier();
+
+  std::vector<double>& cost = stats.costUs;
+  std::sort(cost.begin(), cost.end());
+  double totalUs = 0;
+  for (double us : cost) totalUs += us;
+  double minutes = (hostClockUs - startUs) / 60e6;
+
+  printf("%s (%.0f min virtual)\n", name, minutes);
+  printf("  requests %u: 2xx %u, 3xx %u, 401 %u, 403 %u, other 4xx %u, 5xx %u\n", stats.requests, stats.byStatus[0],
+    stats.byStatus[1], stats.byStatus[2], stats.byStatus[3], stats.byStatus[4], stats.byStatus[5]);
+  printf("  host cost: %.0f req/s, %.1f us/request, p99 %.1f us, max %.1f us\n", stats.requests / (totalUs / 1e6),
+    totalUs / stats.requests, cost[cost.size() * 99 / 100], cost.back());
+  printf("  client table: peak %d/%d records, peak %d blocked, %u evictions, %d blocked at end\n", stats.peakRecords,
+    CLIENT_TABLE_SIZE, stats.peakBlocked, clientRecordsEvicted, countBlockedClients());
+  printf("  slack: %u events -> %u posts, %u lines, %u dropped (%.3f lines per probe)\n", stats.slackEvents,
+    stats.slackPosts, stats.slackLines, slackEventsDropped, stats.probes ? (double)stats.slackLines / stats.probes : 0.0);
+  printf("  valid users: %u logins, %u failed\n\n", stats.validLogins, stats.validFailures);
+}
+
+static IPAddress randomAddress(std::mt19937& random) {
+  uint32_t address = random();
+  return IPAddress(1 + (address >> 24) % 223, address >> 16, address >> 8, 1 + address % 254);
+}
+
+static void addValidUsers(std::vector<LoadClient>& clients, uint32_t minutes) {
+  const IPAddress users[] = {IPAddress(192, 168, 1, 20), IPAddress(192, 168, 1, 21), IPAddress(10, 0, 0, 5)};
+  for (const IPAddress& ip : users) {
+    clients.push_back({ip, true, "/send", 120000, minutes / 2, "", 0});
+  }
+}
+
+// Exact expectations for one client; prints FAIL lines and returns false on a mismatch
+static bool checkBehaviour() {
+  bool passed = true;
+  auto expect = [&](bool condition, const char* what) {
+    if (!condition) printf("FAIL: %s\n", what);
+    passed = passed && condition;
+  };
+  resetDevice(false);
+  IPAddress ip(203, 0, 113, 7);
+
+  uint32_t queued = slackQueued();
+  expect(serve(HTTP_GET, PAGE, ip, "") == 200 && slackQueued() == queued, "the page needs no credentials and reaches no Slack event");
+  HostRequest revalidate = {HTTP_GET, PAGE, ip, {{"If-None-Match", INDEX_HTML_ASSET.etag}}, {}};
+  expect(webServer.serve(revalidate) == 304 && slackQueued() == queued, "revalidating the page reaches no Slack event");
+
+  for (int i = 0; i < MAX_FAILED_ATTEMPTS + 2; i++) serve(HTTP_GET, STATUS, ip, "");
+  expect(webServer.responseCode == 401 && getFailedAttemptCount(ip) == 0, "requests without credentials are not failed attempts");
+  std::string nonce = challengeNonce();
+
+  expect(serve(HTTP_GET, STATUS, ip, digestHeader("wrong", "GET", STATUS, nonce)) == 401, "first wrong password gets a challenge");
+  expect(getFailedAttemptCount(ip) == 1, "first wrong password counts as one attempt");
+  queued = slackQueued();
+  expect(serve(HTTP_GET, STATUS, ip, digestHeader(PASSWORD, "GET", STATUS, nonce)) == 200 && getFailedAttemptCount(ip) == 0,
+    "a correct password clears the count");
+  std::string login = digestHeader(PASSWORD, "GET", STATUS, nonce);
+  serve(HTTP_GET, STATUS, ip, login);
+  expect(slackQueued() == queued + 1, "a login is reported once per nonce");
+  expect(serve(HTTP_GET, STATUS, ip, login) == 401 && getFailedAttemptCount(ip) == 0 &&
+    webServer.responseHeaders["WWW-Authenticate"].find("stale=true") != std::string::npos,
+    "a replayed request gets a stale challenge and is not counted");
+
+  for (int i = 1; i < MAX_FAILED_ATTEMPTS; i++) serve(HTTP_GET, STATUS, ip, digestHeader("wrong", "GET", STATUS, nonce));
+  expect(webServer.responseCode == 401 && !isClientBlocked(ip), "not blocked below the limit");
+  expect(serve(HTTP_GET, STATUS, ip, digestHeader("wrong", "GET", STATUS, nonce)) == 403 && isClientBlocked(ip),
+    "blocked on the attempt that reaches the limit");
+  expect(serve(HTTP_GET, STATUS, ip, digestHeader(PASSWORD, "GET", STATUS, nonce)) == 403, "the right password is refused while blocked");
+
+  IPAddress scripted(203, 0, 113, 8);
+  for (int i = 0; i < MAX_FAILED_ATTEMPTS; i++) serve(HTTP_POST, "/login", scripted, digestHeader("wrong", "POST", "/login", nonce));
+  expect(webServer.responseCode == 403 && isClientBlocked(scripted), "wrong passwords on /login count towards the block");
+
+  hostClockUs += BLOCK_DURATION_MS * 1000ULL;
+  serve(HTTP_GET, STATUS, ip, "");
+  expect(serve(HTTP_GET, STATUS, ip, digestHeader(PASSWORD, "GET", STATUS, challengeNonce())) == 200, "the block expires");
+  return passed;
+}
+
+int main(int argc, char** argv) {
+  unsigned seed = 1;
+  uint32_t scale = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+      scale = std::max(1UL, strtoul(argv[++i], nullptr, 10));
+    } else {
+      fprintf(stderr, "usage: %s [--seed N] [--scale N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  snprintf(deviceConfig.username, sizeof(deviceConfig.username), "%s", USERNAME);
+  snprintf(deviceConfig.userpass, sizeof(deviceConfig.userpass), "%s", PASSWORD);
+  snprintf(deviceConfig.pagePath, sizeof(deviceConfig.pagePath), "%s", PAGE);
+  snprintf(deviceConfig.slackWebhook, sizeof(deviceConfig.slackWebhook), "/services/T0/B0/X");
+  snprintf(deviceConfig.slackHost, sizeof(deviceConfig.slackHost), "hooks.slack.com");
+  deviceConfig.slackPort = 443;
+  deviceConfig.slackTls = true;
+  deviceConfig.typingRateUs = TYPING_RATE_NORMAL_US;
+  deviceConfig.coalesceReleases = true;
+  WiFiClient::hostResponder = respondToSlack;
+  hostClockUs = 1000000;
+  initializeWebServer();
+
+  bool passed = checkBehaviour();
+  printf("behaviour checks: %s\n\n", passed ? "passed" : "FAILED");
+
+  std::mt19937 random(seed);
+  std::vector<LoadClient> clients;
+  char name[112];
+
+  // Many addresses, one guess each every ten minutes: more clients than table slots
+  resetDevice(false);
+  for (uint32_t i = 0; i < 2000 * scale; i++) clients.push_back({randomAddress(random), false, "/send", 600000, 6, "", 0});
+  addValidUsers(clients, 60);
+  snprintf(name, sizeof(name), "spray: %u addresses x 6 guesses, 10 min apart", 2000 * scale);
+  runScenario(name, clients, random);
+
+  // Few addresses, each staying under the idle expiry between guesses
+  clients.clear();
+  resetDevice(false);
+  for (uint32_t i = 0; i < 40 * scale; i++) clients.push_back({randomAddress(random), false, "/send", 25 * 60000, 12, "", 0});
+  addValidUsers(clients, 300);
+  snprintf(name, sizeof(name), "drip: %u addresses x 12 guesses, 25 min apart", 40 * scale);
+  runScenario(name, clients, random);
+
+  // One /24, each address below the per-address limit, with and without block_subnet
+  for (int blockSubnet = 0; blockSubnet < 2; blockSubnet++) {
+    clients.clear();
+    resetDevice(blockSubnet);
+    for (uint32_t i = 0; i < 250; i++) {
+      clients.push_back({IPAddress(198, 51, 100, 1 + i), false, "/send", 20 * 60000, MAX_FAILED_ATTEMPTS - 1, "", 0});
+    }
+    clients.push_back({IPAddress(198, 51, 100, 251), true, "/send", 120000, 30, "", 0});
+    addValidUsers(clients, 60);
+    runScenario(blockSubnet ? "subnet, block_subnet=1: 250 addresses in one /24 x 2 guesses, valid user in the /24"
+                            : "subnet, block_subnet=0: 250 addresses in one /24 x 2 guesses, valid user in the /24",
+      clients, random);
+  }
+
+  // A few addresses guessing as fast as the device answers
+  const char* targets[] = {STATUS, "/login", "/send"};
+  for (const char* target : targets) {
+    clients.clear();
+    resetDevice(false);
+    for (uint32_t i = 0; i < 5; i++) clients.push_back({randomAddress(random), false, target, 50, 2000 * scale, "", 0});
+    addValidUsers(clients, 10);
+    snprintf(name, sizeof(name), "burst on %s: 5 addresses x %u guesses, 20 per second each", target, 2000 * scale);
+    runScenario(name, clients, random);
+  }
+
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Host benchmark for the compiled program cache. Replays a trace shaped like
+// our automation traffic: a few hundred distinct sequences (unlock strings,
+// menu navigation, shell commands), a few of them sent most of the time, some
+// with the UK layout. Each request is compiled the way /send does it, first
+// without the cache, then through it at several program_cache_kb sizes:
+//
+//   g++ -std=c++17 -O2 -I path/to/tinyusb/src tools/cache_bench.cpp -o cache_bench
+//   ./cache_bench [--seed N] [--requests N] [--sequences N]
+//
+// Every cached program is checked against a fresh compile first; a mismatch
+// sets the exit status to 1. Times are host times: compare the rows with each
+// other, not with the device.
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include "../program_cache.h"
+
+// One request of the trace
+typedef struct {
+  uint32_t sequence;
+  KeystrokeOptions options;
+} TraceRequest;
+
+static const char* const COMMANDS[] = {
+  "ls -la", "cd /var/log", "tail -n 100 syslog", "sudo systemctl restart nginx", "git pull --rebase",
+  "docker ps -a", "uptime", "df -h", "journalctl -u ssh --since today", "ping -c 4 10.0.0.1",
+  "ssh deploy@build-01", "make -j8 && make install", "kubectl get pods -n staging", "top -b -n 1 | head -20",
+};
+static const char* const KEYS[] = {
+  "ENTER", "TAB", "ESC", "UP", "DOWN", "LEFT", "RIGHT", "F2", "F10", "F12", "CTRL+ALT+T", "CTRL+C",
+  "ALT+F4", "GUI+R", "CTRL+SHIFT+ESC", "SHIFT+TAB", "PAGEDOWN", "HOME",
+};
+
+static std::string randomWord(std::mt19937& random, size_t minLength, size_t maxLength, const char* alphabet) {
+  size_t length = minLength + random() % (maxLength - minLength + 1);
+  size_t size = strlen(alphabet);
+  std::string word;
+  for (size_t i = 0; i < length; i++) word += alphabet[random() % size];
+  return word;
+}
+
+// Distinct sequences: unlock strings, menu navigation and commands, in equal parts
+static std::vector<std::string> buildSequences(std::mt19937& random, uint32_t count) {
+  std::vector<std::string> sequences;
+  for (uint32_t i = 0; i < count; i++) {
+    std::string text;
+    switch (i % 3) {
+      case 0:
+        text = randomWord(random, 10, 24, "abcdefghijkmnopqrstuvwxyzABCDEFGHJKLMNPQRSTUVWXYZ23456789!#%*-_.") + " ENTER";
+        break;
+      case 1:
+        for (int steps = 2 + random() % 8; steps > 0; steps--) {
+          text += text.empty() ? "" : " ";
+          text += KEYS[random() % (sizeof(KEYS) / sizeof(KEYS[0]))];
+        }
+        break;
+      default:
+        text = std::string(COMMANDS[random() % (sizeof(COMMANDS) / sizeof(COMMANDS[0]))]) + " " +
+               randomWord(random, 0, 12, "abcdefghijklmnopqrstuvwxyz0123456789-./") + " ENTER";
+        break;
+    }
+    sequences.push_back(text);
+  }
+  return sequences;
+}
+
+// Zipf(1) popularity over the sequences; one request in ten uses the UK layout
+static std::vector<TraceRequest> buildTrace(std::mt19937& random, uint32_t sequences, uint32_t requests) {
+  std::vector<double> weights;
+  for (uint32_t i = 0; i < sequences; i++) weights.push_back(1.0 / (i + 1));
+  std::discrete_distribution<uint32_t> popularity(weights.begin(), weights.end());
+
+  std::vector<TraceRequest> trace;
+  for (uint32_t i = 0; i < requests; i++) {
+    TraceRequest request = {popularity(random), DEFAULT_KEYSTROKE_OPTIONS};
+    if (random() % 10 == 0) request.options.layout = LAYOUT_UK;
+    trace.push_back(request);
+  }
+  return trace;
+}
+
+static void resetCache(uint16_t kb) {
+  initializeProgramCache(0);
+  initializeProgramCache(kb);
+  programCacheHits = programCacheMisses = programCacheEvictions = 0;
+}
+
+// Nanoseconds per request to compile the whole trace from an empty cache of
+// kb (0 for none); best of a few runs, since the host is not a quiet device
+static double replay(const std::vector<std::string>& sequences, const std::vector<TraceRequest>& trace, uint16_t kb) {
+  KeystrokeProgram program;
+  double best = 0;
+  for (int run = 0; run < 5; run++) {
+    resetCache(kb);
+    auto started = std::chrono::steady_clock::now();
+    for (const TraceRequest& request : trace) {
+      const std::string& text = sequences[request.sequence];
+      appendTypingRate(program, TYPING_RATE_NORMAL_US);
+      compileCachedKeystrokeSequence(text.data(), text.size(), program, request.options);
+      recycleKeystrokeProgram(program);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / trace.size();
+    if (run == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+// Every program served by the cache must match a fresh compile
+static bool verify(const std::vector<std::string>& sequences, const std::vector<TraceRequest>& trace) {
+  KeystrokeProgram cached, fresh;
+  for (const TraceRequest& request : trace) {
+    const std::string& text = sequences[request.sequence];
+    compileCachedKeystrokeSequence(text.data(), text.size(), cached, request.options);
+    compileKeystrokeSequence(text.data(), text.size(), fresh, request.options);
+    if (cached.size() != fresh.size() || memcmp(cached.data(), fresh.data(), fresh.size() * sizeof(HidReport)) != 0) {
+      fprintf(stderr, "cached program differs for '%s'\n", text.c_str());
+      return false;
+    }
+    cached.clear();
+    fresh.clear();
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  unsigned seed = 1;
+  uint32_t requests = 200000;
+  uint32_t sequenceCount = 300;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+      requests = std::max(1UL, strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--sequences") == 0 && i + 1 < argc) {
+      sequenceCount = std::max(1UL, strtoul(argv[++i], nullptr, 10));
+    } else {
+      fprintf(stderr, "usage: %s [--seed N] [--requests N] [--sequences N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::mt19937 random(seed);
+  std::vector<std::string> sequences = buildSequences(random, sequenceCount);
+  std::vector<TraceRequest> trace = buildTrace(random, sequenceCount, requests);
+
+  size_t inputBytes = 0, reports = 0;
+  KeystrokeProgram program;
+  for (const TraceRequest& request : trace) {
+    const std::string& text = sequences[request.sequence];
+    compileKeystrokeSequence(text.data(), text.size(), program, request.options);
+    inputBytes += text.size();
+    reports += program.size();
+    program.clear();
+  }
+  printf("trace: %u requests over %u sequences, %.1f bytes and %.1f reports per request\n\n",
+    requests, sequenceCount, (double)inputBytes / requests, (double)reports / requests);
+
+  double uncachedNs = replay(sequences, trace, 0);
+  printf("%8s %8s %8s %10s %10s %12s %8s\n", "cache kb", "entries", "hit %", "evictions", "held kb", "ns/request", "speedup");
+  printf("%8s %8s %8s %10s %10s %12.0f %8s\n", "off", "-", "-", "-", "-", uncachedNs, "1.00x");
+
+  bool passed = true;
+  const uint16_t sizes[] = {1, 2, 4, 8, 16, 32, 64};
+  for (uint16_t kb : sizes) {
+    resetCache(kb);
+    passed = verify(sequences, trace) && passed;
+
+    double cachedNs = replay(sequences, trace, kb);
+    printf("%8u %8u %7.1f%% %10lu %10.1f %12.0f %7.2fx\n", kb, (unsigned)programCacheEntries,
+      100.0 * programCacheHits / (programCacheHits + programCacheMisses), (unsigned long)programCacheEvictions,
+      programCacheReports * sizeof(HidReport) / 1024.0, cachedNs, uncachedNs / cachedNs);
+  }
+
+  printf("\ncached programs %s fresh compiles\n", passed ? "match" : "DO NOT match");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Gzip the files in web/ into web_assets.h.
+
+Run from the repository root after editing anything in web/:
+
+    python3 tools/embed_assets.py
+
+Each file becomes a WebAsset named after it (index.html -> INDEX_HTML_ASSET)
+with a strong ETag derived from the compressed bytes. Output is reproducible,
+so the header only changes when an asset does.
+"""
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".json": "application/json",
+}
+
+
+def symbol_name(file_name):
+    return re.sub(r"[^A-Za-z0-9]", "_", file_name).upper()
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    web_dir = os.path.join(root, "web")
+    lines = [
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "// Generated by tools/embed_assets.py from web/ - do not edit",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "// Gzipped static file with its strong ETag",
+        "typedef struct {",
+        "  const char* contentType;",
+        "  const char* etag;",
+        "  const uint8_t* data;",
+        "  size_t length;",
+        "} WebAsset;",
+    ]
+
+    for file_name in sorted(os.listdir(web_dir)):
+        extension = os.path.splitext(file_name)[1]
+        if extension not in CONTENT_TYPES:
+            sys.exit("unknown content type for web/" + file_name)
+        with open(os.path.join(web_dir, file_name), "rb") as source:
+            data = gzip.compress(source.read(), compresslevel=9, mtime=0)
+
+        name = symbol_name(file_name)
+        etag = hashlib.sha256(data).hexdigest()[:16]
+        lines += ["", "// web/%s (%d bytes gzipped)" % (file_name, len(data))]
+        lines.append("const uint8_t %s_GZ[] = {" % name)
+        for offset in range(0, len(data), 16):
+            chunk = data[offset:offset + 16]
+            lines.append("  " + ", ".join("0x%02x" % b for b in chunk) + ",")
+        lines.append("};")
+        lines.append('const WebAsset %s_ASSET = {"%s", "\\"%s\\"", %s_GZ, sizeof(%s_GZ)};'
+                     % (name, CONTENT_TYPES[extension], etag, name, name))
+
+    lines += ["", "#endif", ""]
+    with open(os.path.join(root, "web_assets.h"), "w") as header:
+        header.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,210 @@
+// Host heap soak for the request and typing paths. Builds the sketch's web
+// server against the fakes in tools/host/ and a virtual clock, replays a
+// repeating mix of requests (logins, /send by Digest and session token,
+// /batch, job polls, /status, /metrics, wrong passwords) with every queued
+// report played back, and counts heap allocations made while the device
+// code runs:
+//
+//   g++ -std=gnu++17 -O2 -I tools/host -I path/to/tinyusb/src tools/heap_soak.cpp -lcrypto -o heap_soak
+//   ./heap_soak [--requests N]
+//
+// After a warm-up the allocations per request must stay the same from one
+// window to the next, the live heap must come back to where it was, and the
+// peak must not grow; otherwise the exit status is 1. The fakes allocate too
+// (they model the WebServer's String arguments), so compare runs of this tool
+// with each other rather than reading the counts as device figures.
+#include <malloc.h>
+#include <algorithm>
+#include <new>
+#include "../web_server_handler.h"
+
+static size_t heapLive = 0;
+static size_t heapPeak = 0;
+static uint64_t heapAllocations = 0;
+static bool heapCounting = false;  // Only allocations made by device code are counted
+
+void* operator new(size_t size) {
+  void* block = malloc(size ? size : 1);
+  if (!block) throw std::bad_alloc();
+  heapLive += malloc_usable_size(block);
+  if (heapLive > heapPeak) heapPeak = heapLive;
+  if (heapCounting) heapAllocations++;
+  return block;
+}
+
+void operator delete(void* block) noexcept {
+  if (block) {
+    heapLive -= malloc_usable_size(block);
+    free(block);
+  }
+}
+
+void operator delete(void* block, size_t) noexcept { operator delete(block); }
+
+static const char* USERNAME = "admin";
+static const char* PASSWORD = "correct horse";
+static const char* PAGE = "/keys";
+static const IPAddress USER_IP(192, 168, 1, 20);
+
+static const char* const TEXTS[] = {
+  "ls -la ENTER",
+  "CTRL+ALT+T",
+  "The quick brown fox jumps over the lazy dog. 0123456789 !@#$%^&*()",
+  "git log --oneline --graph --decorate --all | head -n 40 ENTER",
+  "VOLUP VOLUP MUTE",
+  "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore "
+  "magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo "
+  "consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur.",
+};
+static const char* const BATCH = "KEYS CTRL+ALT+T\nWAIT 500\nTEXT uptime\nKEYS ENTER\n";
+
+#define MIX_PERIOD 3000U
+
+static std::string nonce;
+static uint32_t nonceCount = 0;
+static std::string token;
+static uint32_t lastJobId = 0;
+
+static void md5Text(const std::string& text, char* out) {
+  MD5Builder md5;
+  md5.begin();
+  md5.add(text.c_str());
+  md5.calculate();
+  md5.getChars(out);
+}
+
+// nc counts the requests sent with the current nonce
+static std::string digestHeader(const char* password, const char* method, const char* uri) {
+  char ha1[33], ha2[33], response[33], nc[9];
+  snprintf(nc, sizeof(nc), "%08x", ++nonceCount);
+  md5Text(std::string(USERNAME) + ":" + AUTH_REALM + ":" + password, ha1);
+  md5Text(std::string(method) + ":" + uri, ha2);
+  md5Text(std::string(ha1) + ":" + nonce + ":" + nc + ":0a4f113b:auth:" + ha2, response);
+  return std::string("Digest username=\"") + USERNAME + "\", realm=\"" + AUTH_REALM + "\", nonce=\"" + nonce +
+         "\", uri=\"" + uri + "\", qop=auth, nc=" + nc + ", cnonce=\"0a4f113b\", response=\"" + response + "\"";
+}
+
+// Core1 stand-in: hands queued reports straight back
+static void drainHidQueue() {
+  HidReport report;
+  do {
+    serviceKeystrokeQueue();
+    while (hidReportRing.pop(report)) hidReportsEmitted++;
+  } while (!isHidIdle());
+}
+
+// One request, then what loop() would run before the next
+static int serve(const HostRequest& request) {
+  heapCounting = true;
+  int status = webServer.serve(request);
+  handleWebServerClient();
+  drainHidQueue();
+  serviceSlackNotifier();
+  heapCounting = false;
+  return status;
+}
+
+// Request number i of the repeating mix
+static void runRequest(uint32_t i) {
+  HostRequest request = {HTTP_GET, PAGE, USER_IP, {}, {}};
+  const char* text = TEXTS[(i / 10) % (sizeof(TEXTS) / sizeof(TEXTS[0]))];
+  char uri[24];
+
+  switch (i % 10) {
+    case 0:  // The form's first post, without credentials; its nonce is used by the rest of the cycle
+      request = {HTTP_POST, "/send", USER_IP, {}, {{"keystroke", text}}};
+      serve(request);
+      nonce = webServer.responseHeaders["WWW-Authenticate"].substr(webServer.responseHeaders["WWW-Authenticate"].find("nonce=\"") + 7, DIGEST_NONCE_SIZE - 1);
+      nonceCount = 0;
+      return;
+    case 1:  // The page itself needs no credentials
+      break;
+    case 2:
+    case 5:
+      request = {HTTP_POST, "/send", USER_IP, {{"Authorization", digestHeader(PASSWORD, "POST", "/send")}}, {{"keystroke", text}}};
+      break;
+    case 3:
+      request = {HTTP_POST, "/login", USER_IP, {{"Authorization", digestHeader(PASSWORD, "POST", "/login")}}, {}};
+      serve(request);
+      token = "Bearer " + webServer.responseBody.substr(webServer.responseBody.find("\"token\":\"") + 9, SESSION_TOKEN_SIZE - 1);
+      return;
+    case 4:
+      request = {HTTP_POST, "/send", USER_IP, {{"Authorization", token}}, {{"keystroke", text}, {"rate", "fast"}}};
+      break;
+    case 6:
+      request = {HTTP_POST, "/batch", USER_IP, {{"Authorization", token}}, {{"plain", BATCH}}};
+      break;
+    case 7:
+      snprintf(uri, sizeof(uri), "/jobs/%lu", (unsigned long)lastJobId);
+      request = {HTTP_GET, uri, USER_IP, {{"Authorization", token}}, {}};
+      break;
+    case 8:
+      request = {HTTP_GET, i % 20 < 10 ? "/status" : "/metrics", USER_IP, {{"Authorization", token}}, {}};
+      break;
+    case 9:  // Someone else guessing, from a new address each time so none is blocked
+             // and the mix stays periodic
+      request.clientIP = IPAddress(10, (i / 10) >> 16 & 0xFF, (i / 10) >> 8 & 0xFF, (i / 10) & 0xFF);
+      request = {HTTP_POST, "/send", request.clientIP, {{"Authorization", digestHeader("guess", "POST", "/send")}}, {}};
+      break;
+  }
+
+  int status = serve(request);
+  const std::string& location = webServer.responseHeaders["Location"];
+  if (status == 202 && location.size() > 6) lastJobId = strtoul(location.c_str() + 6, nullptr, 10);
+}
+
+int main(int argc, char** argv) {
+  uint32_t requests = 1000000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+      requests = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--requests N]\n", argv[0]);
+      return 2;
+    }
+  }
+  // Whole cycles of the mix (600 requests) and of Slack posts (every 1500 requests)
+  const uint32_t window = std::max(requests / 10 / MIX_PERIOD * MIX_PERIOD, MIX_PERIOD);
+  const uint32_t warmup = window;
+
+  snprintf(deviceConfig.username, sizeof(deviceConfig.username), "%s", USERNAME);
+  snprintf(deviceConfig.userpass, sizeof(deviceConfig.userpass), "%s", PASSWORD);
+  snprintf(deviceConfig.pagePath, sizeof(deviceConfig.pagePath), "%s", PAGE);
+  snprintf(deviceConfig.slackWebhook, sizeof(deviceConfig.slackWebhook), "/services/T0/B0/X");
+  snprintf(deviceConfig.slackHost, sizeof(deviceConfig.slackHost), "hooks.slack.com");
+  deviceConfig.slackPort = 443;
+  deviceConfig.slackTls = true;
+  deviceConfig.typingRateUs = TYPING_RATE_NORMAL_US;
+  deviceConfig.coalesceReleases = true;
+  WiFiClient::hostResponder = [](const std::string&) { return std::string("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"); };
+  hostClockUs = 1000000;
+  initializeProgramCache(PROGRAM_CACHE_DEFAULT_KB);
+  initializeWebServer();
+
+  size_t baseLive = 0, basePeak = 0;
+  uint64_t baseAllocations = 0, firstWindow = 0;
+  bool flat = true;
+  printf("%10s %12s %8s %12s %12s\n", "requests", "allocations", "per req", "live bytes", "peak bytes");
+
+  for (uint32_t i = 0; i < requests; i++) {
+    hostClockUs += 20000;
+    runRequest(i);
+
+    if (i + 1 == warmup) {
+      baseLive = heapLive;
+      basePeak = heapPeak;
+      baseAllocations = heapAllocations;
+    } else if (i + 1 > warmup && (i + 1 - warmup) % window == 0) {
+      uint64_t allocations = heapAllocations - baseAllocations;
+      baseAllocations = heapAllocations;
+      if (!firstWindow) firstWindow = allocations;
+      printf("%10u %12llu %8.2f %12zu %12zu\n", i + 1, (unsigned long long)allocations, (double)allocations / window,
+        heapLive, heapPeak);
+      flat = flat && allocations == firstWindow && heapLive == baseLive && heapPeak == basePeak;
+    }
+  }
+
+  printf("after %u warm-up requests: live %zu bytes, peak %zu bytes\n", warmup, baseLive, basePeak);
+  printf("heap %s\n", flat ? "flat" : "NOT flat: allocations, live or peak bytes changed after warm-up");
+  return flat ? 0 : 1;
+}
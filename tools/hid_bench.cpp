@@ -0,0 +1,243 @@
+// Host benchmark for the typing path. Compiles representative inputs the way
+// /send does, queues each one as a job and plays it through
+// serviceKeystrokeQueue() and executeHidReport() against the mock USB device
+// in tools/host/, which collects one report per 1 ms poll on a virtual clock:
+//
+//   g++ -std=gnu++17 -O2 -I tools/host -I path/to/tinyusb/src tools/hid_bench.cpp -o hid_bench
+//   ./hid_bench
+//
+// For each input it prints compile throughput (host time, so compare runs with
+// each other, not with the device), heap allocations per sequence once buffers
+// have grown, USB reports per character, and the virtual time from queueing
+// to the last report against estimateKeystrokeProgramMs(). Reports,
+// allocations and virtual time are exact, so they are checked against the
+// limits below; a run over any limit sets the exit status to 1. Lower a limit
+// when a change improves on it.
+//
+// It then times key name lookups with findNamedKey() against the
+// std::map<String, ...> tables the names used to live in, over the same
+// tokens. The two must find the same keys, and findNamedKey() must not
+// allocate; the times are printed for comparison only.
+#include <malloc.h>
+#include <chrono>
+#include <map>
+#include <new>
+#include <string>
+#include "../keystroke_queue.h"
+
+static uint64_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+  void* block = malloc(size ? size : 1);
+  if (!block) throw std::bad_alloc();
+  heapAllocations++;
+  return block;
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+// One benchmark input and the figures it must not exceed
+typedef struct {
+  const char* name;
+  std::string text;
+  uint8_t layout;
+  uint32_t maxReports;      // USB reports sent for the whole job
+  uint32_t maxAllocations;  // Per sequence, compile to last report, warm buffers
+  uint32_t maxVirtualMs;
+} BenchInput;
+
+// About 8 KB of prose, the size of a pasted config file
+static std::string buildPaste() {
+  static const char* const WORDS[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "server", "restart", "config", "value",
+    "Lorem", "ipsum", "dolor", "sit", "amet,", "consectetur", "adipiscing", "elit.", "0x1F", "42", "(x)", "a=b;",
+  };
+  std::string text;
+  for (uint32_t i = 0; text.size() < 8192; i++) {
+    text += WORDS[(i * 7 + i / 5) % (sizeof(WORDS) / sizeof(WORDS[0]))];
+    text += ' ';
+  }
+  return text;
+}
+
+// Plays one job to its last report; returns the virtual microseconds it took
+static uint64_t playJob(KeystrokeProgram& program) {
+  uint64_t startUs = hostClockUs;
+  uint32_t id = enqueueKeystrokeJob(program);
+  const KeystrokeJob* job = findKeystrokeJob(id);
+  while (job->state != JOB_DONE) {
+    serviceKeystrokeQueue();
+    serviceHidPlayback();
+  }
+  return hostClockUs - startUs;
+}
+
+// Key name tables as they were before the flash tables, filled from those
+static std::map<String, uint8_t> mapModifiers;
+static std::map<String, HidKey> mapSpecials;
+
+// The old lookup: copy the token to terminate it, then find it by String
+template <typename V>
+static const V* findMappedKey(const std::map<String, V>& map, const char* name, size_t length) {
+  char keyName[16];
+  if (length >= sizeof(keyName)) return nullptr;
+  memcpy(keyName, name, length);
+  keyName[length] = '\0';
+  auto it = map.find(keyName);
+  return it == map.end() ? nullptr : &it->second;
+}
+
+// Every modifier and key name, some lowercase or cut short, and words that are no key
+static std::vector<std::string> buildLookupTokens() {
+  std::vector<std::string> tokens;
+  for (const NamedModifier& entry : MODIFIER_KEYS) tokens.push_back(entry.name);
+  for (const NamedKey& entry : SPECIAL_KEYS) tokens.push_back(entry.name);
+  for (size_t i = 0; i < tokens.size(); i += 7) {
+    std::string lower = tokens[i];
+    for (char& c : lower) c = tolower(c);
+    tokens.push_back(lower);
+    tokens.push_back(tokens[i].substr(0, tokens[i].size() - 1));
+  }
+  for (const char* word : {"hello", "world", "ENTERPRISE", "x", "CTRLALT", "PAGEDOWNUP", "Tr0ub4dor"}) {
+    tokens.push_back(word);
+  }
+  return tokens;
+}
+
+// Where lookup results go, so the timed loops are not optimised out
+static volatile uint32_t lookupsFound = 0;
+
+// Nanoseconds per token looked up in both tables, best of a few runs
+template <typename Lookup>
+static double lookupNsPerToken(const std::vector<std::string>& tokens, Lookup lookup) {
+  double best = 0;
+  for (int run = 0; run < 5; run++) {
+    uint32_t found = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; i++) {
+      for (const std::string& token : tokens) found += lookup(token.data(), token.size());
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    ns /= 2000.0 * tokens.size();
+    lookupsFound = found;
+    if (run == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+static bool benchKeyLookups() {
+  for (const NamedModifier& entry : MODIFIER_KEYS) mapModifiers[entry.name] = entry.modifier;
+  for (const NamedKey& entry : SPECIAL_KEYS) mapSpecials[entry.name] = entry.key;
+  std::vector<std::string> tokens = buildLookupTokens();
+
+  uint32_t mismatches = 0;
+  for (const std::string& token : tokens) {
+    const uint8_t* mappedModifier = findMappedKey(mapModifiers, token.data(), token.size());
+    const NamedModifier* modifier = findNamedKey(MODIFIER_KEYS, MODIFIER_KEY_INDEX, token.data(), token.size());
+    const HidKey* mappedKey = findMappedKey(mapSpecials, token.data(), token.size());
+    const NamedKey* key = findNamedKey(SPECIAL_KEYS, SPECIAL_KEY_INDEX, token.data(), token.size());
+    if (!mappedModifier != !modifier || (modifier && modifier->modifier != *mappedModifier) ||
+        !mappedKey != !key || (key && memcmp(&key->key, mappedKey, sizeof(HidKey)) != 0)) {
+      fprintf(stderr, "key lookup: '%s' found differently\n", token.c_str());
+      mismatches++;
+    }
+  }
+
+  double mapNs = lookupNsPerToken(tokens, [](const char* name, size_t length) {
+    return (findMappedKey(mapModifiers, name, length) != nullptr) + (findMappedKey(mapSpecials, name, length) != nullptr);
+  });
+  uint64_t allocationsBefore = heapAllocations;
+  double indexNs = lookupNsPerToken(tokens, [](const char* name, size_t length) {
+    return (findNamedKey(MODIFIER_KEYS, MODIFIER_KEY_INDEX, name, length) != nullptr) +
+           (findNamedKey(SPECIAL_KEYS, SPECIAL_KEY_INDEX, name, length) != nullptr);
+  });
+  uint64_t allocations = heapAllocations - allocationsBefore;
+
+  printf("\n%-14s %7s %10s %8s\n", "key lookup", "tokens", "ns/token", "allocs");
+  printf("%-14s %7zu %10.1f %8s\n", "std::map", tokens.size(), mapNs, "-");
+  printf("%-14s %7zu %10.1f %8llu%s\n", "findNamedKey", tokens.size(), indexNs, (unsigned long long)allocations,
+    allocations ? "  OVER LIMIT" : "");
+  return mismatches == 0 && allocations == 0;
+}
+
+static void compileInput(const BenchInput& input, KeystrokeProgram& program) {
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  options.layout = input.layout;
+  appendTypingRate(program, TYPING_RATE_NORMAL_US);
+  compileKeystrokeSequence(input.text.data(), input.text.size(), program, options);
+}
+
+// Nanoseconds per input character to compile, best of a few runs
+static double compileNsPerChar(const BenchInput& input, KeystrokeProgram& program) {
+  double best = 0;
+  for (int run = 0; run < 5; run++) {
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < 200; i++) {
+      compileInput(input, program);
+      recycleKeystrokeProgram(program);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    ns /= 200.0 * input.text.size();
+    if (run == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+int main() {
+  BenchInput inputs[] = {
+    {"password", "Tr0ub4dor&3-correct#HORSE!batteryStaple ENTER", LAYOUT_US, 50, 0, 101},
+    {"chords", "CTRL+ALT+T WIN+R CTRL+SHIFT+ESC ALT+F4 CTRL+C CTRL+V GUI+L CTRL+A+B+C+D+E+F+G", LAYOUT_US, 16, 0, 33},
+    {"menu", "DOWN DOWN DOWN ENTER TAB TAB F2 ESC", LAYOUT_US, 12, 0, 25},
+    {"shell (uk)", "echo \"#tag\" @host ~/.ssh | grep '\\\\' > out.txt ENTER", LAYOUT_UK, 62, 0, 125},
+    {"umlaut (de)", "Zeile ^2 yz YZ @home {x} ENTER", LAYOUT_DE, 36, 0, 73},
+    {"media", "VOLUP VOLUP MUTE PLAYPAUSE", LAYOUT_US, 8, 0, 17},
+    {"paste", buildPaste(), LAYOUT_US, 8493, 1, 16995},
+  };
+
+  hostClockUs = 1000000;
+  hostSpinUs = 1;
+  hostClockHook = completeHostHidReports;
+  initializeKeyboard();
+
+  bool passed = true;
+  KeystrokeProgram& program = requestReports;
+  printf("%-12s %7s %10s %8s %8s %11s %11s %10s\n", "input", "chars", "Mchars/s", "allocs", "reports", "reports/ch",
+    "virtual ms", "estimate");
+
+  for (const BenchInput& input : inputs) {
+    double ns = compileNsPerChar(input, program);
+
+    // Once through every job slot to grow the buffers, then the measured run
+    for (int i = 0; i < KEYSTROKE_QUEUE_SIZE; i++) {
+      compileInput(input, program);
+      playJob(program);
+    }
+
+    uint32_t sentBefore = hostHidReportsSent;
+    uint64_t allocationsBefore = heapAllocations;
+    compileInput(input, program);
+    uint32_t estimateMs = estimateKeystrokeProgramMs(program, TYPING_RATE_NORMAL_US);
+    uint64_t virtualUs = playJob(program);
+    recycleKeystrokeProgram(program);
+    uint64_t allocations = heapAllocations - allocationsBefore;
+    uint32_t reports = hostHidReportsSent - sentBefore;
+    uint32_t virtualMs = (virtualUs + 999) / 1000;
+
+    bool withinLimits = reports <= input.maxReports && allocations <= input.maxAllocations &&
+                        virtualMs <= input.maxVirtualMs;
+    printf("%-12s %7zu %10.1f %8llu %8u %11.2f %11u %10u%s\n", input.name, input.text.size(), 1000.0 / ns,
+      (unsigned long long)allocations, reports, (double)reports / input.text.size(), virtualMs, estimateMs,
+      withinLimits ? "" : "  OVER LIMIT");
+    if (!withinLimits) {
+      fprintf(stderr, "%s: %u reports (limit %u), %llu allocations (limit %u), %u virtual ms (limit %u)\n",
+        input.name, reports, input.maxReports, (unsigned long long)allocations, input.maxAllocations,
+        virtualMs, input.maxVirtualMs);
+    }
+    passed = passed && withinLimits;
+  }
+  passed = benchKeyLookups() && passed;
+
+  printf("\n%s\n", passed ? "within limits" : "OVER LIMITS");
+  return passed ? 0 : 1;
+}
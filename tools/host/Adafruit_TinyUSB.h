@@ -0,0 +1,94 @@
+#ifndef HOST_ADAFRUIT_TINYUSB_H
+#define HOST_ADAFRUIT_TINYUSB_H
+
+// USB device stand-in. Key codes and descriptor items come from TinyUSB's
+// class/hid/hid.h. Reports are counted and, while hostHidRecording is set,
+// kept with the virtual time they were sent. Like the real endpoint, one
+// report is in flight at a time: the host collects it at the next poll and
+// tud_hid_report_complete_cb() runs once the clock gets there, so a harness
+// that sets hostClockHook = completeHostHidReports sees completion pacing as
+// on the device.
+#include <Arduino.h>
+#include <vector>
+#include "class/hid/hid.h"
+
+// The descriptor never leaves the host, so the device templates only need to compile
+#ifndef TUD_HID_REPORT_DESC_KEYBOARD
+#define TUD_HID_REPORT_DESC_KEYBOARD(...) __VA_ARGS__ HID_COLLECTION_END
+#endif
+#ifndef TUD_HID_REPORT_DESC_CONSUMER
+#define TUD_HID_REPORT_DESC_CONSUMER(...) __VA_ARGS__ HID_COLLECTION_END
+#endif
+
+// Largest report the device sends (the NKRO bitmap)
+#define HOST_HID_REPORT_SIZE 32
+
+// One report as the host received it
+typedef struct {
+  uint64_t sentUs;
+  uint8_t reportId;
+  uint8_t length;
+  uint8_t data[HOST_HID_REPORT_SIZE];
+} HostHidReport;
+
+inline uint8_t hostHidProtocol = HID_PROTOCOL_REPORT;
+inline uint32_t hostHidReportsSent = 0;
+inline bool hostHidRecording = false;
+inline std::vector<HostHidReport> hostHidReports;
+
+// Transfer waiting for the host's next poll
+inline bool hostHidBusy = false;
+inline uint64_t hostHidCollectUs = 0;
+inline uint32_t hostHidPollUs = 1000;
+
+extern "C" inline uint8_t tud_hid_get_protocol(void) { return hostHidProtocol; }
+extern "C" void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len);
+
+// Clock hook: the host collects the pending report once its poll comes round
+inline void completeHostHidReports() {
+  if (hostHidBusy && hostClockUs >= hostHidCollectUs) {
+    hostHidBusy = false;
+    tud_hid_report_complete_cb(0, nullptr, 0);
+  }
+}
+
+class Adafruit_USBD_HID {
+ public:
+  void setBootProtocol(uint8_t) {}
+  void setPollInterval(uint8_t ms) { hostHidPollUs = (ms ? ms : 1) * 1000; }
+  void setReportDescriptor(uint8_t const*, uint16_t) {}
+  void setStringDescriptor(const char*) {}
+  bool begin() { return true; }
+  bool ready() { return !hostHidBusy; }
+
+  bool sendReport(uint8_t reportId, void const* data, uint8_t length) {
+    if (hostHidBusy) {
+      return false;
+    }
+    hostHidReportsSent++;
+    if (hostHidRecording) {
+      HostHidReport report = {hostClockUs, reportId, length, {0}};
+      memcpy(report.data, data, length < HOST_HID_REPORT_SIZE ? length : HOST_HID_REPORT_SIZE);
+      hostHidReports.push_back(report);
+    }
+    if (hostClockHook) {
+      hostHidBusy = true;
+      hostHidCollectUs = (hostClockUs / hostHidPollUs + 1) * hostHidPollUs;
+    }
+    return true;
+  }
+};
+
+class Adafruit_USBD_Device {
+ public:
+  bool isInitialized() { return true; }
+  bool begin(int) { return true; }
+  bool mounted() { return true; }
+  bool detach() { return true; }
+  bool attach() { return true; }
+  void task() {}
+};
+
+inline Adafruit_USBD_Device TinyUSBDevice;
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino-Pico core to build the sketch headers on a Linux
+// host (see tools/auth_load.cpp). Time is virtual: it only moves when the
+// harness advances hostClockUs, so hours of traffic replay in seconds.
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+#define PROGMEM
+#define F(x) x
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+
+inline uint64_t hostClockUs = 0;
+inline bool hostSerialEnabled = false;  // Device log lines go to stderr when set
+
+// Harnesses that run the HID playback loop set hostSpinUs so busy waits on
+// micros() move the clock, and hostClockHook to complete USB transfers as
+// virtual time passes (see Adafruit_TinyUSB.h)
+inline uint32_t hostSpinUs = 0;
+inline void (*hostClockHook)() = nullptr;
+
+// Runs in yield(), for harnesses that stand in for core1 while core0 waits on it
+inline void (*hostYieldHook)() = nullptr;
+
+inline void advanceHostClock(uint64_t us) {
+  hostClockUs += us;
+  if (hostClockHook) hostClockHook();
+}
+
+inline unsigned long millis() { return (unsigned long)(hostClockUs / 1000); }
+inline unsigned long micros() {
+  if (hostSpinUs) advanceHostClock(hostSpinUs);
+  return (unsigned long)hostClockUs;
+}
+inline void delay(unsigned long ms) { advanceHostClock(ms * 1000ULL); }
+inline void delayMicroseconds(unsigned int us) { advanceHostClock(us); }
+inline void yield() {
+  if (hostYieldHook) hostYieldHook();
+}
+
+class String {
+ public:
+  String() {}
+  String(const char* text) : value(text ? text : "") {}
+  String(const char* text, size_t length) : value(text, length) {}
+  String(int number) : value(std::to_string(number)) {}
+  String(unsigned int number) : value(std::to_string(number)) {}
+  String(long number) : value(std::to_string(number)) {}
+  String(unsigned long number) : value(std::to_string(number)) {}
+
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+  bool reserve(unsigned int size) { value.reserve(size); return true; }
+  bool startsWith(const char* prefix) const { return value.rfind(prefix, 0) == 0; }
+  bool operator==(const char* text) const { return value == text; }
+  bool operator<(const String& other) const { return value < other.value; }
+  String& operator+=(const String& other) { value += other.value; return *this; }
+  friend String operator+(String a, const String& b) { return a += b; }
+
+ private:
+  std::string value;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t byte) { return write(&byte, 1); }
+  virtual size_t write(const uint8_t* data, size_t length) = 0;
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t println(const char* text = "") { return print(text) + write("\n"); }
+  size_t println(const String& text) { return println(text.c_str()); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return write((const uint8_t*)text, length < (int)sizeof(text) ? length : sizeof(text) - 1);
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  void setTimeout(unsigned long) {}
+  size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    for (int c; count < length && (c = read()) >= 0; count++) buffer[count] = c;
+    return count;
+  }
+  size_t readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t count = 0;
+    for (int c; count < length && (c = read()) >= 0 && c != terminator; count++) buffer[count] = c;
+    return count;
+  }
+};
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  using Print::write;
+  size_t write(const uint8_t* data, size_t length) override {
+    return hostSerialEnabled ? fwrite(data, 1, length, stderr) : length;
+  }
+};
+
+inline HardwareSerial Serial;
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+  uint8_t operator[](int index) const { return bytes[index]; }
+  uint8_t& operator[](int index) { return bytes[index]; }
+
+ private:
+  uint8_t bytes[4] = {0, 0, 0, 0};
+};
+
+class RP2040 {
+ public:
+  uint32_t hwrand32() { return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+  int getFreeHeap() { return 0; }
+  int getTotalHeap() { return 0; }
+  void restart() {}
+};
+
+inline RP2040 rp2040;
+
+#endif
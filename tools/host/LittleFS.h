@@ -0,0 +1,106 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+// An empty, read-only filesystem where every open fails, unless a harness
+// sets hostFilesEnabled; then files are kept in memory in hostFiles. Open
+// files share their contents, so a file removed or renamed while open keeps
+// what it held, as on LittleFS.
+#include <Arduino.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+
+inline bool hostFilesEnabled = false;
+inline std::map<std::string, std::shared_ptr<std::string>> hostFiles;
+
+class File : public Stream {
+ public:
+  File() {}
+  File(std::shared_ptr<std::string> contents, size_t position) : data(contents), pos(position) {}
+
+  explicit operator bool() const { return data != nullptr; }
+  void close() { data.reset(); pos = 0; }
+  size_t size() const { return data ? data->size() : 0; }
+  bool seek(uint32_t position) {
+    if (!data || position > data->size()) return false;
+    pos = position;
+    return true;
+  }
+  int available() override { return data ? (int)(data->size() - pos) : 0; }
+  int read() override { return data && pos < data->size() ? (uint8_t)(*data)[pos++] : -1; }
+  size_t read(uint8_t* buffer, size_t length) {
+    size_t count = data && pos < data->size() ? std::min(length, data->size() - pos) : 0;
+    if (count) memcpy(buffer, data->data() + pos, count);
+    pos += count;
+    return count;
+  }
+  using Print::write;
+  size_t write(const uint8_t* buffer, size_t length) override {
+    if (!data) return 0;
+    if (data->size() < pos + length) data->resize(pos + length);
+    memcpy(&(*data)[pos], buffer, length);
+    pos += length;
+    return length;
+  }
+  void flush() {}
+
+ private:
+  std::shared_ptr<std::string> data;
+  size_t pos = 0;
+};
+
+class Dir {
+ public:
+  Dir() {}
+  explicit Dir(const std::string& path) : prefix(path + "/"), listing(true) {}
+  bool next() {
+    if (!listing) return false;
+    auto entry = current.empty() ? hostFiles.lower_bound(prefix) : hostFiles.upper_bound(current);
+    if (entry == hostFiles.end() || entry->first.compare(0, prefix.size(), prefix) != 0) {
+      listing = false;
+      return false;
+    }
+    current = entry->first;
+    return true;
+  }
+  String fileName() { return String(current.c_str() + prefix.size()); }
+  size_t fileSize() { return hostFiles.count(current) ? hostFiles[current]->size() : 0; }
+
+ private:
+  std::string prefix;
+  std::string current;
+  bool listing = false;
+};
+
+class FS {
+ public:
+  bool begin() { return true; }
+  File open(const char* path, const char* mode) {
+    if (!hostFilesEnabled) return File();
+    auto found = hostFiles.find(path);
+    if (mode[0] == 'r') {
+      return found == hostFiles.end() ? File() : File(found->second, 0);
+    }
+    if (mode[0] == 'w' || found == hostFiles.end()) {
+      hostFiles[path] = std::make_shared<std::string>();
+    }
+    std::shared_ptr<std::string> contents = hostFiles[path];
+    return File(contents, mode[0] == 'a' ? contents->size() : 0);
+  }
+  bool exists(const char* path) { return hostFiles.count(path) != 0; }
+  bool remove(const char* path) { return hostFiles.erase(path) != 0; }
+  bool rename(const char* from, const char* to) {
+    auto found = hostFiles.find(from);
+    if (found == hostFiles.end()) return false;
+    std::shared_ptr<std::string> contents = found->second;
+    hostFiles.erase(found);
+    hostFiles[to] = contents;
+    return true;
+  }
+  bool mkdir(const char*) { return hostFilesEnabled; }
+  Dir openDir(const char* path) { return hostFilesEnabled ? Dir(path) : Dir(); }
+};
+
+inline FS LittleFS;
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef HOST_MD5_BUILDER_H
+#define HOST_MD5_BUILDER_H
+
+// MD5Builder over OpenSSL (link with -lcrypto)
+#include <Arduino.h>
+#include <openssl/evp.h>
+
+class MD5Builder {
+ public:
+  MD5Builder() : context(EVP_MD_CTX_new()) {}
+  ~MD5Builder() { EVP_MD_CTX_free(context); }
+  MD5Builder(const MD5Builder&) = delete;
+  MD5Builder& operator=(const MD5Builder&) = delete;
+
+  void begin() { EVP_DigestInit_ex(context, EVP_md5(), nullptr); }
+  void add(const char* text) { EVP_DigestUpdate(context, text, strlen(text)); }
+  void calculate() { EVP_DigestFinal_ex(context, digest, nullptr); }
+  void getChars(char* out) {
+    for (int i = 0; i < 16; i++) snprintf(out + i * 2, 3, "%02x", digest[i]);
+  }
+
+ private:
+  EVP_MD_CTX* context;
+  uint8_t digest[16];
+};
+
+#endif
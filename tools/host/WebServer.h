@@ -0,0 +1,166 @@
+#ifndef HOST_WEB_SERVER_H
+#define HOST_WEB_SERVER_H
+
+// In-process WebServer: the harness fills in a HostRequest, serve() runs the
+// registered handler, and the response status, headers and body are kept for
+// inspection (flash content only by length). Request bodies are passed as
+// the "plain" argument; routes with a raw handler get the body through it
+// instead, in HTTP_RAW_BUFLEN blocks between RAW_START and RAW_END, before
+// the route's handler runs.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <uri/UriBraces.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+#define HTTP_RAW_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+typedef struct {
+  HTTPRawStatus status;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_RAW_BUFLEN];
+} HTTPRaw;
+
+typedef struct {
+  HTTPMethod method;
+  std::string uri;
+  IPAddress clientIP;
+  std::map<std::string, std::string> headers;
+  std::map<std::string, std::string> args;
+} HostRequest;
+
+class WebServer {
+ public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  WebServer(int) {}
+  void begin() {}
+  void handleClient() {}
+  void collectHeaders(const char**, size_t) {}
+
+  void on(const Uri& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void on(const Uri& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction rawHandler = nullptr) {
+    routes.push_back({uri.pattern, method, handler, rawHandler});
+  }
+  void onNotFound(THandlerFunction handler) { notFound = handler; }
+
+  // Runs one request and returns the response status
+  int serve(const HostRequest& request) {
+    current = &request;
+    requestClient.hostRemoteIP = request.clientIP;
+    responseCode = 0;
+    responseHeaders.clear();
+    responseLength = 0;
+    responseBody.clear();
+    pending.clear();
+    for (const Route& route : routes) {
+      if ((route.method == HTTP_ANY || route.method == request.method) && matches(route.pattern, request.uri)) {
+        if (route.rawHandler) streamBody(route.rawHandler);
+        route.handler();
+        return responseCode;
+      }
+    }
+    if (notFound) notFound();
+    return responseCode;
+  }
+
+  int responseCode = 0;
+  size_t responseLength = 0;
+  std::string responseBody;
+  std::map<std::string, std::string> responseHeaders;
+
+  HTTPMethod method() { return current->method; }
+  String uri() { return String(current->uri.c_str()); }
+  WiFiClient& client() { return requestClient; }
+  HTTPRaw& raw() { return rawBody; }
+  String arg(const String& name) { return lookup(current->args, name); }
+  bool hasArg(const String& name) { return current->args.count(name.c_str()) != 0; }
+  String header(const String& name) { return lookup(current->headers, name); }
+  bool hasHeader(const String& name) { return current->headers.count(name.c_str()) != 0; }
+  String pathArg(unsigned int index) { return index < pathArgs.size() ? String(pathArgs[index].c_str()) : String(); }
+
+  void sendHeader(const String& name, const String& value, bool = false) { pending[name.c_str()] = value.c_str(); }
+  void setContentLength(size_t) {}
+  void send(int code, const char* = nullptr, const String& content = String()) { respond(code, content.c_str()); }
+  void send(int code, const char*, const char* content) { respond(code, content ? content : ""); }
+  void send(int code, const String&, const String& content) { respond(code, content.c_str()); }
+  void send_P(int code, const char*, const char*, size_t length) { respond(code, ""); responseLength = length; }
+  void sendContent(const char* content, size_t length) { responseLength += length; (void)content; }
+  void sendContent(const char* content) { responseLength += strlen(content); }
+  void sendContent(const String& content) { responseLength += content.length(); }
+
+ private:
+  typedef struct {
+    std::string pattern;
+    HTTPMethod method;
+    THandlerFunction handler;
+    THandlerFunction rawHandler;
+  } Route;
+
+  std::vector<Route> routes;
+  THandlerFunction notFound;
+  const HostRequest* current = nullptr;
+  std::vector<std::string> pathArgs;
+  std::map<std::string, std::string> pending;
+  WiFiClient requestClient;
+  HTTPRaw rawBody;
+
+  static String lookup(const std::map<std::string, std::string>& values, const String& name) {
+    auto found = values.find(name.c_str());
+    return found == values.end() ? String() : String(found->second.c_str());
+  }
+
+  void streamBody(const THandlerFunction& rawHandler) {
+    auto found = current->args.find("plain");
+    const std::string body = found == current->args.end() ? std::string() : found->second;
+    rawBody.totalSize = 0;
+    rawBody.currentSize = 0;
+    rawBody.status = RAW_START;
+    rawHandler();
+    for (size_t pos = 0; pos < body.size(); pos += HTTP_RAW_BUFLEN) {
+      rawBody.currentSize = std::min(body.size() - pos, (size_t)HTTP_RAW_BUFLEN);
+      memcpy(rawBody.buf, body.data() + pos, rawBody.currentSize);
+      rawBody.totalSize += rawBody.currentSize;
+      rawBody.status = RAW_WRITE;
+      rawHandler();
+    }
+    rawBody.currentSize = 0;
+    rawBody.status = RAW_END;
+    rawHandler();
+  }
+
+  void respond(int code, const char* content) {
+    responseCode = code;
+    responseHeaders = pending;
+    responseBody = content;
+    responseLength = responseBody.size();
+  }
+
+  // Literal segments must be equal; "{}" takes any one segment
+  bool matches(const std::string& pattern, const std::string& uri) {
+    pathArgs.clear();
+    size_t p = 0, u = 0;
+    while (p < pattern.size() && u < uri.size()) {
+      if (pattern.compare(p, 2, "{}") == 0) {
+        size_t end = uri.find('/', u);
+        if (end == std::string::npos) end = uri.size();
+        if (end == u) return false;
+        pathArgs.push_back(uri.substr(u, end - u));
+        p += 2;
+        u = end;
+      } else if (pattern[p++] != uri[u++]) {
+        return false;
+      }
+    }
+    return p == pattern.size() && u == uri.size();
+  }
+};
+
+#endif
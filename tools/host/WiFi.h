@@ -0,0 +1,109 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Always connected. A client's writes are collected and handed to
+// WiFiClient::hostResponder, whose reply is then read back, so outgoing
+// requests such as Slack posts can be counted without a network. Incoming
+// connections are HostSockets a harness adds to a WiFiServer's hostPending:
+// the device reads toDevice and writes to fromDevice, and either side closes
+// the connection by clearing open.
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <memory>
+
+enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6 };
+enum { WIFI_STA = 1 };
+
+typedef struct {
+  std::string toDevice;
+  size_t readPos;
+  std::string fromDevice;
+  bool open;
+} HostSocket;
+
+class WiFiClient : public Stream {
+ public:
+  static inline std::function<std::string(const std::string& request)> hostResponder;
+  IPAddress hostRemoteIP;
+  std::shared_ptr<HostSocket> hostSocket;  // Set for connections accepted from a WiFiServer
+
+  WiFiClient() {}
+  WiFiClient(std::shared_ptr<HostSocket> socket, IPAddress remoteIP) : hostRemoteIP(remoteIP), hostSocket(socket) {}
+
+  int connect(const char*, uint16_t) { open = hostResponder != nullptr; return open; }
+  uint8_t connected() { return hostSocket ? hostSocket->open : open; }
+  explicit operator bool() { return connected(); }
+  void stop() {
+    if (hostSocket) hostSocket->open = false;
+    hostSocket.reset();
+    open = false;
+    sent.clear();
+    received.clear();
+  }
+  void setNoDelay(bool) {}
+  IPAddress remoteIP() { return hostRemoteIP; }
+
+  using Print::write;
+  size_t write(const uint8_t* data, size_t length) override {
+    if (hostSocket) {
+      if (!hostSocket->open) return 0;
+      hostSocket->fromDevice.append((const char*)data, length);
+      return length;
+    }
+    sent.append((const char*)data, length);
+    return length;
+  }
+  int available() override {
+    if (hostSocket) {
+      return hostSocket->toDevice.size() - hostSocket->readPos;
+    }
+    if (readPos == received.size() && !sent.empty() && hostResponder) {
+      received = hostResponder(sent);
+      readPos = 0;
+      sent.clear();
+    }
+    return received.size() - readPos;
+  }
+  using Stream::read;
+  int read() override {
+    if (hostSocket) return available() ? (uint8_t)hostSocket->toDevice[hostSocket->readPos++] : -1;
+    return available() ? (uint8_t)received[readPos++] : -1;
+  }
+  int read(uint8_t* buffer, size_t length) { return readBytes(buffer, length); }
+
+ private:
+  bool open = false;
+  std::string sent;
+  std::string received;
+  size_t readPos = 0;
+};
+
+class WiFiServer {
+ public:
+  std::deque<WiFiClient> hostPending;  // Connections waiting for accept()
+
+  WiFiServer(uint16_t) {}
+  void begin() {}
+  void setNoDelay(bool) {}
+  WiFiClient accept() {
+    if (hostPending.empty()) return WiFiClient();
+    WiFiClient client = hostPending.front();
+    hostPending.pop_front();
+    return client;
+  }
+};
+
+class WiFiClass {
+ public:
+  void mode(int) {}
+  int beginNoBlock(const char*, const char*) { return WL_CONNECTED; }
+  int status() { return WL_CONNECTED; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  void disconnect() {}
+  void setHostname(const char*) {}
+};
+
+inline WiFiClass WiFi;
+
+#endif
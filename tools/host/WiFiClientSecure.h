@@ -0,0 +1,17 @@
+#ifndef HOST_WIFI_CLIENT_SECURE_H
+#define HOST_WIFI_CLIENT_SECURE_H
+
+// Plain client under the TLS name; certificates and sessions are ignored
+#include <WiFi.h>
+
+namespace BearSSL {
+class Session {};
+}
+
+class WiFiClientSecure : public WiFiClient {
+ public:
+  void setInsecure() {}
+  void setSession(BearSSL::Session*) {}
+};
+
+#endif
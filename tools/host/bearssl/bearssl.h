@@ -0,0 +1,47 @@
+#ifndef HOST_BEARSSL_H
+#define HOST_BEARSSL_H
+
+// The BearSSL hash and HMAC calls the sketch makes, over OpenSSL one-shot
+// functions (link with -lcrypto). Input is collected until the output is read.
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+
+#define br_sha1_SIZE   20
+#define br_sha256_SIZE 32
+
+typedef struct { int unused; } br_hash_class;
+inline const br_hash_class br_sha256_vtable = {0};
+
+typedef struct { std::string data; } br_sha1_context;
+typedef struct { std::string key; } br_hmac_key_context;
+typedef struct { std::string key, data; } br_hmac_context;
+
+inline void br_sha1_init(br_sha1_context* context) { context->data.clear(); }
+inline void br_sha1_update(br_sha1_context* context, const void* data, size_t length) {
+  context->data.append((const char*)data, length);
+}
+inline void br_sha1_out(const br_sha1_context* context, void* out) {
+  SHA1((const unsigned char*)context->data.data(), context->data.size(), (unsigned char*)out);
+}
+
+inline void br_hmac_key_init(br_hmac_key_context* context, const br_hash_class*, const void* key, size_t length) {
+  context->key.assign((const char*)key, length);
+}
+inline void br_hmac_init(br_hmac_context* context, const br_hmac_key_context* key, size_t) {
+  context->key = key->key;
+  context->data.clear();
+}
+inline void br_hmac_update(br_hmac_context* context, const void* data, size_t length) {
+  context->data.append((const char*)data, length);
+}
+inline size_t br_hmac_out(const br_hmac_context* context, void* out) {
+  unsigned int length = br_sha256_SIZE;
+  HMAC(EVP_sha256(), context->key.data(), context->key.size(), (const unsigned char*)context->data.data(),
+       context->data.size(), (unsigned char*)out, &length);
+  return length;
+}
+
+#endif
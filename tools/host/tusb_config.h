@@ -0,0 +1,9 @@
+#ifndef HOST_TUSB_CONFIG_H
+#define HOST_TUSB_CONFIG_H
+
+// TinyUSB's common headers include a tusb_config.h. The host builds only use
+// the HID constants from class/hid/hid.h, so this just names the target MCU.
+#define CFG_TUSB_MCU OPT_MCU_RP2040
+#define CFG_TUSB_OS  OPT_OS_NONE
+
+#endif
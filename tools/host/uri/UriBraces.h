@@ -0,0 +1,19 @@
+#ifndef HOST_URI_BRACES_H
+#define HOST_URI_BRACES_H
+
+// Route patterns; "{}" matches one path segment (see WebServer.h)
+#include <Arduino.h>
+
+class Uri {
+ public:
+  Uri(const char* uri) : pattern(uri) {}
+  virtual ~Uri() {}
+  std::string pattern;
+};
+
+class UriBraces : public Uri {
+ public:
+  UriBraces(const char* uri) : Uri(uri) {}
+};
+
+#endif
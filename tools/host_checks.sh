@@ -0,0 +1,48 @@
+#!/bin/sh
+# Builds the host tools and tests against the stand-ins in tools/host/ and
+# runs them; this is the CI gate. TINYUSB_SRC is TinyUSB's src directory (for
+# class/hid/hid.h), OUT where the binaries go:
+#
+#   TINYUSB_SRC=path/to/tinyusb/src tools/host_checks.sh
+#
+# Any warning, failed test or benchmark over its limits fails the run.
+set -eu
+cd "$(dirname "$0")/.."
+: "${TINYUSB_SRC:?set TINYUSB_SRC to TinyUSB's src directory}"
+OUT="${OUT:-$(mktemp -d)}"
+mkdir -p "$OUT"
+CXXFLAGS="-std=gnu++17 -O2 -Wall -Wextra -Werror -Wno-deprecated-declarations -I tools/host -isystem $TINYUSB_SRC"
+
+for source in tools/*.cpp tests/*.cpp; do
+  [ -e "$source" ] || continue
+  echo "build $source"
+  ${CXX:-g++} $CXXFLAGS "$source" -lcrypto -pthread -o "$OUT/$(basename "$source" .cpp)"
+done
+
+for test in "$OUT"/*_test; do
+  [ -e "$test" ] || continue
+  echo "run $(basename "$test")"
+  "$test"
+done
+
+echo "run macro_compiler"
+printf 'Hello World CTRL+ALT+T ENTER' > "$OUT/macro.txt"
+"$OUT/macro_compiler" --layout uk "$OUT/macro.txt" "$OUT/macro.hid"
+
+echo "run auth_load"
+"$OUT/auth_load" --seed 1
+echo "run heap_soak"
+"$OUT/heap_soak" --requests 300000
+echo "run cache_bench"
+"$OUT/cache_bench" --requests 50000
+echo "run hid_bench"
+"$OUT/hid_bench"
+
+# tools/live_latency.py against the live channel, served on local ports
+echo "run live_latency against live_loopback"
+rm -f "$OUT/live.port"
+"$OUT/live_loopback" --port-file "$OUT/live.port" &
+loopback=$!
+while [ ! -s "$OUT/live.port" ] && kill -0 "$loopback" 2>/dev/null; do sleep 0.1; done
+python3 tools/live_latency.py --user admin --password loopback --count 100 "127.0.0.1:$(cat "$OUT/live.port")"
+wait "$loopback"
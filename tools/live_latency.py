@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Measure live typing round trips against a device.
+
+    python3 tools/live_latency.py --user admin --password secret 192.168.1.50
+
+Fetches a token from /live/token, opens the live channel and sends F24
+down/up events (a key no host acts on), timing each until the device
+acknowledges that the report went out over USB.
+"""
+import argparse
+import base64
+import json
+import os
+import socket
+import statistics
+import struct
+import sys
+import time
+import urllib.request
+
+F24 = 0x73
+
+
+def fetch_token(host, user, password):
+    url = "http://%s/live/token" % host
+    passwords = urllib.request.HTTPPasswordMgrWithDefaultRealm()
+    passwords.add_password(None, url, user, password)
+    opener = urllib.request.build_opener(urllib.request.HTTPDigestAuthHandler(passwords))
+    with opener.open(url, timeout=5) as response:
+        return json.load(response)
+
+
+def read_exactly(sock, length):
+    data = b""
+    while len(data) < length:
+        chunk = sock.recv(length - len(data))
+        if not chunk:
+            raise ConnectionError("channel closed")
+        data += chunk
+    return data
+
+
+def open_channel(host, grant):
+    sock = socket.create_connection((host.split(":")[0], grant["port"]), timeout=5)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    key = base64.b64encode(os.urandom(16)).decode()
+    sock.sendall(("GET /?token=%s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n"
+                  % (grant["token"], host, key)).encode())
+    response = b""
+    while b"\r\n\r\n" not in response:
+        response += read_exactly(sock, 1)
+    if not response.startswith(b"HTTP/1.1 101"):
+        sys.exit("handshake refused: " + response.split(b"\r\n")[0].decode())
+    return sock
+
+
+def send_event(sock, op, usage, seq):
+    mask = os.urandom(4)
+    payload = struct.pack("<BBH", op, usage, seq)
+    masked = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+    sock.sendall(bytes([0x82, 0x80 | len(payload)]) + mask + masked)
+
+
+def read_ack(sock):
+    opcode, length = read_exactly(sock, 2)
+    payload = read_exactly(sock, length & 0x7F)
+    if opcode & 0x0F == 0x8:
+        raise ConnectionError("channel closed by device")
+    return struct.unpack("<HB", payload)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--user", required=True)
+    parser.add_argument("--password", required=True)
+    parser.add_argument("--count", type=int, default=200, help="key presses (two events each)")
+    args = parser.parse_args()
+
+    sock = open_channel(args.host, fetch_token(args.host, args.user, args.password))
+    rtts = []
+    busy = 0
+    for i in range(args.count * 2):
+        seq = i & 0xFFFF
+        started = time.perf_counter()
+        send_event(sock, 1 if i % 2 == 0 else 2, F24, seq)
+        acked, status = read_ack(sock)
+        while acked != seq:
+            acked, status = read_ack(sock)
+        if status == 0:
+            rtts.append((time.perf_counter() - started) * 1000)
+        else:
+            busy += 1
+    sock.close()
+
+    if not rtts:
+        sys.exit("no events acknowledged (%d busy)" % busy)
+    rtts.sort()
+    print("%d events: min %.2f ms, median %.2f ms, p95 %.2f ms, max %.2f ms%s" % (
+        len(rtts), rtts[0], statistics.median(rtts), rtts[min(len(rtts) - 1, int(len(rtts) * 0.95))],
+        rtts[-1], ", %d busy" % busy if busy else ""))
+
+
+if __name__ == "__main__":
+    main()
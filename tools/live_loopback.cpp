@@ -0,0 +1,214 @@
+// Loopback device for tools/live_latency.py. Builds the sketch's web server
+// and live channel against the fakes in tools/host/ and serves them on two
+// local TCP ports, so the script runs unchanged against the firmware's own
+// handshake, token and frame code:
+//
+//   g++ -std=gnu++17 -O2 -I tools/host -I path/to/tinyusb/src tools/live_loopback.cpp -lcrypto -o live_loopback
+//   ./live_loopback --port-file port.txt &
+//   python3 tools/live_latency.py --user admin --password loopback 127.0.0.1:$(cat port.txt)
+//
+// The web port reads one request per connection (no bodies) and closes it.
+// The "port" in /live/token's reply is rewritten to the local live channel
+// port, as a port forward would. Reports are played through executeHidReport()
+// against the mock USB device on the virtual clock. The tool exits once
+// --sessions live sessions have closed (status 0 if every one acknowledged an
+// event), or with status 1 after --timeout seconds.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include "../web_server_handler.h"
+
+static const char* USERNAME = "admin";
+static const char* PASSWORD = "loopback";
+
+static int listenLocal(uint16_t& port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (fd < 0 || bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 8) != 0 ||
+      getsockname(fd, (sockaddr*)&address, &length) != 0) {
+    perror("live_loopback: listen");
+    exit(2);
+  }
+  port = ntohs(address.sin_port);
+  return fd;
+}
+
+static HTTPMethod parseMethod(const std::string& name) {
+  if (name == "GET") return HTTP_GET;
+  if (name == "HEAD") return HTTP_HEAD;
+  if (name == "POST") return HTTP_POST;
+  if (name == "PUT") return HTTP_PUT;
+  if (name == "DELETE") return HTTP_DELETE;
+  return HTTP_OPTIONS;
+}
+
+// One request on the web port: read the head, serve it, reply and close
+static void serveHttp(int fd, uint16_t livePort) {
+  std::string head;
+  char buffer[1024];
+  pollfd wait = {fd, POLLIN, 0};
+  while (head.find("\r\n\r\n") == std::string::npos && head.size() < 8192 && poll(&wait, 1, 2000) > 0) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received <= 0) break;
+    head.append(buffer, received);
+  }
+  size_t lineEnd = head.find("\r\n");
+  size_t methodEnd = head.find(' ');
+  size_t uriEnd = head.find(' ', methodEnd + 1);
+  if (lineEnd == std::string::npos || methodEnd > lineEnd || uriEnd > lineEnd) {
+    close(fd);
+    return;
+  }
+
+  HostRequest request = {parseMethod(head.substr(0, methodEnd)), head.substr(methodEnd + 1, uriEnd - methodEnd - 1),
+    IPAddress(127, 0, 0, 1), {}, {}};
+  size_t query = request.uri.find('?');
+  if (query != std::string::npos) {
+    std::string args = request.uri.substr(query + 1);
+    request.uri.resize(query);
+    for (size_t start = 0; start < args.size();) {
+      size_t end = args.find('&', start);
+      if (end == std::string::npos) end = args.size();
+      size_t equals = args.find('=', start);
+      if (equals < end) request.args[args.substr(start, equals - start)] = args.substr(equals + 1, end - equals - 1);
+      start = end + 1;
+    }
+  }
+  for (size_t line = lineEnd + 2; line < head.size();) {
+    size_t end = head.find("\r\n", line);
+    size_t colon = head.find(':', line);
+    if (end == std::string::npos || end == line) break;
+    if (colon < end) {
+      size_t value = head.find_first_not_of(' ', colon + 1);
+      request.headers[head.substr(line, colon - line)] = head.substr(value, end - value);
+    }
+    line = end + 2;
+  }
+
+  int status = webServer.serve(request);
+  std::string body = webServer.responseBody;
+  if (request.uri == "/live/token" && status == 200) {
+    std::string advertised = "\"port\":" + std::to_string(LIVE_CHANNEL_PORT);
+    size_t at = body.find(advertised);
+    if (at != std::string::npos) body.replace(at, advertised.size(), "\"port\":" + std::to_string(livePort));
+  }
+
+  std::string reply = "HTTP/1.1 " + std::to_string(status) + (status < 300 ? " OK" : " Error") + "\r\n";
+  for (const auto& header : webServer.responseHeaders) reply += header.first + ": " + header.second + "\r\n";
+  reply += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+  send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+  close(fd);
+}
+
+int main(int argc, char** argv) {
+  const char* portFile = nullptr;
+  uint32_t sessions = 1;
+  uint32_t timeoutS = 60;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--port-file") == 0 && i + 1 < argc) {
+      portFile = argv[++i];
+    } else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+      sessions = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+      timeoutS = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--port-file PATH] [--sessions N] [--timeout SECONDS]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  snprintf(deviceConfig.username, sizeof(deviceConfig.username), "%s", USERNAME);
+  snprintf(deviceConfig.userpass, sizeof(deviceConfig.userpass), "%s", PASSWORD);
+  deviceConfig.typingRateUs = TYPING_RATE_NORMAL_US;
+  hostClockUs = 1000000;
+  hostSpinUs = 1;
+  hostClockHook = completeHostHidReports;
+  initializeKeyboard();
+  initializeWebServer();
+  initializeLiveChannel();
+
+  uint16_t webPort, livePort;
+  int webListener = listenLocal(webPort);
+  int liveListener = listenLocal(livePort);
+  printf("web port %u, live channel port %u\n", webPort, livePort);
+  fflush(stdout);
+  if (portFile) {
+    FILE* file = fopen(portFile, "w");
+    if (!file) {
+      perror("live_loopback: port file");
+      return 2;
+    }
+    fprintf(file, "%u\n", webPort);
+    fclose(file);
+  }
+
+  // The live connection and the socket the channel sees
+  int liveFd = -1;
+  std::shared_ptr<HostSocket> liveSocket;
+  uint32_t closedSessions = 0;
+  uint32_t silentSessions = 0;
+  uint32_t eventsBefore = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutS);
+
+  while (closedSessions < sessions) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      fprintf(stderr, "live_loopback: timed out after %u s\n", timeoutS);
+      return 1;
+    }
+
+    pollfd fds[3] = {{webListener, POLLIN, 0}, {liveListener, POLLIN, 0}, {liveFd, POLLIN, 0}};
+    poll(fds, liveFd >= 0 ? 3 : 2, 1);
+    if (fds[0].revents & POLLIN) {
+      int fd = accept(webListener, nullptr, nullptr);
+      if (fd >= 0) serveHttp(fd, livePort);
+    }
+    if ((fds[1].revents & POLLIN) && liveFd < 0) {
+      liveFd = accept(liveListener, nullptr, nullptr);
+      int noDelay = 1;
+      setsockopt(liveFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+      liveSocket = std::make_shared<HostSocket>(HostSocket{"", 0, "", true});
+      liveServer.hostPending.push_back(WiFiClient(liveSocket, IPAddress(127, 0, 0, 1)));
+      eventsBefore = liveEventsReceived;
+    }
+    if (liveFd >= 0 && (fds[2].revents & (POLLIN | POLLHUP))) {
+      char buffer[2048];
+      ssize_t received = recv(liveFd, buffer, sizeof(buffer), 0);
+      if (received > 0) {
+        liveSocket->toDevice.append(buffer, received);
+      } else {
+        liveSocket->open = false;
+      }
+    }
+
+    // What loop() and core1 run
+    advanceHostClock(100);
+    serviceLiveChannel();
+    serviceKeystrokeQueue();
+    while (!hidReportRing.empty()) serviceHidPlayback();
+    serviceLiveChannel();
+
+    if (liveFd >= 0 && !liveSocket->fromDevice.empty()) {
+      send(liveFd, liveSocket->fromDevice.data(), liveSocket->fromDevice.size(), MSG_NOSIGNAL);
+      liveSocket->fromDevice.clear();
+    }
+    if (liveFd >= 0 && !liveSocket->open) {
+      close(liveFd);
+      liveFd = -1;
+      closedSessions++;
+      uint32_t events = liveEventsReceived - eventsBefore;
+      printf("live session closed after %u events\n", events);
+      if (events == 0) silentSessions++;
+    }
+  }
+  return silentSessions == 0 ? 0 : 1;
+}
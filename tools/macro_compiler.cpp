@@ -0,0 +1,86 @@
+// Host-side macro compiler. Turns a keystroke sequence into a macro file that
+// the device stores as-is:
+//
+//   g++ -std=c++17 -I path/to/tinyusb/src tools/macro_compiler.cpp -o macro_compiler
+//   ./macro_compiler --layout uk --rate safe unlock.txt unlock.hid
+//   curl --digest -u user:pass -X PUT -H "Content-Type: application/octet-stream" --data-binary @unlock.hid http://[device-ip]/macro/unlock
+#include <stdio.h>
+#include "../macro_format.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Macro files are little-endian; build on a little-endian host"
+#endif
+
+static int usage(const char* program) {
+  fprintf(stderr, "usage: %s [--layout us|uk|de] [--rate fast|normal|safe|<us>] [--literal] [--no-coalesce] <input> <output.hid>\n", program);
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  uint16_t intervalUs = TYPING_RATE_NORMAL_US;
+  bool literal = false;
+  const char* inputPath = nullptr;
+  const char* outputPath = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+      options.layout = parseKeyboardLayout(argv[++i], LAYOUT_COUNT);
+      if (options.layout == LAYOUT_COUNT) return usage(argv[0]);
+    } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+      intervalUs = parseTypingRate(argv[++i], 0);
+      if (intervalUs == 0) return usage(argv[0]);
+    } else if (strcmp(argv[i], "--literal") == 0) {
+      literal = true;
+    } else if (strcmp(argv[i], "--no-coalesce") == 0) {
+      options.coalesceReleases = false;
+    } else if (!inputPath) {
+      inputPath = argv[i];
+    } else if (!outputPath) {
+      outputPath = argv[i];
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (!inputPath || !outputPath) {
+    return usage(argv[0]);
+  }
+
+  FILE* input = fopen(inputPath, "rb");
+  if (!input) {
+    perror(inputPath);
+    return 1;
+  }
+
+  KeystrokeProgram program;
+  KeystrokeStream stream;
+  beginKeystrokeStream(stream, program, options, literal);
+  char buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+    feedKeystrokeStream(stream, buffer, length);
+  }
+  endKeystrokeStream(stream);
+  fclose(input);
+
+  MacroBuilder builder;
+  beginMacro(builder, options.layout, intervalUs);
+  addMacroReports(builder, program.data(), program.size());
+  const MacroHeader& header = finishMacro(builder);
+
+  FILE* output = fopen(outputPath, "wb");
+  if (!output) {
+    perror(outputPath);
+    return 1;
+  }
+  bool written = fwrite(&header, sizeof(header), 1, output) == 1 &&
+                 fwrite(program.data(), sizeof(HidReport), program.size(), output) == program.size();
+  if (fclose(output) != 0 || !written) {
+    perror(outputPath);
+    return 1;
+  }
+
+  printf("%s: %lu reports, about %lu ms\n", outputPath,
+    (unsigned long)header.reportCount, (unsigned long)header.estimatedMs);
+  return 0;
+}
@@ -0,0 +1,180 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+// Generated by tools/embed_assets.py from web/ - do not edit
+#include <stddef.h>
+#include <stdint.h>
+
+// Gzipped static file with its strong ETag
+typedef struct {
+  const char* contentType;
+  const char* etag;
+  const uint8_t* data;
+  size_t length;
+} WebAsset;
+
+// web/index.html (647 bytes gzipped)
+const uint8_t INDEX_HTML_GZ[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7d, 0x54, 0x5d, 0x6f, 0xd3, 0x30,
+  0x14, 0x7d, 0xdf, 0xaf, 0xb8, 0x18, 0xf1, 0xb4, 0x75, 0xee, 0x56, 0x60, 0x52, 0x96, 0x54, 0x1a,
+  0x5d, 0x27, 0xa4, 0x4d, 0x6c, 0x5a, 0x8b, 0x10, 0x42, 0xa8, 0x72, 0x92, 0xdb, 0xc5, 0xaa, 0x63,
+  0x07, 0xdb, 0xe9, 0x07, 0x88, 0xff, 0xce, 0xcd, 0x47, 0xdb, 0x74, 0xc0, 0xfc, 0x90, 0xd8, 0xf1,
+  0x39, 0xc7, 0xf7, 0x9e, 0x7b, 0x9d, 0xf0, 0xd5, 0xf5, 0xfd, 0x68, 0xfa, 0xf5, 0x61, 0x0c, 0x99,
+  0xcf, 0xd5, 0xf0, 0x28, 0xdc, 0xbe, 0x50, 0xa4, 0xc3, 0x23, 0xa0, 0x11, 0x7a, 0xe9, 0x15, 0x0e,
+  0x3f, 0x4f, 0x3e, 0xc0, 0x2d, 0x6e, 0x62, 0x23, 0x6c, 0x0a, 0x23, 0xa3, 0xbd, 0x35, 0x4a, 0xa1,
+  0x0d, 0x79, 0xb3, 0xdd, 0x40, 0x73, 0xf4, 0x02, 0xb4, 0xc8, 0x31, 0x62, 0x4b, 0x89, 0xab, 0xc2,
+  0x58, 0xcf, 0x20, 0x21, 0x30, 0x6a, 0x1f, 0xb1, 0x95, 0x4c, 0x7d, 0x16, 0xa5, 0xb8, 0x94, 0x09,
+  0xf6, 0xea, 0xc5, 0x09, 0x48, 0x2d, 0xbd, 0x14, 0xaa, 0xe7, 0x12, 0xa1, 0x30, 0x3a, 0x63, 0xad,
+  0x90, 0xf3, 0x9b, 0xad, 0x68, 0x35, 0x62, 0x93, 0x6e, 0xe0, 0x17, 0xcc, 0x49, 0xa9, 0x37, 0x17,
+  0xb9, 0x54, 0x9b, 0x00, 0xae, 0x2c, 0xf1, 0x4e, 0xc0, 0x09, 0xed, 0x7a, 0x0e, 0xad, 0x9c, 0x5f,
+  0x42, 0x2e, 0xec, 0x93, 0xd4, 0x01, 0xbc, 0xed, 0x17, 0xeb, 0x4b, 0xf8, 0xbd, 0xa3, 0x9f, 0x56,
+  0x21, 0x08, 0xa9, 0xd1, 0x92, 0x48, 0x2e, 0xd6, 0xcd, 0xe1, 0x01, 0xbc, 0xef, 0xd7, 0xc0, 0x2d,
+  0xad, 0x0f, 0xa2, 0xf4, 0xa6, 0x4b, 0x94, 0xba, 0x28, 0xfd, 0x37, 0xbf, 0x29, 0x28, 0x21, 0x8f,
+  0x6b, 0xcf, 0xbe, 0x93, 0x40, 0x4b, 0xbe, 0xe8, 0xbf, 0xb9, 0x84, 0x42, 0xa4, 0xa9, 0xd4, 0x4f,
+  0x01, 0x9c, 0x1d, 0x28, 0xbd, 0x3b, 0x3c, 0xbf, 0x2b, 0xe3, 0xca, 0x38, 0x97, 0x8d, 0xd0, 0x01,
+  0x19, 0xce, 0x5f, 0x52, 0xc8, 0xce, 0x09, 0x9f, 0x18, 0x65, 0x6c, 0x00, 0xaf, 0x07, 0x83, 0xc1,
+  0x76, 0x2f, 0xe4, 0xad, 0x53, 0x21, 0x6f, 0x2a, 0x16, 0x56, 0x56, 0xb5, 0x26, 0xa6, 0x72, 0x09,
+  0x89, 0x12, 0xce, 0x45, 0x6c, 0x67, 0x00, 0xdb, 0x9b, 0x1a, 0x66, 0xe7, 0xff, 0xaf, 0x2a, 0xed,
+  0xed, 0x81, 0xc5, 0x70, 0x82, 0x3a, 0x85, 0x05, 0x6e, 0x1c, 0x01, 0x16, 0xe8, 0x60, 0x29, 0x05,
+  0x54, 0x5c, 0xd2, 0xd5, 0x98, 0x78, 0x69, 0x74, 0xc8, 0x8b, 0x0e, 0x63, 0x6e, 0x6c, 0x0e, 0xa2,
+  0xde, 0x88, 0x18, 0x77, 0xc4, 0x66, 0x40, 0xcd, 0x91, 0x99, 0x34, 0x62, 0x0f, 0xf7, 0x93, 0x69,
+  0x27, 0x8c, 0x1a, 0x5f, 0x3b, 0x04, 0x1d, 0xa3, 0xdb, 0x2e, 0xda, 0x1d, 0xc9, 0xa0, 0x50, 0x22,
+  0xc1, 0xcc, 0xa8, 0x14, 0x6d, 0xc4, 0xc6, 0xd4, 0x52, 0x76, 0x1f, 0x10, 0x38, 0xfc, 0x51, 0xa2,
+  0x4e, 0x08, 0x66, 0x69, 0x26, 0x2d, 0xa6, 0x2f, 0x1c, 0xd0, 0x96, 0x00, 0x96, 0x42, 0x95, 0xb4,
+  0xac, 0x73, 0xbb, 0xdd, 0xe5, 0xd6, 0x75, 0x88, 0x57, 0x79, 0x74, 0xd6, 0x95, 0xa3, 0xb5, 0xe1,
+  0x11, 0x6b, 0x0a, 0xd5, 0xf3, 0xa6, 0x08, 0x9a, 0xd2, 0x3d, 0x4f, 0xc9, 0xe5, 0x42, 0xa9, 0xc3,
+  0x6f, 0xd5, 0x18, 0xaf, 0x45, 0x5e, 0x28, 0x74, 0x01, 0xb0, 0x8f, 0xa8, 0x94, 0x81, 0x2f, 0xc6,
+  0xaa, 0x94, 0x9d, 0x00, 0x1b, 0x4d, 0x1f, 0xef, 0x8e, 0x47, 0xbb, 0xd9, 0xd5, 0xdd, 0xf4, 0xf8,
+  0x7a, 0x7c, 0x57, 0xad, 0x6f, 0xce, 0xaa, 0xe7, 0xf8, 0xd3, 0x74, 0xfc, 0xc8, 0xc2, 0xd8, 0xfe,
+  0x2d, 0x7a, 0x53, 0x2a, 0x05, 0x4a, 0x3a, 0x0f, 0x66, 0x0e, 0x93, 0x02, 0x13, 0xba, 0x1a, 0x75,
+  0x4a, 0x10, 0x0a, 0xc8, 0x2c, 0xce, 0x23, 0x96, 0x79, 0x5f, 0xb8, 0x80, 0xf3, 0x27, 0xe9, 0xb3,
+  0x32, 0xa6, 0x1b, 0x91, 0xf3, 0x9f, 0x42, 0x5f, 0x0c, 0xf8, 0x0a, 0xe3, 0x59, 0xe9, 0xe2, 0xd9,
+  0xa2, 0x6d, 0x03, 0x1e, 0x2b, 0x13, 0xf3, 0x9c, 0xba, 0x85, 0xef, 0xfc, 0x9d, 0x11, 0xbc, 0x90,
+  0xd4, 0x18, 0xa7, 0x19, 0x03, 0x4f, 0x99, 0x23, 0x5d, 0xe7, 0x59, 0xac, 0x84, 0x5e, 0xb0, 0x61,
+  0x86, 0x16, 0x43, 0x2e, 0x86, 0xff, 0x8c, 0x6c, 0x4a, 0x8e, 0x43, 0x4a, 0x05, 0x49, 0xbc, 0xda,
+  0x80, 0xd1, 0xe0, 0x33, 0x84, 0xcc, 0x50, 0xa4, 0x2b, 0x0a, 0x64, 0x1f, 0x1e, 0x57, 0x72, 0x89,
+  0x6c, 0x58, 0x3d, 0xab, 0x2a, 0xd1, 0xb5, 0xa8, 0x24, 0x0f, 0x1d, 0xe5, 0xcf, 0x2c, 0x0d, 0x39,
+  0xd5, 0xa3, 0xed, 0xf5, 0x66, 0x1a, 0xf2, 0xa6, 0xfd, 0xa9, 0x7f, 0xeb, 0xdf, 0xd8, 0x1f, 0x8c,
+  0x7f, 0xe6, 0x61, 0xde, 0x04, 0x00, 0x00,
+};
+const WebAsset INDEX_HTML_ASSET = {"text/html", "\"09f663bb1103e0d3\"", INDEX_HTML_GZ, sizeof(INDEX_HTML_GZ)};
+
+// web/live.html (1799 bytes gzipped)
+const uint8_t LIVE_HTML_GZ[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x58, 0xeb, 0x6f, 0xdb, 0x36,
+  0x10, 0xff, 0xbe, 0xbf, 0xe2, 0xaa, 0x02, 0x83, 0x8c, 0xd8, 0xf2, 0x23, 0x4e, 0x9a, 0xf8, 0x35,
+  0xa4, 0xb6, 0xbb, 0x16, 0x6b, 0xb1, 0x6e, 0x69, 0x31, 0x0c, 0x81, 0x3f, 0xd0, 0x12, 0x6d, 0x71,
+  0x91, 0x45, 0x95, 0xa4, 0x12, 0x1b, 0x6d, 0xfe, 0xf7, 0xdd, 0x51, 0x0f, 0x4b, 0xb6, 0xd3, 0x75,
+  0xfa, 0x22, 0xf3, 0x78, 0xf7, 0xbb, 0xe3, 0xf1, 0x5e, 0xf2, 0xe8, 0xc5, 0xec, 0xf7, 0xe9, 0xa7,
+  0xbf, 0x3f, 0xce, 0x21, 0x34, 0x9b, 0x68, 0xf2, 0xd3, 0xa8, 0x78, 0x71, 0x16, 0x4c, 0x7e, 0x02,
+  0x7c, 0x46, 0x46, 0x98, 0x88, 0x4f, 0xde, 0x8b, 0x07, 0x0e, 0x9f, 0x76, 0x89, 0x88, 0xd7, 0xd0,
+  0x82, 0xcf, 0xb7, 0xaf, 0xe1, 0x37, 0xbe, 0x5b, 0x4a, 0xa6, 0x02, 0x98, 0xca, 0xd8, 0x28, 0x19,
+  0x45, 0x5c, 0x8d, 0xda, 0x19, 0x73, 0x26, 0xb8, 0xe1, 0x86, 0x41, 0xcc, 0x36, 0x7c, 0xec, 0x3c,
+  0x08, 0xfe, 0x98, 0x48, 0x65, 0x1c, 0xf0, 0x91, 0x99, 0xc7, 0x66, 0xec, 0x3c, 0x8a, 0xc0, 0x84,
+  0xe3, 0x80, 0x3f, 0x08, 0x9f, 0xb7, 0xec, 0xa2, 0x09, 0x22, 0x16, 0x46, 0xb0, 0xa8, 0xa5, 0x7d,
+  0x16, 0xf1, 0x71, 0xd7, 0xc9, 0x81, 0xb4, 0xd9, 0x15, 0xa0, 0xf4, 0x2c, 0x65, 0xb0, 0x83, 0xaf,
+  0xb0, 0x42, 0xa4, 0xd6, 0x8a, 0x6d, 0x44, 0xb4, 0x1b, 0xc0, 0x8d, 0x42, 0xb9, 0x26, 0x68, 0x16,
+  0xeb, 0x96, 0xe6, 0x4a, 0xac, 0x86, 0xb0, 0x61, 0x6a, 0x2d, 0xe2, 0x01, 0xf4, 0x3b, 0xc9, 0x76,
+  0x08, 0x4f, 0xa5, 0xb8, 0x47, 0x26, 0x30, 0x11, 0x73, 0x85, 0x20, 0x1b, 0xb6, 0xcd, 0x94, 0x0f,
+  0xe0, 0xb2, 0x63, 0x19, 0x0b, 0xb1, 0x0e, 0xb0, 0xd4, 0xc8, 0xaa, 0xe0, 0xcb, 0x84, 0x05, 0x28,
+  0xb2, 0x94, 0x2a, 0xe0, 0x6a, 0x00, 0xbd, 0x64, 0x0b, 0x5a, 0x46, 0x22, 0x80, 0x97, 0xd7, 0xd7,
+  0xd7, 0x43, 0xc0, 0xdd, 0x00, 0xbd, 0x93, 0x29, 0x84, 0xae, 0x05, 0x33, 0x7c, 0x6b, 0x5a, 0x2c,
+  0x12, 0x6b, 0x04, 0xf4, 0xf1, 0xd8, 0x5c, 0x0d, 0x41, 0xa6, 0x26, 0x42, 0xed, 0x03, 0x88, 0x65,
+  0xcc, 0x0f, 0xf1, 0x07, 0x2b, 0xe9, 0xa7, 0xba, 0xd4, 0xd2, 0xf2, 0x65, 0x24, 0x51, 0xd7, 0xcb,
+  0x1e, 0x7b, 0x55, 0x65, 0x0d, 0x7b, 0xc8, 0x52, 0xec, 0x9d, 0x9f, 0x9f, 0x17, 0x7b, 0xa3, 0x76,
+  0xee, 0xab, 0x51, 0x3b, 0xbb, 0xc1, 0x11, 0x39, 0x2b, 0x77, 0x63, 0x20, 0x1e, 0xc0, 0x8f, 0x98,
+  0xd6, 0x63, 0xa7, 0x74, 0x81, 0xb3, 0x77, 0xeb, 0x28, 0xec, 0x55, 0x6f, 0x19, 0x11, 0x7a, 0x95,
+  0xcd, 0x64, 0x32, 0x8d, 0x84, 0x7f, 0x0f, 0x26, 0xe4, 0x68, 0xdb, 0x16, 0x58, 0x1c, 0x80, 0xd9,
+  0x25, 0x78, 0x00, 0xfe, 0xc0, 0xd5, 0x0e, 0xee, 0xf9, 0x0e, 0xd6, 0x92, 0x6b, 0xd0, 0x46, 0x31,
+  0xb1, 0x0e, 0x0d, 0x18, 0x69, 0x99, 0x43, 0xa9, 0x8d, 0x37, 0x6a, 0x27, 0x15, 0x2c, 0x32, 0x44,
+  0x04, 0x63, 0x07, 0xcf, 0xeb, 0x80, 0x61, 0x4b, 0x11, 0x07, 0x7c, 0x3b, 0x76, 0x3a, 0xce, 0x04,
+  0x43, 0x29, 0xe6, 0xbe, 0x41, 0xf5, 0x9e, 0x87, 0x42, 0xc8, 0x58, 0x33, 0x61, 0xa4, 0x37, 0x2c,
+  0x8a, 0xac, 0xac, 0x36, 0xcc, 0x68, 0x67, 0x82, 0x07, 0x26, 0xd2, 0xa4, 0x54, 0x50, 0x11, 0x1a,
+  0x69, 0x5f, 0x89, 0xc4, 0xec, 0x11, 0xda, 0xed, 0x32, 0x68, 0xe7, 0x0f, 0x78, 0x1b, 0x18, 0x09,
+  0x01, 0x27, 0x3b, 0xdf, 0xbe, 0x9b, 0x41, 0xaa, 0xd9, 0x9a, 0x97, 0xac, 0x0f, 0x4c, 0x61, 0x90,
+  0xdf, 0xfc, 0x3a, 0x87, 0x31, 0x7c, 0x2d, 0xa9, 0xf4, 0xcc, 0xe9, 0x16, 0x31, 0x3c, 0xb6, 0xbd,
+  0xab, 0x26, 0xcc, 0x31, 0x52, 0x13, 0x6e, 0x57, 0xd7, 0x4d, 0x78, 0xcd, 0xfc, 0x7b, 0x9d, 0x30,
+  0x3f, 0x23, 0xdc, 0x34, 0xe1, 0x13, 0x5b, 0xda, 0x9f, 0xaf, 0x9b, 0x70, 0x5b, 0xd2, 0xa7, 0xcd,
+  0x1a, 0xde, 0x07, 0x11, 0xa7, 0xda, 0x6e, 0xcc, 0x10, 0xef, 0x4b, 0xca, 0x22, 0xbb, 0x98, 0x23,
+  0x9c, 0x42, 0x3c, 0x6e, 0xde, 0xf3, 0x95, 0xb1, 0xa4, 0x37, 0x25, 0xe9, 0x4f, 0x72, 0x30, 0xd1,
+  0xce, 0x3b, 0xb9, 0x56, 0xbc, 0xd6, 0xd0, 0x12, 0xba, 0x75, 0xf4, 0x5b, 0xbe, 0x11, 0x14, 0x27,
+  0xb1, 0xdd, 0x3c, 0x6f, 0xc2, 0x1f, 0xa9, 0x34, 0xd6, 0x8e, 0xf3, 0x7e, 0x26, 0xfa, 0xa5, 0x24,
+  0x5c, 0x34, 0x31, 0x95, 0x37, 0x1b, 0x66, 0x17, 0x97, 0x4d, 0xf8, 0x88, 0x79, 0x24, 0x03, 0xbb,
+  0x7a, 0x85, 0x07, 0x28, 0x55, 0x5c, 0xd5, 0x55, 0x4c, 0x59, 0xa2, 0xdf, 0x4b, 0xff, 0xde, 0xee,
+  0xa1, 0x17, 0x3e, 0x2a, 0x11, 0x9b, 0x5b, 0x5f, 0x71, 0x6e, 0x95, 0xf6, 0x11, 0x09, 0x57, 0x58,
+  0x1f, 0x0a, 0xa6, 0x3e, 0xa2, 0x7d, 0x64, 0xa9, 0xb6, 0x5a, 0xfb, 0xe8, 0xc5, 0x77, 0x31, 0xa6,
+  0xac, 0x3d, 0x4f, 0xff, 0xba, 0x8e, 0xfd, 0x56, 0x6e, 0x32, 0xae, 0x1b, 0x12, 0x59, 0xf3, 0xcf,
+  0x89, 0x5d, 0xa1, 0x3f, 0x67, 0x3c, 0xe2, 0x99, 0xdd, 0xfd, 0x29, 0xfa, 0x2d, 0xb6, 0x76, 0xf6,
+  0x67, 0x19, 0xdb, 0x4c, 0x3e, 0x66, 0xba, 0xe7, 0x75, 0xb8, 0x1b, 0xa5, 0xe4, 0x63, 0xe9, 0xbc,
+  0x3e, 0x3a, 0xd4, 0x52, 0x0a, 0x0f, 0x5f, 0x74, 0x72, 0x42, 0x21, 0x7f, 0xd1, 0xcd, 0x09, 0x99,
+  0xde, 0x8b, 0x5e, 0x1d, 0xee, 0x5d, 0x6c, 0xa2, 0x9a, 0xf7, 0x2f, 0xfb, 0x4d, 0x5b, 0x0d, 0x31,
+  0xeb, 0x3f, 0xf0, 0x38, 0xb5, 0xa4, 0x8b, 0x03, 0x6f, 0x65, 0xc5, 0xb2, 0x50, 0x39, 0x47, 0x95,
+  0xb7, 0xa1, 0x58, 0x95, 0xb7, 0x3c, 0x27, 0x95, 0xd1, 0x7e, 0xd9, 0x6b, 0xc2, 0x07, 0xac, 0xa3,
+  0xe5, 0xfa, 0xfc, 0x24, 0x5c, 0x79, 0xa6, 0x79, 0x3f, 0xc7, 0xdb, 0x53, 0x2e, 0x2c, 0xe0, 0x7e,
+  0x7d, 0x99, 0x21, 0xee, 0x09, 0xaf, 0x4a, 0xc4, 0xa7, 0x61, 0xf9, 0x73, 0x25, 0x15, 0xb8, 0x94,
+  0x05, 0x02, 0x33, 0xa0, 0x33, 0xc4, 0xd7, 0x08, 0x7a, 0x97, 0xf8, 0x3e, 0x3b, 0x6b, 0x64, 0x99,
+  0x71, 0xe7, 0x60, 0x32, 0x39, 0x70, 0x06, 0xb7, 0x46, 0x51, 0xc2, 0xae, 0x94, 0xdc, 0x4c, 0x43,
+  0xa6, 0xa6, 0x98, 0x54, 0xee, 0xe5, 0x05, 0x6e, 0x88, 0xc6, 0x82, 0x84, 0xb7, 0x9d, 0x3e, 0x2d,
+  0x9e, 0xc1, 0xee, 0x5a, 0xec, 0x31, 0x5c, 0xd7, 0xb1, 0x67, 0x62, 0x2d, 0x0c, 0xa1, 0x8b, 0x0c,
+  0xa3, 0x3b, 0xab, 0x63, 0x58, 0x36, 0xcf, 0x72, 0x75, 0x2c, 0x43, 0xef, 0xd5, 0x7f, 0x28, 0xe8,
+  0xf6, 0xea, 0x1a, 0xde, 0x54, 0xd0, 0xcf, 0xaf, 0x33, 0xf4, 0x5a, 0xfe, 0x53, 0xb9, 0x1f, 0x43,
+  0x80, 0x05, 0x79, 0x43, 0xc5, 0x62, 0xcd, 0xcd, 0x3c, 0xe2, 0xf4, 0xf3, 0xf5, 0xee, 0x5d, 0xe0,
+  0xda, 0xea, 0xd5, 0x18, 0xd6, 0x24, 0x6c, 0x51, 0xfa, 0x9e, 0x4c, 0x56, 0xb5, 0x0e, 0xa5, 0x24,
+  0xe5, 0x34, 0x8a, 0xc5, 0x69, 0x44, 0x3d, 0x8c, 0x7f, 0x21, 0x9b, 0xe8, 0x47, 0x6c, 0x6e, 0x88,
+  0xfe, 0xf5, 0xa9, 0x09, 0xca, 0x58, 0xe4, 0xbb, 0x45, 0x13, 0x96, 0xa9, 0xde, 0xd9, 0x4b, 0xd9,
+  0x9b, 0xbb, 0x4a, 0x63, 0xac, 0x9a, 0x32, 0x26, 0x99, 0xc0, 0x95, 0x49, 0x33, 0x2b, 0x67, 0x8d,
+  0x83, 0xda, 0x25, 0x56, 0xe0, 0xbe, 0xc8, 0xd5, 0x7d, 0xfb, 0x96, 0x2b, 0xf6, 0x14, 0x76, 0x8a,
+  0xdd, 0x2d, 0x5a, 0xc6, 0xe1, 0xc5, 0x18, 0xfd, 0xd4, 0x00, 0xc5, 0x4d, 0xaa, 0xe2, 0x61, 0x4d,
+  0x36, 0x33, 0xcb, 0xa5, 0xd7, 0x19, 0xf1, 0xfc, 0x8c, 0x6e, 0x7b, 0x83, 0xcf, 0x21, 0x17, 0xd9,
+  0x7c, 0x87, 0x5c, 0xe4, 0xd8, 0x84, 0x2b, 0xbc, 0x8a, 0x0d, 0x8b, 0x7d, 0xee, 0xc5, 0xf2, 0xd1,
+  0x6d, 0x1c, 0x30, 0x67, 0xfa, 0xad, 0xcd, 0x31, 0x7f, 0x84, 0xcf, 0x58, 0x38, 0xae, 0x30, 0xdf,
+  0xd8, 0xce, 0xbd, 0x2b, 0xcf, 0x90, 0x39, 0x24, 0xd3, 0x96, 0xfd, 0x9e, 0x4c, 0xe0, 0x6a, 0xd1,
+  0xa8, 0x60, 0x3d, 0x9d, 0x70, 0x04, 0xf6, 0x23, 0xeb, 0x07, 0x4e, 0x85, 0xfe, 0xd0, 0x0f, 0xe4,
+  0x75, 0x0b, 0x8e, 0x36, 0x66, 0xd1, 0xc0, 0xcb, 0x7e, 0xb0, 0x18, 0x1e, 0xb9, 0x2c, 0x67, 0x45,
+  0xdf, 0xa4, 0xd8, 0xa9, 0x56, 0xd8, 0x37, 0x83, 0xd3, 0x3e, 0xca, 0x50, 0x12, 0x65, 0xdf, 0x33,
+  0xbe, 0x62, 0x69, 0x64, 0x0e, 0x0f, 0x6d, 0xef, 0x20, 0x63, 0x54, 0x3c, 0xe1, 0x0c, 0x8d, 0x3b,
+  0xb8, 0xb4, 0xef, 0x1f, 0x4c, 0x87, 0xf2, 0x91, 0x2e, 0x4b, 0xbb, 0xa7, 0x4e, 0xa5, 0x71, 0xc8,
+  0xe2, 0x14, 0xb6, 0x14, 0x2f, 0x9e, 0xc6, 0x96, 0xcd, 0xdd, 0x86, 0x47, 0x54, 0xb7, 0x44, 0x70,
+  0x19, 0xc6, 0x10, 0x0a, 0xe7, 0x47, 0x00, 0x86, 0x03, 0xdd, 0x12, 0x27, 0x88, 0x03, 0x43, 0x09,
+  0x6e, 0xc3, 0x03, 0xc1, 0x62, 0x84, 0xcb, 0x70, 0xef, 0x3e, 0x30, 0x13, 0x7a, 0xab, 0x48, 0x4a,
+  0xe5, 0x66, 0x14, 0x2f, 0xe2, 0xf1, 0xda, 0x84, 0xd0, 0x86, 0x5e, 0xe3, 0xc0, 0x73, 0x36, 0xd6,
+  0x3d, 0xaa, 0x85, 0xd3, 0x6c, 0xe6, 0x43, 0x18, 0xe7, 0x4f, 0x99, 0xd2, 0xe0, 0x80, 0x7d, 0x79,
+  0x00, 0x58, 0x35, 0x0d, 0x50, 0x12, 0x92, 0xad, 0x77, 0xd6, 0xe0, 0x1c, 0xad, 0x05, 0xdd, 0x85,
+  0x67, 0xe4, 0x1b, 0xb1, 0xe5, 0x81, 0x8b, 0xb1, 0x76, 0x86, 0x6c, 0x1b, 0xdd, 0x2c, 0xcc, 0x41,
+  0x99, 0x9a, 0x26, 0x7a, 0xb2, 0xad, 0x63, 0x21, 0x90, 0x38, 0x9e, 0x94, 0x5a, 0x0a, 0x05, 0xb4,
+  0x87, 0x11, 0xa2, 0x89, 0xee, 0xda, 0x7c, 0xfa, 0x05, 0x9c, 0xa6, 0x65, 0xb3, 0x2b, 0xda, 0x57,
+  0xfc, 0x1f, 0x1c, 0x45, 0xd0, 0x99, 0x96, 0xa1, 0xe1, 0xc0, 0x00, 0x1c, 0xe7, 0x3f, 0x2e, 0xc7,
+  0xcf, 0xe6, 0x97, 0xa3, 0xab, 0x59, 0x71, 0xe3, 0x87, 0xae, 0xd3, 0x8e, 0x70, 0xbe, 0x6a, 0x1b,
+  0x79, 0xcf, 0x63, 0xa7, 0xe1, 0xe1, 0x74, 0x14, 0x57, 0x6e, 0x45, 0x71, 0x9d, 0x48, 0xec, 0x84,
+  0x87, 0xb2, 0x65, 0xd0, 0x14, 0x0c, 0x9e, 0xbc, 0x6f, 0xe0, 0x68, 0x85, 0x6d, 0x09, 0x28, 0x6b,
+  0xe6, 0xd8, 0xa0, 0x54, 0x29, 0xed, 0x91, 0xdb, 0x53, 0x7d, 0x70, 0x97, 0xf4, 0xe4, 0xb7, 0x5d,
+  0x32, 0xfe, 0xa3, 0x65, 0x7c, 0x18, 0x9c, 0x4f, 0x47, 0x56, 0xad, 0x15, 0x3b, 0xce, 0x9f, 0x7d,
+  0xf2, 0x52, 0xd5, 0x42, 0x1b, 0xfe, 0xe2, 0xcb, 0x5b, 0xbb, 0x76, 0x9d, 0x47, 0x3d, 0x68, 0xb7,
+  0xc9, 0x91, 0x91, 0xf4, 0x19, 0x61, 0x78, 0x34, 0x01, 0xd2, 0x67, 0x00, 0x79, 0x75, 0x40, 0x3b,
+  0x16, 0xd3, 0xa3, 0xef, 0x01, 0x22, 0xb5, 0x7f, 0xb1, 0x0e, 0x19, 0xef, 0x77, 0xec, 0xfa, 0xc4,
+  0x09, 0xf2, 0x7a, 0x81, 0xf3, 0x22, 0x53, 0x3b, 0x9c, 0x52, 0x29, 0x7d, 0x1d, 0x46, 0xf5, 0x62,
+  0x99, 0xae, 0x56, 0x38, 0xcc, 0x3e, 0x2b, 0x22, 0x63, 0x99, 0x70, 0x8a, 0xe3, 0xfd, 0xc1, 0x28,
+  0x01, 0xb0, 0x84, 0x1f, 0x06, 0x68, 0x3e, 0x81, 0xe2, 0xb5, 0xb7, 0xec, 0x7c, 0x0b, 0x21, 0x57,
+  0xdc, 0xb1, 0xd3, 0xbd, 0x67, 0x67, 0x73, 0x74, 0x59, 0xb5, 0x4f, 0x1e, 0x29, 0xf2, 0x23, 0xa9,
+  0xf9, 0x8f, 0x68, 0x9a, 0x09, 0xed, 0x57, 0x94, 0xf9, 0xd9, 0x78, 0x2d, 0xf1, 0x82, 0x72, 0x32,
+  0x6a, 0xad, 0xb5, 0x86, 0xef, 0xeb, 0xdd, 0x70, 0x9d, 0x57, 0xb4, 0xbd, 0xe6, 0x9c, 0x76, 0xea,
+  0xfa, 0x8a, 0x0c, 0xc7, 0xf1, 0x25, 0xbf, 0xc3, 0x4a, 0xf5, 0xcd, 0xe5, 0xbc, 0x80, 0x19, 0x76,
+  0xe2, 0x1e, 0x2a, 0xb2, 0xb6, 0xd6, 0xe0, 0xfb, 0xae, 0xb3, 0x80, 0x6f, 0x58, 0x59, 0xf0, 0x57,
+  0x77, 0x01, 0xa3, 0x11, 0x5c, 0x3d, 0x23, 0x47, 0x91, 0x4c, 0x5c, 0xbd, 0x85, 0x2d, 0xa8, 0x98,
+  0xa7, 0x94, 0x5d, 0x67, 0x67, 0xcf, 0x73, 0xe7, 0x2d, 0xc5, 0x2a, 0x5b, 0xd8, 0x0e, 0x55, 0xa9,
+  0xc2, 0xa7, 0x0f, 0x66, 0xc3, 0x9d, 0xd2, 0x3d, 0x49, 0x75, 0xe8, 0x1e, 0x75, 0x21, 0xf4, 0x76,
+  0x0d, 0xf4, 0x19, 0x53, 0x0b, 0x03, 0xaa, 0x85, 0x63, 0x02, 0xbd, 0x4e, 0xa7, 0x91, 0x57, 0x57,
+  0x9a, 0xb3, 0xdc, 0xef, 0x08, 0x07, 0x76, 0x46, 0xad, 0xeb, 0x7a, 0x9e, 0xbb, 0x52, 0xd8, 0x4f,
+  0x33, 0x3d, 0x1d, 0x51, 0x9f, 0x8e, 0xb2, 0x17, 0x53, 0x0e, 0x0b, 0xcd, 0x0f, 0x44, 0x79, 0x1a,
+  0x05, 0xf8, 0x01, 0x6a, 0xc0, 0xe6, 0x05, 0x7d, 0xa7, 0xf9, 0x21, 0xc3, 0xa8, 0x8b, 0xea, 0x91,
+  0x68, 0xd4, 0xce, 0xa9, 0x77, 0x86, 0x4a, 0xd5, 0x23, 0x5c, 0xfc, 0xe6, 0xb5, 0x9f, 0x52, 0xef,
+  0x85, 0x46, 0x6c, 0xae, 0x5c, 0x07, 0xcb, 0x6a, 0x80, 0xe3, 0x33, 0x56, 0xd3, 0xbd, 0x15, 0x45,
+  0x13, 0xb6, 0x5d, 0xb9, 0x5b, 0x34, 0xe5, 0x3a, 0xf0, 0xb3, 0x68, 0x69, 0xf2, 0x3c, 0x56, 0xef,
+  0xff, 0x60, 0x2d, 0xa3, 0x54, 0xd5, 0xa0, 0x08, 0xc5, 0xf6, 0x5e, 0xfc, 0x2e, 0xea, 0xfc, 0x10,
+  0x84, 0x75, 0xcd, 0x11, 0x46, 0x65, 0xac, 0x6a, 0xec, 0x5b, 0x40, 0x1d, 0x6f, 0x4f, 0x2e, 0x3e,
+  0xd4, 0xf3, 0x8f, 0xd3, 0x51, 0x3b, 0xfb, 0x44, 0xc7, 0xef, 0x6d, 0xfb, 0xd7, 0xcb, 0xbf, 0x2f,
+  0x32, 0xa0, 0xc9, 0x92, 0x11, 0x00, 0x00,
+};
+const WebAsset LIVE_HTML_ASSET = {"text/html", "\"32b4617b57a85ce3\"", LIVE_HTML_GZ, sizeof(LIVE_HTML_GZ)};
+
+#endif
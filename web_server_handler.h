@@ -3,122 +3,246 @@
 
 #include <Arduino.h>
 #include <WebServer.h>
+#include <uri/UriBraces.h>
 #include "config_manager.h"
+#include "metrics.h"
+#include "boot_sequence.h"
 #include "keyboard_handler.h"
+#include "keystroke_queue.h"
+#include "keystroke_batch.h"
+#include "macro_store.h"
+#include "web_assets.h"
 #include "slack_notifier.h"
 #include "security_manager.h"
+#include "auth_manager.h"
+#include "audit_log.h"
+#include "live_channel.h"
 
 // Global web server instance
 extern WebServer webServer;
 
 // Constants
 extern const char* AUTH_REALM;
-extern String AUTH_FAIL_RESPONSE;
+extern const char* AUTH_FAIL_RESPONSE;
+
+// Upload bytes compiled per step; bounds the reports buffered before they go to the ring
+#define KEYSTROKE_UPLOAD_SLICE 64
+
+// Raw-body keystroke upload in progress (the server handles one client at a time)
+typedef struct {
+  bool accepted;
+  bool authChecked;          // Set at RAW_START, taken by the request handler
+  uint8_t authResult;
+  uint32_t jobId;
+  uint64_t digest;
+  size_t bytes;
+  KeystrokeStream stream;
+  KeystrokeProgram reports;
+} KeystrokeUpload;
+
+// Macro upload in progress
+typedef struct {
+  bool accepted;
+  bool authChecked;
+  uint8_t authResult;
+  MacroWriter writer;
+  KeystrokeStream stream;    // Text uploads only
+  KeystrokeProgram reports;
+} MacroUpload;
 
 // Function declarations
 void initializeWebServer();
 void handleWebServerClient();
+bool isAuthenticated();
+bool checkUploadAuthentication(bool& checked, uint8_t& result);
+bool isUploadAuthenticated(bool& checked, uint8_t& result);
+bool countFailedAuthentication();
+void requestDigestAuthentication();
+bool isWebAssetCurrent(const WebAsset& asset);
+void sendWebAsset(const WebAsset& asset);
 void handleMainPage();
 void handleKeystrokeSend();
+void handleKeystrokeUpload();
+void handleKeystrokeUploadData();
+void handleBatch();
+void handleJobStatus();
+void handleMacroUpload();
+void handleMacroUploadData();
+void handleMacroPlay();
+void handleMacroDelete();
+void handleMacroList();
+void handleLivePage();
+void handleLiveToken();
+void handleStatus();
+void handleMetrics();
+void handleLogin();
+void handleAudit();
 
 // Implementation
 WebServer webServer(80);
 const char* AUTH_REALM = "Device Auth Realm";
-String AUTH_FAIL_RESPONSE = "Authentication Failed";
+const char* AUTH_FAIL_RESPONSE = "Authentication Failed";
+KeystrokeUpload keystrokeUpload;
+MacroUpload macroUpload;
 
-void handleMainPage() {
-  String clientIP = webServer.client().remoteIP().toString();
-  String pageName = getConfigValue("pagename");
-  String page = pageName.isEmpty() ? "/" : "/" + pageName;
-  String slackWebhook = getConfigValue("slack_webhook");
+// Start of the request being timed, when its body is streamed to a raw handler
+uint32_t requestStartUs = 0;
+bool requestTimed = false;
+
+// Handler wrapper that records the request time under its route
+template <uint8_t route, void (*handler)()>
+void timedRoute() {
+  uint32_t started = requestTimed ? requestStartUs : micros();
+  requestTimed = false;
+  handler();
+  recordMetric(routeLatency[route], micros() - started);
+}
+
+// Raw body handler wrapper; the route's time starts with the first block
+template <void (*handler)()>
+void timedUpload() {
+  if (webServer.raw().status == RAW_START) {
+    requestStartUs = micros();
+    requestTimed = true;
+  }
+  handler();
+}
+
+const char* httpMethodName(HTTPMethod method) {
+  switch (method) {
+    case HTTP_GET:    return "GET";
+    case HTTP_HEAD:   return "HEAD";
+    case HTTP_POST:   return "POST";
+    case HTTP_PUT:    return "PUT";
+    case HTTP_PATCH:  return "PATCH";
+    case HTTP_DELETE: return "DELETE";
+    default:          return "OPTIONS";
+  }
+}
+
+// Set instead of an AUTH_* result when the client is blocked; its credentials are not checked
+#define AUTH_BLOCKED 4
+
+// Digest or session token; the result is kept for requestDigestAuthentication()
+uint8_t lastAuthResult = AUTH_MISSING;
 
-  // Check if client is blocked
+// " on <method> <path>" for Slack auth events
+void formatAuthDetail(char* detail, size_t size) {
+  snprintf(detail, size, " on %s %s", httpMethodName(webServer.method()), webServer.uri().c_str());
+}
+
+// A login is the first request accepted on a Digest nonce; later requests on
+// the same nonce, and session tokens, are not reported again
+bool isAuthenticated() {
+  uint32_t started = micros();
+  IPAddress clientIP = webServer.client().remoteIP();
   if (isClientBlocked(clientIP)) {
+    lastAuthResult = AUTH_BLOCKED;
+  } else {
+    lastAuthResult = authenticateRequest(webServer.header("Authorization").c_str(), httpMethodName(webServer.method()),
+      webServer.uri().c_str(), clientIP);
+  }
+  recordMetric(authLatency, micros() - started);
+
+  if (lastAuthResult == AUTH_OK && authNewDigestLogin) {
+    char detail[48];
+    formatAuthDetail(detail, sizeof(detail));
+    clearFailedAttempts(clientIP);
+    queueSlackEvent(SLACK_EVENT_AUTH_SUCCESS, clientIP, detail);
+  }
+  return lastAuthResult == AUTH_OK;
+}
+
+// Checks a raw upload's credentials at RAW_START and keeps the result for the
+// request handler
+bool checkUploadAuthentication(bool& checked, uint8_t& result) {
+  bool authenticated = isAuthenticated();
+  checked = true;
+  result = lastAuthResult;
+  return authenticated;
+}
+
+// The result kept at RAW_START, if the body handler ran; checking the header
+// again would take the same nonce count twice and be refused as a replay
+bool isUploadAuthenticated(bool& checked, uint8_t& result) {
+  if (!checked) {
+    return isAuthenticated();
+  }
+  checked = false;
+  lastAuthResult = result;
+  return lastAuthResult == AUTH_OK;
+}
+
+// Counts wrong credentials towards a block. Requests without credentials and
+// expired nonces are not counted: browsers send both before a login succeeds.
+// Call once per rejected request; returns true once the client is blocked.
+bool countFailedAuthentication() {
+  if (lastAuthResult != AUTH_FAILED) {
+    return lastAuthResult == AUTH_BLOCKED;
+  }
+
+  IPAddress clientIP = webServer.client().remoteIP();
+  char detail[48];
+  formatAuthDetail(detail, sizeof(detail));
+  recordFailedAttempt(clientIP);
+  queueSlackEvent(SLACK_EVENT_AUTH_FAILED, clientIP, detail);
+
+  if (getFailedAttemptCount(clientIP) >= MAX_FAILED_ATTEMPTS) {
+    blockClient(clientIP);
+    queueSlackEvent(SLACK_EVENT_AUTH_BLOCKED, clientIP, detail);
+    lastAuthResult = AUTH_BLOCKED;
+  }
+  return lastAuthResult == AUTH_BLOCKED;
+}
+
+// 401 with a fresh nonce, or 403 once the client is blocked; stale=true lets
+// the browser retry without a prompt
+void requestDigestAuthentication() {
+  if (countFailedAuthentication()) {
     webServer.send(403, "text/plain", "Access blocked - too many failed authentication attempts.");
     return;
   }
 
-  // Authenticate user
-  if (!webServer.authenticate(getConfigValue("username").c_str(), getConfigValue("userpass").c_str())) {
-    // Record failed attempt
-    recordFailedAttempt(clientIP);
-    
-    if (!slackWebhook.isEmpty()) {
-      // Send notification to Slack for monitoring
-      sendSlackNotification(
-        (getFailedAttemptCount(clientIP)
-          ? "Authentication failed for IP: "
-          : "Authentication prompt shown for IP:"
-        ) + clientIP + " on page " + page, slackWebhook.c_str());
-    }
+  if (lastAuthResult == AUTH_MISSING) {
+    char detail[48];
+    formatAuthDetail(detail, sizeof(detail));
+    queueSlackEvent(SLACK_EVENT_AUTH_PROMPT, webServer.client().remoteIP(), detail);
+  }
 
-    // Check if we should block this client
-    if (getFailedAttemptCount(clientIP) >= MAX_FAILED_ATTEMPTS) {
-      blockClient(clientIP);
-      
-      if (!slackWebhook.isEmpty()) {
-        // Send notification to Slack for monitoring
-        sendSlackNotification("Failed authentication attempt threshold reached for IP: " + clientIP + " on page " + page, slackWebhook.c_str());
-      }
-      
-      webServer.send(403, "text/plain", "Too many failed authentication attempts - Access blocked");
-      return;
-    }
-    
-    webServer.requestAuthentication(DIGEST_AUTH, AUTH_REALM, AUTH_FAIL_RESPONSE);
+  char challenge[128];
+  formatDigestChallenge(challenge, sizeof(challenge), lastAuthResult == AUTH_STALE);
+  webServer.sendHeader("WWW-Authenticate", challenge);
+  webServer.send(401, "text/plain", AUTH_FAIL_RESPONSE);
+}
+
+// True if the request's If-None-Match names the asset's current ETag
+bool isWebAssetCurrent(const WebAsset& asset) {
+  return strstr(webServer.header("If-None-Match").c_str(), asset.etag) != nullptr;
+}
+
+// Gzipped from flash, or 304 if the client's copy is current; revalidated on
+// every visit. Pages are static and public: credentials are asked for by the
+// routes they call, so loading or revalidating one never reaches Slack.
+void sendWebAsset(const WebAsset& asset) {
+  webServer.sendHeader("ETag", asset.etag);
+  webServer.sendHeader("Cache-Control", "no-cache");
+  if (isWebAssetCurrent(asset)) {
+    webServer.send(304);
     return;
   }
+  webServer.sendHeader("Content-Encoding", "gzip");
+  webServer.send_P(200, asset.contentType, (const char*)asset.data, asset.length);
+}
 
-  // Successful authentication
-  clearFailedAttempts(clientIP);
-  
-  if (!slackWebhook.isEmpty()) {
-    // Send notification to Slack for monitoring
-    sendSlackNotification("Successful authentication for IP: " + clientIP + " on page " + page, slackWebhook.c_str());
-  }
-
-  // Send the main HTML page
-  webServer.send(200, "text/html", R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>USB Keyboard Controller</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body { font-family: Arial, sans-serif; margin: 40px; }
-        .container { max-width: 600px; margin: 0 auto; }
-        input[type="text"] { width: 70%; padding: 10px; margin: 5px; }
-        input[type="submit"] { padding: 10px 20px; margin: 5px; }
-        h2 { color: #333; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h2>USB Keyboard Controller</h2>
-        <p>Send keystrokes via USB connection</p>
-        <form action="/send" method="POST">
-            <input type="text" name="keystroke" placeholder="Enter keystroke sequence" required>
-            <input type="submit" value="Send Keystrokes">
-        </form>
-        <div style="margin-top: 20px;">
-            <small>
-                Examples: "Hello World", "CTRL+C", "CTRL+ALT+DEL", "F1", "ENTER"<br>
-                Full list of Special Keys <a href="https://github.com/zan73/web_usb_keyboard/blob/main/keyboard_handler.h" target="_blank">here</a>
-            </small>
-        </div>
-    </div>
-</body>
-</html>
-  )rawliteral");
+// The form posts to /send, which asks for credentials
+void handleMainPage() {
+  sendWebAsset(INDEX_HTML_ASSET);
 }
 
 void handleKeystrokeSend() {
-  String clientIP = webServer.client().remoteIP().toString();
-  String slackWebhook = getConfigValue("slack_webhook");
-
-  // Authenticate user for POST request
-  if (!webServer.authenticate(getConfigValue("username").c_str(), getConfigValue("userpass").c_str())) {
-    webServer.send(403, "text/plain", "Authentication required");
+  // Authenticate user for POST request; the browser prompts on the 401 and posts again
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
     return;
   }
 
@@ -130,28 +254,594 @@ void handleKeystrokeSend() {
     return;
   }
 
-  // Send the keystrokes
-  sendKeystrokeSequence(keystrokeData);
-  
+  // Compile now, type later: loop() drains the job one report at a time
+  KeystrokeProgram& program = requestReports;
+  program.reserve(keystrokeData.length() * 2 + 1);
+  appendTypingRate(program, parseTypingRate(webServer.arg("rate").c_str(), deviceConfig.typingRateUs));
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  options.coalesceReleases = deviceConfig.coalesceReleases;
+  options.layout = parseKeyboardLayout(webServer.arg("layout").c_str(), deviceConfig.layout);
+  compileCachedKeystrokeSequence(keystrokeData.c_str(), keystrokeData.length(), program, options);
+
+  IPAddress clientIP = webServer.client().remoteIP();
+  uint64_t digest = fnv1a64(keystrokeData.c_str(), keystrokeData.length());
+  uint32_t reports = program.size();
+  uint32_t jobId = enqueueKeystrokeJob(program);
+  logAudit(AUDIT_KIND_SEND, jobId ? AUDIT_ACCEPTED : AUDIT_QUEUE_FULL, clientIP, jobId, reports, keystrokeData.length(), digest);
+  if (jobId == 0) {
+    webServer.sendHeader("Retry-After", "1");
+    webServer.send(503, "text/plain", "Keystroke queue full");
+    return;
+  }
+
   // Send response
-  webServer.send(200, "text/plain", "Keystrokes sent: " + keystrokeData);
+  char response[64];
+  snprintf(response, sizeof(response), "{\"job\":%lu,\"status\":\"/jobs/%lu\"}", (unsigned long)jobId, (unsigned long)jobId);
+  char location[24];
+  snprintf(location, sizeof(location), "/jobs/%lu", (unsigned long)jobId);
+  webServer.sendHeader("Location", location);
+  webServer.send(202, "application/json", response);
   
-  // Log to Slack if configured
-  if (!slackWebhook.isEmpty()) {
-    // Send notification to Slack for monitoring
-    sendSlackNotification("Keystrokes sent by IP: " + clientIP + " - Data: '" + keystrokeData + "'", slackWebhook.c_str());
+  // Log to Slack if configured; the digest matches the audit log, the text is not sent
+  char detail[SLACK_DETAIL_SIZE];
+  snprintf(detail, sizeof(detail), " as job %lu - %u bytes, fnv1a64 %08lx%08lx", (unsigned long)jobId,
+    (unsigned)keystrokeData.length(), (unsigned long)(digest >> 32), (unsigned long)(digest & 0xFFFFFFFF));
+  queueSlackEvent(SLACK_EVENT_KEYSTROKES, clientIP, detail);
+}
+
+// Called with each block of the request body as it is read from the socket
+void handleKeystrokeUploadData() {
+  HTTPRaw& raw = webServer.raw();
+  KeystrokeUpload& upload = keystrokeUpload;
+
+  if (raw.status == RAW_START) {
+    upload.accepted = false;
+    upload.jobId = 0;
+    upload.digest = FNV1A64_OFFSET;
+    upload.bytes = 0;
+    if (!checkUploadAuthentication(upload.authChecked, upload.authResult)) {
+      return;
+    }
+    upload.jobId = beginStreamingJob();
+    if (upload.jobId == 0) {
+      return;
+    }
+    upload.accepted = true;
+
+    KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+    options.coalesceReleases = deviceConfig.coalesceReleases;
+    options.layout = parseKeyboardLayout(webServer.arg("layout").c_str(), deviceConfig.layout);
+    upload.reports.reserve(KEYSTROKE_UPLOAD_SLICE * 4 + 2);
+    appendTypingRate(upload.reports, parseTypingRate(webServer.arg("rate").c_str(), deviceConfig.typingRateUs));
+    beginKeystrokeStream(upload.stream, upload.reports, options, webServer.arg("mode") == "literal");
+    return;
+  }
+
+  if (!upload.accepted) {
+    return; // Body is read and discarded
+  }
+
+  if (raw.status == RAW_WRITE) {
+    upload.digest = fnv1a64(raw.buf, raw.currentSize, upload.digest);
+    upload.bytes += raw.currentSize;
+
+    for (size_t pos = 0; pos < raw.currentSize; pos += KEYSTROKE_UPLOAD_SLICE) {
+      size_t length = raw.currentSize - pos;
+      if (length > KEYSTROKE_UPLOAD_SLICE) length = KEYSTROKE_UPLOAD_SLICE;
+      feedKeystrokeStream(upload.stream, (const char*)raw.buf + pos, length);
+      pushStreamingReports(upload.jobId, upload.reports);
+      upload.reports.clear();
+    }
+    return;
+  }
+
+  // RAW_END or RAW_ABORTED: release anything still held and close the job
+  endKeystrokeStream(upload.stream);
+  pushStreamingReports(upload.jobId, upload.reports);
+  endStreamingJob(upload.jobId);
+  recycleKeystrokeProgram(upload.reports);
+}
+
+// Runs once the whole body has been handed to the HID queue
+void handleKeystrokeUpload() {
+  KeystrokeUpload& upload = keystrokeUpload;
+
+  if (!isUploadAuthenticated(upload.authChecked, upload.authResult)) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  if (!upload.accepted) {
+    logAudit(AUDIT_KIND_UPLOAD, AUDIT_QUEUE_FULL, webServer.client().remoteIP(), 0, 0, 0, 0);
+    webServer.sendHeader("Retry-After", "1");
+    webServer.send(503, "text/plain", "Keystroke queue full");
+    return;
+  }
+  const KeystrokeJob* job = findKeystrokeJob(upload.jobId);
+  logAudit(AUDIT_KIND_UPLOAD, AUDIT_ACCEPTED, webServer.client().remoteIP(), upload.jobId,
+    job ? job->total : 0, upload.bytes, upload.digest);
+
+  // Digest and length instead of an echo of the upload
+  char digest[17];
+  snprintf(digest, sizeof(digest), "%08lx%08lx", (unsigned long)(upload.digest >> 32), (unsigned long)(upload.digest & 0xFFFFFFFF));
+
+  char response[128];
+  snprintf(response, sizeof(response), "{\"job\":%lu,\"status\":\"/jobs/%lu\",\"bytes\":%lu,\"fnv1a64\":\"%s\"}",
+    (unsigned long)upload.jobId, (unsigned long)upload.jobId, (unsigned long)upload.bytes, digest);
+  char location[24];
+  snprintf(location, sizeof(location), "/jobs/%lu", (unsigned long)upload.jobId);
+  webServer.sendHeader("Location", location);
+  webServer.send(202, "application/json", response);
+
+  char detail[SLACK_DETAIL_SIZE];
+  snprintf(detail, sizeof(detail), " as job %lu - %lu bytes streamed, fnv1a64 %s",
+    (unsigned long)upload.jobId, (unsigned long)upload.bytes, digest);
+  queueSlackEvent(SLACK_EVENT_KEYSTROKES, webServer.client().remoteIP(), detail);
+}
+
+// Ordered steps in the request body (see keystroke_batch.h), checked as a whole
+// and played as one job with one notification; format=ducky takes a Ducky
+// Script payload instead
+void handleBatch() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  const String& body = webServer.arg("plain");
+  KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+  options.coalesceReleases = deviceConfig.coalesceReleases;
+  options.layout = parseKeyboardLayout(webServer.arg("layout").c_str(), deviceConfig.layout);
+  uint16_t intervalUs = parseTypingRate(webServer.arg("rate").c_str(), deviceConfig.typingRateUs);
+  uint8_t format = parseBatchFormat(webServer.arg("format").c_str(), BATCH_FORMAT_COUNT);
+  if (format == BATCH_FORMAT_COUNT) {
+    webServer.send(400, "text/plain", "Unknown format");
+    return;
+  }
+
+  KeystrokeProgram& program = requestReports;
+  BatchSummary summary;
+  IPAddress clientIP = webServer.client().remoteIP();
+  uint64_t digest = fnv1a64(body.c_str(), body.length());
+  if (!compileKeystrokeBatch(body.c_str(), body.length(), program, options, intervalUs, summary, format)) {
+    logAudit(AUDIT_KIND_BATCH, AUDIT_REJECTED, clientIP, 0, 0, body.length(), digest);
+    webServer.send(400, "text/plain", summary.error);
+    return;
+  }
+
+  uint32_t reports = program.size();
+  uint32_t jobId = enqueueKeystrokeJob(program);
+  logAudit(AUDIT_KIND_BATCH, jobId ? AUDIT_ACCEPTED : AUDIT_QUEUE_FULL, clientIP, jobId, reports, body.length(), digest);
+  if (jobId == 0) {
+    webServer.sendHeader("Retry-After", "1");
+    webServer.send(503, "text/plain", "Keystroke queue full");
+    return;
+  }
+
+  char response[128];
+  snprintf(response, sizeof(response), "{\"job\":%lu,\"status\":\"/jobs/%lu\",\"steps\":%u,\"estimated_ms\":%lu}",
+    (unsigned long)jobId, (unsigned long)jobId, (unsigned)summary.steps, (unsigned long)summary.estimatedMs);
+  char location[24];
+  snprintf(location, sizeof(location), "/jobs/%lu", (unsigned long)jobId);
+  webServer.sendHeader("Location", location);
+  webServer.send(202, "application/json", response);
+
+  char steps[64];
+  char detail[SLACK_DETAIL_SIZE];
+  formatBatchSummary(summary, steps, sizeof(steps));
+  snprintf(detail, sizeof(detail), " as job %lu - batch of %s", (unsigned long)jobId, steps);
+  queueSlackEvent(SLACK_EVENT_KEYSTROKES, clientIP, detail);
+}
+
+void handleJobStatus() {
+  // Authenticate user for job status request
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  const KeystrokeJob* job = findKeystrokeJob(strtoul(webServer.pathArg(0).c_str(), nullptr, 10));
+  if (!job) {
+    webServer.send(404, "text/plain", "Unknown job");
+    return;
+  }
+
+  char response[96];
+  snprintf(response, sizeof(response), "{\"job\":%lu,\"state\":\"%s\",\"sent\":%u,\"total\":%u}",
+    (unsigned long)job->id, keystrokeJobStateName(job->state), (unsigned)keystrokeJobSent(job), (unsigned)job->total);
+  webServer.send(200, "application/json", response);
+}
+
+// Text bodies are compiled with the keystroke syntax; application/octet-stream
+// bodies must be files from tools/macro_compiler.cpp
+void handleMacroUploadData() {
+  HTTPRaw& raw = webServer.raw();
+  MacroUpload& upload = macroUpload;
+  MacroWriter& writer = upload.writer;
+
+  if (raw.status == RAW_START) {
+    upload.accepted = false;
+    if (!checkUploadAuthentication(upload.authChecked, upload.authResult) ||
+        !isValidMacroName(webServer.pathArg(0).c_str())) {
+      return;
+    }
+
+    bool binary = webServer.header("Content-Type") == "application/octet-stream";
+    uint8_t layout = parseKeyboardLayout(webServer.arg("layout").c_str(), deviceConfig.layout);
+    uint16_t intervalUs = parseTypingRate(webServer.arg("rate").c_str(), deviceConfig.typingRateUs);
+    if (!beginMacroFile(writer, webServer.pathArg(0).c_str(), layout, intervalUs, binary)) {
+      return;
+    }
+    upload.accepted = true;
+
+    if (!binary) {
+      KeystrokeOptions options = DEFAULT_KEYSTROKE_OPTIONS;
+      options.coalesceReleases = deviceConfig.coalesceReleases;
+      options.layout = layout;
+      upload.reports.reserve(KEYSTROKE_UPLOAD_SLICE * 4 + 1);
+      beginKeystrokeStream(upload.stream, upload.reports, options, webServer.arg("mode") == "literal");
+    }
+    return;
+  }
+
+  if (!upload.accepted) {
+    return;
+  }
+
+  if (raw.status == RAW_ABORTED) {
+    abortMacroFile(writer);
+    recycleKeystrokeProgram(upload.reports);
+    return;
+  }
+
+  if (writer.binary) {
+    if (raw.status == RAW_WRITE) {
+      writeMacroBytes(writer, raw.buf, raw.currentSize);
+    } else {
+      finishMacroFile(writer);
+    }
+    return;
+  }
+
+  if (raw.status == RAW_WRITE) {
+    for (size_t pos = 0; pos < raw.currentSize; pos += KEYSTROKE_UPLOAD_SLICE) {
+      size_t length = raw.currentSize - pos;
+      if (length > KEYSTROKE_UPLOAD_SLICE) length = KEYSTROKE_UPLOAD_SLICE;
+      feedKeystrokeStream(upload.stream, (const char*)raw.buf + pos, length);
+      writeMacroReports(writer, upload.reports.data(), upload.reports.size());
+      upload.reports.clear();
+    }
+    return;
+  }
+
+  endKeystrokeStream(upload.stream);
+  writeMacroReports(writer, upload.reports.data(), upload.reports.size());
+  finishMacroFile(writer);
+  recycleKeystrokeProgram(upload.reports);
+}
+
+void handleMacroUpload() {
+  MacroUpload& upload = macroUpload;
+
+  if (!isUploadAuthenticated(upload.authChecked, upload.authResult)) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  if (!isValidMacroName(webServer.pathArg(0).c_str())) {
+    webServer.send(400, "text/plain", "Invalid macro name");
+    return;
+  }
+
+  if (!upload.accepted || upload.writer.failed) {
+    webServer.send(400, "text/plain", "Macro rejected (invalid file or filesystem full)");
+    return;
+  }
+
+  const MacroHeader& header = upload.writer.builder.header;
+  char response[128];
+  snprintf(response, sizeof(response), "{\"macro\":\"%.*s\",\"reports\":%lu,\"estimated_ms\":%lu}",
+    MACRO_NAME_MAX, upload.writer.name, (unsigned long)header.reportCount, (unsigned long)header.estimatedMs);
+  webServer.send(201, "application/json", response);
+
+  char detail[SLACK_DETAIL_SIZE];
+  snprintf(detail, sizeof(detail), " - '%.*s', %lu reports", MACRO_NAME_MAX, upload.writer.name,
+    (unsigned long)header.reportCount);
+  queueSlackEvent(SLACK_EVENT_MACRO_STORED, webServer.client().remoteIP(), detail);
+}
+
+void handleMacroPlay() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  String name = webServer.pathArg(0);
+  File file;
+  MacroHeader header;
+  if (!openMacro(name.c_str(), file, header)) {
+    webServer.send(404, "text/plain", "Unknown macro");
+    return;
+  }
+
+  // Reports stay on flash; the queue reads them a block at a time
+  KeystrokeProgram& prefix = requestReports;
+  appendTypingRate(prefix, parseTypingRate(webServer.arg("rate").c_str(), header.intervalUs));
+  uint32_t jobId = enqueueMacroJob(prefix, file, header.reportCount);
+  logAudit(AUDIT_KIND_MACRO, jobId ? AUDIT_ACCEPTED : AUDIT_QUEUE_FULL, webServer.client().remoteIP(), jobId,
+    header.reportCount, header.reportCount * sizeof(HidReport), header.digest);
+  if (jobId == 0) {
+    file.close();
+    webServer.sendHeader("Retry-After", "1");
+    webServer.send(503, "text/plain", "Keystroke queue full");
+    return;
+  }
+
+  char response[128];
+  snprintf(response, sizeof(response), "{\"job\":%lu,\"status\":\"/jobs/%lu\",\"reports\":%lu,\"estimated_ms\":%lu}",
+    (unsigned long)jobId, (unsigned long)jobId, (unsigned long)header.reportCount, (unsigned long)header.estimatedMs);
+  char location[24];
+  snprintf(location, sizeof(location), "/jobs/%lu", (unsigned long)jobId);
+  webServer.sendHeader("Location", location);
+  webServer.send(202, "application/json", response);
+
+  char detail[SLACK_DETAIL_SIZE];
+  snprintf(detail, sizeof(detail), " as job %lu - macro '%s'", (unsigned long)jobId, name.c_str());
+  queueSlackEvent(SLACK_EVENT_KEYSTROKES, webServer.client().remoteIP(), detail);
+}
+
+void handleMacroDelete() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  if (!removeMacro(webServer.pathArg(0).c_str())) {
+    webServer.send(404, "text/plain", "Unknown macro");
+    return;
+  }
+  webServer.send(204);
+}
+
+void handleMacroList() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  webServer.send(200, "application/json", "");
+  webServer.sendContent("[");
+
+  const size_t extensionLength = strlen(MACRO_EXTENSION);
+  bool first = true;
+  Dir dir = LittleFS.openDir(MACRO_DIR);
+  while (dir.next()) {
+    String fileName = dir.fileName();
+    size_t length = fileName.length();
+    if (length <= extensionLength || length - extensionLength > MACRO_NAME_MAX ||
+        strcmp(fileName.c_str() + length - extensionLength, MACRO_EXTENSION) != 0) {
+      continue; // Not a macro, e.g. an interrupted upload
+    }
+
+    char name[MACRO_NAME_MAX + 1];
+    memcpy(name, fileName.c_str(), length - extensionLength);
+    name[length - extensionLength] = '\0';
+
+    File file;
+    MacroHeader header;
+    if (!openMacro(name, file, header)) {
+      continue;
+    }
+    file.close();
+
+    char entry[112];
+    snprintf(entry, sizeof(entry), "%s{\"name\":\"%s\",\"reports\":%lu,\"estimated_ms\":%lu}",
+      first ? "" : ",", name, (unsigned long)header.reportCount, (unsigned long)header.estimatedMs);
+    webServer.sendContent(entry);
+    first = false;
+  }
+
+  webServer.sendContent("]");
+  webServer.sendContent("");
+}
+
+// The page fetches /live/token, which asks for credentials
+void handleLivePage() {
+  sendWebAsset(LIVE_HTML_ASSET);
+}
+
+// Single-use token that opens the live typing channel
+void handleLiveToken() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  char token[33];
+  issueLiveToken(token, sizeof(token));
+  char response[96];
+  snprintf(response, sizeof(response), "{\"token\":\"%s\",\"port\":%d,\"expires_ms\":%d}",
+    token, LIVE_CHANNEL_PORT, LIVE_TOKEN_TTL_MS);
+  webServer.sendHeader("Cache-Control", "no-store");
+  webServer.send(200, "application/json", response);
+}
+
+void handleStatus() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  char response[768];
+  int length = snprintf(response, sizeof(response), "{\"uptime_ms\":%lu,\"boot\":", (unsigned long)millis());
+  length += formatBootTimings(response + length, sizeof(response) - length);
+  length += snprintf(response + length, sizeof(response) - length,
+    ",\"ring_size\":%u,\"live\":{\"connected\":%s,\"events\":%lu,\"latency_us\":{",
+    (unsigned)hidReportRing.size(), isLiveChannelOpen() ? "true" : "false",
+    (unsigned long)liveEventsReceived);
+  for (int i = 0; i < METRIC_BUCKETS; i++) {
+    char bucket[16];
+    if (i < METRIC_BUCKETS - 1) {
+      snprintf(bucket, sizeof(bucket), "le_%lu", (unsigned long)metricBucketBound(i));
+    } else {
+      snprintf(bucket, sizeof(bucket), "inf");
+    }
+    length += snprintf(response + length, sizeof(response) - length, "%s\"%s\":%lu",
+      i ? "," : "", bucket, (unsigned long)liveLatency.counts[i]);
+  }
+  snprintf(response + length, sizeof(response) - length, "}}}");
+  webServer.send(200, "application/json", response);
+}
+
+// Prometheus text format; histograms are in microseconds
+void handleMetrics() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  static char text[1024];
+  webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  webServer.send(200, "text/plain; version=0.0.4", "");
+
+  webServer.sendContent("# TYPE web_request_duration_us histogram\n");
+  for (int route = 0; route < ROUTE_COUNT; route++) {
+    char labels[40];
+    snprintf(labels, sizeof(labels), "route=\"%s\"", ROUTE_NAMES[route]);
+    webServer.sendContent(text, formatMetricHistogram(text, sizeof(text), "web_request_duration_us", labels, routeLatency[route]));
+  }
+
+  const struct { const char* name; const MetricHistogram& histogram; } histograms[] = {
+    {"web_auth_duration_us", authLatency},
+    {"hid_report_wait_us", hidWaitLatency},
+    {"live_event_latency_us", liveLatency},
+    {"slack_post_duration_us", slackLatency},
+    {"loop_duration_us", loopLatency},
+  };
+  for (const auto& entry : histograms) {
+    snprintf(text, sizeof(text), "# TYPE %s histogram\n", entry.name);
+    webServer.sendContent(text);
+    webServer.sendContent(text, formatMetricHistogram(text, sizeof(text), entry.name, "", entry.histogram));
+  }
+
+  snprintf(text, sizeof(text),
+    "# TYPE slack_post_failures_total counter\nslack_post_failures_total %lu\n"
+    "# TYPE slack_events_dropped_total counter\nslack_events_dropped_total %lu\n"
+    "# TYPE hid_reports_emitted_total counter\nhid_reports_emitted_total %lu\n"
+    "# TYPE keystroke_jobs_pending gauge\nkeystroke_jobs_pending %lu\n"
+    "# TYPE hid_ring_depth gauge\nhid_ring_depth %u\n"
+    "# TYPE blocked_clients gauge\nblocked_clients %d\n"
+    "# TYPE client_records_evicted_total counter\nclient_records_evicted_total %lu\n"
+    "# TYPE audit_records_dropped_total counter\naudit_records_dropped_total %lu\n"
+    "# TYPE heap_free_bytes gauge\nheap_free_bytes %d\n"
+    "# TYPE heap_largest_free_bytes gauge\nheap_largest_free_bytes %u\n"
+    "# TYPE uptime_ms counter\nuptime_ms %lu\n",
+    (unsigned long)slackPostFailures, (unsigned long)slackEventsDropped,
+    (unsigned long)hidReportsEmitted.load(std::memory_order_relaxed),
+    (unsigned long)(nextKeystrokeJobId - activeKeystrokeJobId), (unsigned)hidReportRing.size(),
+    countBlockedClients(), (unsigned long)clientRecordsEvicted, (unsigned long)auditRecordsDropped,
+    rp2040.getFreeHeap(), (unsigned)heapLargestFreeBlock(), (unsigned long)millis());
+  webServer.sendContent(text);
+
+  snprintf(text, sizeof(text),
+    "# TYPE program_cache_hits_total counter\nprogram_cache_hits_total %lu\n"
+    "# TYPE program_cache_misses_total counter\nprogram_cache_misses_total %lu\n"
+    "# TYPE program_cache_evictions_total counter\nprogram_cache_evictions_total %lu\n"
+    "# TYPE program_cache_entries gauge\nprogram_cache_entries %lu\n"
+    "# TYPE program_cache_bytes gauge\nprogram_cache_bytes %lu\n",
+    (unsigned long)programCacheHits, (unsigned long)programCacheMisses, (unsigned long)programCacheEvictions,
+    (unsigned long)programCacheEntries, (unsigned long)(programCacheReports * sizeof(HidReport)));
+  webServer.sendContent(text);
+  webServer.sendContent("");
+}
+
+// Session token for scripted clients: one Digest login, then one round trip
+// per request with "Authorization: Bearer <token>"
+void handleLogin() {
+  IPAddress clientIP = webServer.client().remoteIP();
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+  if (!webServer.header("Authorization").startsWith("Digest ")) {
+    webServer.send(403, "text/plain", "Session tokens are issued for Digest logins only");
+    return;
+  }
+
+  char token[SESSION_TOKEN_SIZE];
+  issueSessionToken(token, sizeof(token), clientIP);
+  char response[96];
+  snprintf(response, sizeof(response), "{\"token\":\"%s\",\"expires_ms\":%lu}", token, (unsigned long)SESSION_TOKEN_TTL_MS);
+  webServer.sendHeader("Cache-Control", "no-store");
+  webServer.send(200, "application/json", response);
+
+  queueSlackEvent(SLACK_EVENT_AUTH_SUCCESS, clientIP, " - session token issued");
+}
+
+// Raw audit log blocks, oldest first (see audit_log.h and tools/audit_decode.py)
+void handleAudit() {
+  if (!isAuthenticated()) {
+    requestDigestAuthentication();
+    return;
+  }
+
+  static uint8_t chunk[1024];
+  size_t size = auditLogSize();
+  webServer.setContentLength(size);
+  webServer.send(200, "application/octet-stream", "");
+  for (size_t offset = 0; offset < size; ) {
+    size_t length = readAuditLog(offset, chunk, size - offset < sizeof(chunk) ? size - offset : sizeof(chunk));
+    if (length == 0) break;
+    webServer.sendContent((const char*)chunk, length);
+    offset += length;
   }
 }
 
 void initializeWebServer() {
-  String pageName = getConfigValue("pagename");
-  String page = pageName.isEmpty() ? "/" : "/" + pageName;
-  
+  // Credentials are hashed once here rather than on every request
+  initializeAuth(AUTH_REALM);
+
   // Set up main page handler
-  webServer.on(page, handleMainPage);
+  webServer.on(deviceConfig.pagePath, timedRoute<ROUTE_PAGE, handleMainPage>);
   
+  // Set up session login handler
+  webServer.on("/login", HTTP_POST, timedRoute<ROUTE_LOGIN, handleLogin>);
+
   // Set up keystroke send handler
-  webServer.on("/send", HTTP_POST, handleKeystrokeSend);
+  webServer.on("/send", HTTP_POST, timedRoute<ROUTE_SEND, handleKeystrokeSend>);
+
+  // Set up streaming upload handler (raw request body)
+  webServer.on("/send/raw", HTTP_POST, timedRoute<ROUTE_SEND_RAW, handleKeystrokeUpload>, timedUpload<handleKeystrokeUploadData>);
+
+  // Set up batch handler
+  webServer.on("/batch", HTTP_POST, timedRoute<ROUTE_BATCH, handleBatch>);
+
+  // Set up job progress handler
+  webServer.on(UriBraces("/jobs/{}"), HTTP_GET, timedRoute<ROUTE_JOB_STATUS, handleJobStatus>);
+
+  // Set up macro library handlers
+  webServer.on("/macros", HTTP_GET, timedRoute<ROUTE_MACRO_LIST, handleMacroList>);
+  webServer.on(UriBraces("/macro/{}"), HTTP_PUT, timedRoute<ROUTE_MACRO_UPLOAD, handleMacroUpload>, timedUpload<handleMacroUploadData>);
+  webServer.on(UriBraces("/macro/{}"), HTTP_POST, timedRoute<ROUTE_MACRO_PLAY, handleMacroPlay>);
+  webServer.on(UriBraces("/macro/{}"), HTTP_DELETE, timedRoute<ROUTE_MACRO_DELETE, handleMacroDelete>);
+
+  // Set up live typing handlers (the channel itself listens on LIVE_CHANNEL_PORT)
+  webServer.on("/live", HTTP_GET, timedRoute<ROUTE_LIVE_PAGE, handleLivePage>);
+  webServer.on("/live/token", HTTP_GET, timedRoute<ROUTE_LIVE_TOKEN, handleLiveToken>);
+
+  // Set up status handler
+  webServer.on("/status", HTTP_GET, timedRoute<ROUTE_STATUS, handleStatus>);
+
+  // Set up metrics handler
+  webServer.on("/metrics", HTTP_GET, timedRoute<ROUTE_METRICS, handleMetrics>);
+
+  // Set up audit log download handler
+  webServer.on("/audit", HTTP_GET, timedRoute<ROUTE_AUDIT, handleAudit>);
+
+  // Request headers handlers read (Authorization is always collected)
+  const char* headerKeys[] = {"Content-Type", "If-None-Match"};
+  webServer.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
   
   // Start the web server
   webServer.begin();
@@ -159,6 +849,7 @@ void initializeWebServer() {
 
 void handleWebServerClient() {
   webServer.handleClient();
+  recycleKeystrokeProgram(requestReports);
   
   // Periodically clean up expired blocked IPs
   static unsigned long lastCleanup = 0;
@@ -1,5 +1,8 @@
+#include "boot_sequence.h"
 #include "config_manager.h"
+#include "audit_log.h"
 #include "keyboard_handler.h"
+#include "keystroke_queue.h"
 #include "slack_notifier.h"
 #include "web_server_handler.h"
 #include "security_manager.h"
@@ -12,6 +15,77 @@ const unsigned long INTERVAL_MS = 86400000UL; // 24 hours in milliseconds
 
 //#define DEBUG
 
+bool networkServicesStarted = false;
+unsigned long lastAnnouncementMs = 0;
+bool announcementDue = false;
+
+// Brings up one startup stage per call; never blocks on the network
+void serviceBootSequence() {
+  if (bootState.hidReadyMs == 0 && TinyUSBDevice.mounted()) {
+    markHidReady();
+  }
+
+  switch (bootState.stage) {
+    case BOOT_STAGE_CONFIG:
+      if (!isBootRetryDue()) return;
+      startBootAttempt();
+      if (!loadConfiguration()) {
+        failBootStage("config.txt");
+        return;
+      }
+      #ifdef DEBUG
+        Serial.println("Configuration loaded successfully.");
+        printConfiguration();
+      #endif
+      initializeAuditLog();
+      initializeProgramCache(deviceConfig.programCacheKb);
+      completeBootStage();
+      break;
+
+    case BOOT_STAGE_WIFI:
+      if (!bootState.attempting) {
+        if (!isBootRetryDue()) return;
+        startBootAttempt();
+        WiFi.mode(WIFI_STA);
+        WiFi.beginNoBlock(deviceConfig.ssid, deviceConfig.password);
+      } else if (WiFi.status() == WL_CONNECTED) {
+        completeBootStage();
+      } else if (millis() - bootState.attemptStartMs >= BOOT_WIFI_TIMEOUT_MS) {
+        WiFi.disconnect();
+        failBootStage("no connection");
+      }
+      break;
+
+    case BOOT_STAGE_SERVICES:
+      startBootAttempt();
+      updateAnnouncement(WiFi.localIP());
+      if (!networkServicesStarted) {
+        ArduinoOTA.begin();
+        initializeWebServer();
+        initializeLiveChannel();
+        networkServicesStarted = true;
+      }
+      announcementDue = true;
+      completeBootStage();
+      printBootTimings();
+      break;
+
+    default: {
+      // Reconnect if the access point goes away; the services keep running
+      static unsigned long lastLinkCheck = 0;
+      if (millis() - lastLinkCheck >= 1000) {
+        lastLinkCheck = millis();
+        if (WiFi.status() != WL_CONNECTED) {
+          restartBootStage(BOOT_STAGE_WIFI);
+        }
+      }
+      break;
+    }
+  }
+}
+
+// Only USB is started here, so the host sees the keyboard straight away;
+// the rest comes up from loop()
 void setup() {
   // Manual begin() is required on core without built-in support e.g. mbed rp2040
   if (!TinyUSBDevice.isInitialized()) {
@@ -35,56 +109,27 @@ void setup() {
     delay(2000);
     Serial.println("Loading configuration...");
   #endif
-  
-  // Load configuration
-  if (!loadConfiguration()) {
-    Serial.println("Failed to load configuration! Rebooting...");
-    delay(1000);
-    rp2040.restart();
-  }
-  
-  #ifdef DEBUG
-    Serial.println("Configuration loaded successfully.");
-    printConfiguration();
-  #endif
-
-  // Connect to WiFi
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(getConfigValue("ssid").c_str(), getConfigValue("password").c_str());
-  
-  if (WiFi.waitForConnectResult() != WL_CONNECTED) {
-    Serial.println("WiFi Connect Failed! Rebooting...");
-    delay(1000);
-    rp2040.restart();
-  }
-  
-  ArduinoOTA.begin();
 
   // Initialize built-in LED
   #ifdef LED_BUILTIN
     pinMode(LED_BUILTIN, OUTPUT);
     digitalWrite(LED_BUILTIN, LOW);
   #endif
-
-  // Initialize web server
-  initializeWebServer();
-
 }
 
 void loop() {
-  static unsigned long lastExecution = 0;
-  String pageName = getConfigValue("pagename");
-  String page = pageName.isEmpty() ? "/" : "/" + pageName;
-  String msg = "http://" + WiFi.localIP().toString() + "/" + page + " ready";
-  String slackWebhook = getConfigValue("slack_webhook");
-
-  // Check if 24 hours have passed
-  if (lastExecution == 0 || millis() - lastExecution >= INTERVAL_MS) {
-    lastExecution = millis();
-    Serial.println(msg);
-    if(!slackWebhook.isEmpty()) {
-      sendSlackNotification(msg, slackWebhook.c_str());
-    }
+  uint32_t loopStart = micros();
+
+  serviceBootSequence();
+
+  // Announce once the web server is up (again), then every 24 hours
+  if (bootState.stage == BOOT_STAGE_READY && (announcementDue || millis() - lastAnnouncementMs >= INTERVAL_MS)) {
+    announcementDue = false;
+    lastAnnouncementMs = millis();
+    #ifdef DEBUG
+      Serial.println(deviceConfig.announcement);
+    #endif
+    queueSlackMessage(deviceConfig.announcement);
   }
 
   #ifdef TINYUSB_NEED_POLLING_TASK
@@ -92,8 +137,14 @@ void loop() {
     TinyUSBDevice.task();
   #endif
 
-  ArduinoOTA.handle();
-  handleWebServerClient();
+  serviceKeystrokeQueue();
+  if (networkServicesStarted) {
+    ArduinoOTA.handle();
+    handleWebServerClient();
+    serviceLiveChannel();
+  }
+  serviceSlackNotifier();
+  serviceAuditLog(isHidIdle() && !isLiveChannelOpen());
 
   // Toggle LED every second
   #ifdef LED_BUILTIN
@@ -106,4 +157,12 @@ void loop() {
       digitalWrite(LED_BUILTIN, ledState ? HIGH : LOW);
     }
   #endif
+
+  recordMetric(loopLatency, micros() - loopStart);
+}
+
+// Core1 only plays back HID reports queued by core0, so WiFi, TLS and the
+// web server can never stretch the keystroke timing
+void loop1() {
+  serviceHidPlayback();
 }
\ No newline at end of file